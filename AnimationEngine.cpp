@@ -1,36 +1,118 @@
 #include "AnimationEngine.h"
-#include <algorithm> // For std::min
+#include <algorithm>
+#include <cmath>
 
-AnimationEngine::AnimationEngine() : interpolation_speed(0.3) {}
+namespace {
+constexpr uint8_t PRIMED = 1;
+constexpr uint8_t MOVING = 2;
 
-void AnimationEngine::set_target(const std::string& key, double target_value) {
-    auto it = values.find(key);
-    if (it != values.end()) {
-        it->second.target = target_value;
-    } else {
-        values[key] = {target_value, target_value};
+// Converged when within 0.1% of the target's magnitude (at least 1e-3)
+inline bool near(double a, double b) {
+    return std::fabs(a - b) <= 1e-3 * std::max(1.0, std::fabs(b));
+}
+
+inline double ease(AnimationEngine::Motion m, double u) {
+    switch (m) {
+        case AnimationEngine::Motion::EASE_IN_OUT:
+            return u < 0.5 ? 4.0 * u * u * u : 1.0 - 4.0 * (1.0 - u) * (1.0 - u) * (1.0 - u);
+        case AnimationEngine::Motion::EASE_OUT:
+            return 1.0 - (1.0 - u) * (1.0 - u) * (1.0 - u);
+        default:
+            return u;
     }
 }
+}
 
-void AnimationEngine::step(double dt) {
-    for (auto& pair : values) {
-        AnimatedValue& val = pair.second;
-        double interpolation_factor = std::min(1.0, interpolation_speed * dt * 10.0);
-        double new_value = val.current + (val.target - val.current) * interpolation_factor;
+AnimationEngine::AnimationEngine() = default;
 
-        // Prevent negative values if the target is non-negative
-        if (val.target >= 0 && new_value < 0) {
-            new_value = 0.0;
-        }
+AnimationEngine::Handle AnimationEngine::add(const std::string& name, Motion motion,
+                                             double tau, double initial) {
+    Handle existing = find(name);
+    if (existing != INVALID) return existing;
+    current_.push_back(initial);
+    target_.push_back(initial);
+    velocity_.push_back(0.0);
+    start_.push_back(initial);
+    elapsed_.push_back(0.0);
+    tau_.push_back(std::max(1e-3, tau));
+    motion_.push_back(motion);
+    state_.push_back(0);
+    names_.push_back(name);
+    return static_cast<Handle>(current_.size() - 1);
+}
 
-        val.current = new_value;
+AnimationEngine::Handle AnimationEngine::find(const std::string& name) const {
+    auto it = std::find(names_.begin(), names_.end(), name);
+    return it == names_.end() ? INVALID : static_cast<Handle>(it - names_.begin());
+}
+
+void AnimationEngine::set_target(Handle h, double target_value) {
+    if (h < 0 || static_cast<size_t>(h) >= current_.size()) return;
+    if (!(state_[h] & PRIMED)) {
+        state_[h] = PRIMED;
+        current_[h] = target_[h] = start_[h] = target_value;
+        return;
+    }
+    if (target_[h] == target_value) return;
+    target_[h] = target_value;
+    start_[h] = current_[h];
+    elapsed_[h] = 0.0;
+    if (!(state_[h] & MOVING)) {
+        state_[h] |= MOVING;
+        ++moving_;
     }
 }
 
-double AnimationEngine::get(const std::string& key, double default_value) {
-    auto it = values.find(key);
-    if (it != values.end()) {
-        return it->second.current;
+void AnimationEngine::snap(Handle h, double value) {
+    if (h < 0 || static_cast<size_t>(h) >= current_.size()) return;
+    if (state_[h] & MOVING) --moving_;
+    state_[h] = PRIMED;
+    current_[h] = target_[h] = start_[h] = value;
+    velocity_[h] = 0.0;
+}
+
+void AnimationEngine::step(double dt) {
+    if (moving_ == 0 || dt <= 0.0) return;
+    const size_t n = current_.size();
+    for (size_t i = 0; i < n; ++i) {
+        if (!(state_[i] & MOVING)) continue;
+        const double target = target_[i];
+        const double tau = tau_[i];
+        double value = current_[i];
+
+        switch (motion_[i]) {
+            case Motion::EXPONENTIAL:
+                value += (target - value) * (1.0 - std::exp(-dt / tau));
+                break;
+            case Motion::SPRING: {
+                // Exact solution of x'' = -2w x' - w^2 x around the target
+                const double w = 1.0 / tau;
+                const double x0 = value - target;
+                const double v0 = velocity_[i];
+                const double decay = std::exp(-w * dt);
+                const double c = v0 + w * x0;
+                value = target + (x0 + c * dt) * decay;
+                velocity_[i] = (v0 - w * c * dt) * decay;
+                break;
+            }
+            default: {
+                elapsed_[i] += dt;
+                double u = std::min(1.0, elapsed_[i] / tau);
+                value = start_[i] + (target - start_[i]) * ease(motion_[i], u);
+                if (u >= 1.0) value = target;
+                break;
+            }
+        }
+
+        // Prevent negative values if the target is non-negative
+        if (target >= 0 && value < 0) value = 0.0;
+
+        if (near(value, target) && std::fabs(velocity_[i]) <= 1e-3 * std::max(1.0, std::fabs(target))) {
+            value = target;
+            velocity_[i] = 0.0;
+            state_[i] &= static_cast<uint8_t>(~MOVING);
+            --moving_;
+        }
+        current_[i] = value;
     }
-    return default_value;
 }
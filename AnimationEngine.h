@@ -1,30 +1,71 @@
 #ifndef ANIMATION_ENGINE_H
 #define ANIMATION_ENGINE_H
 
-#include <map>
+#include <cstdint>
 #include <string>
+#include <vector>
 
+// Animated scalar channels in a contiguous structure-of-arrays.
+//
+// A channel is registered once by name and then addressed by its handle;
+// per-frame calls never touch strings. Motion is frame-rate independent:
+// EXPONENTIAL and SPRING integrate exactly over dt (time constant tau),
+// the eased curves run a fixed-length tween from the value at the moment
+// the target changed. A channel's first target is taken as-is, so values
+// do not sweep up from zero at startup.
 class AnimationEngine {
 public:
+    using Handle = int;
+    static constexpr Handle INVALID = -1;
+
+    enum class Motion : uint8_t {
+        EXPONENTIAL, // first-order lag, tau = time constant
+        SPRING,      // critically damped spring, tau = 1/omega
+        EASE_LINEAR, // tween, tau = duration
+        EASE_IN_OUT, // cubic ease-in-out tween, tau = duration
+        EASE_OUT     // cubic ease-out tween, tau = duration
+    };
+
     AnimationEngine();
 
+    // Registers a channel, or returns the existing handle for name (the
+    // motion of the first registration wins).
+    Handle add(const std::string& name, Motion motion = Motion::EXPONENTIAL,
+               double tau = DEFAULT_TAU, double initial = 0.0);
+    Handle find(const std::string& name) const;
+
     // Установить целевое значение для плавной анимации
-    void set_target(const std::string& key, double target_value);
+    void set_target(Handle h, double target_value);
+    // Jump to value with no motion
+    void snap(Handle h, double value);
 
-    // Выполнить шаг интерполяции, dt - время в долях секунды с прошлого кадра
+    // Выполнить шаг интерполяции, dt - время в секундах с прошлого кадра
     void step(double dt);
 
     // Получить текущее плавное значение
-    double get(const std::string& key, double default_value = 0.0);
+    // default_value until the channel got its first target
+    double get(Handle h, double default_value = 0.0) const {
+        return (h >= 0 && static_cast<size_t>(h) < current_.size() && (state_[h] & 1)) ? current_[h] : default_value;
+    }
+    double target(Handle h) const { return target_[h]; }
 
-private:
-    struct AnimatedValue {
-        double current;
-        double target;
-    };
+    // True while any channel is still moving towards its target
+    bool settling() const { return moving_ > 0; }
+    size_t size() const { return current_.size(); }
 
-    std::map<std::string, AnimatedValue> values;
-    double interpolation_speed;
+    static constexpr double DEFAULT_TAU = 0.33;
+
+private:
+    std::vector<double> current_;
+    std::vector<double> target_;
+    std::vector<double> velocity_; // SPRING
+    std::vector<double> start_;    // tweens: value when the target changed
+    std::vector<double> elapsed_;  // tweens: seconds since the target changed
+    std::vector<double> tau_;
+    std::vector<Motion> motion_;
+    std::vector<uint8_t> state_;   // bit 0: has a target, bit 1: moving
+    std::vector<std::string> names_;
+    size_t moving_ = 0;
 };
 
 #endif // ANIMATION_ENGINE_H
@@ -0,0 +1,12 @@
+#ifndef DIRTY_RECT_H
+#define DIRTY_RECT_H
+
+// Screen region in pixels, as produced by the dirty-tile diff.
+struct Rect {
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+#endif // DIRTY_RECT_H
@@ -0,0 +1,261 @@
+#include "DirtyTracker.h"
+#include "utils.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+constexpr int RECT_COST_PX_DEFAULT = 128;
+
+inline bool block_differs(const uint16_t* a, const uint16_t* b, int n) {
+    int i = 0;
+#if defined(__aarch64__)
+    uint16x8_t acc = vdupq_n_u16(0);
+    for (; i + 8 <= n; i += 8) {
+        acc = vorrq_u16(acc, veorq_u16(vld1q_u16(a + i), vld1q_u16(b + i)));
+    }
+    if (vmaxvq_u16(acc) != 0) return true;
+#else
+    uint64_t acc = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint64_t wa, wb;
+        std::memcpy(&wa, a + i, sizeof(wa));
+        std::memcpy(&wb, b + i, sizeof(wb));
+        acc |= wa ^ wb;
+    }
+    if (acc != 0) return true;
+#endif
+    for (; i < n; ++i) {
+        if (a[i] != b[i]) return true;
+    }
+    return false;
+}
+}
+
+DirtyTracker::DirtyTracker(int width, int height, int block, int max_rects)
+    : width_(width), height_(height), block_(std::max(1, block)), max_rects_(std::max(1, max_rects)) {
+    // One mask word per row: widen the blocks rather than overflow it
+    if ((width_ + block_ - 1) / block_ > MAX_BLOCKS) {
+        block_ = (width_ + MAX_BLOCKS - 1) / MAX_BLOCKS;
+    }
+    blocks_ = (width_ + block_ - 1) / block_;
+    setup_cost_px_ = getenv_int("LCD_DIRTY_RECT_COST_PX", RECT_COST_PX_DEFAULT);
+    row_masks_.assign(static_cast<size_t>(height_), 0);
+    row_limits_.assign(static_cast<size_t>(height_), 0);
+
+    int hw = static_cast<int>(std::thread::hardware_concurrency());
+    threads_ = std::max(1, std::min(getenv_int("LCD_DIRTY_THREADS", 1), std::max(1, hw)));
+    for (int i = 1; i < threads_; ++i) {
+        helpers_.emplace_back(&DirtyTracker::helper, this, i);
+    }
+}
+
+DirtyTracker::~DirtyTracker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& t : helpers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void DirtyTracker::diffRows(int y_begin, int y_end) {
+    for (int y = y_begin; y < y_end; ++y) {
+        const uint16_t* a = cur_ + static_cast<size_t>(y) * width_;
+        const uint16_t* b = prev_ + static_cast<size_t>(y) * width_;
+        uint64_t mask = 0;
+        uint64_t todo = row_limits_[static_cast<size_t>(y)];
+        while (todo) {
+            int blk = __builtin_ctzll(todo);
+            todo &= todo - 1;
+            int x0 = blk * block_;
+            int n = std::min(block_, width_ - x0);
+            if (block_differs(a + x0, b + x0, n)) {
+                mask |= 1ULL << blk;
+            }
+        }
+        row_masks_[static_cast<size_t>(y)] = mask;
+    }
+}
+
+void DirtyTracker::helper(int index) {
+    unsigned seen = 0;
+    const int rows_per = (height_ + threads_ - 1) / threads_;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+        int y0 = std::min(height_, index * rows_per);
+        int y1 = std::min(height_, y0 + rows_per);
+        diffRows(y0, y1);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) done_cv_.notify_one();
+        }
+    }
+}
+
+long long DirtyTracker::areaPx(const Cand& c) const {
+    int x0 = c.b0 * block_;
+    int x1 = std::min(width_, (c.b1 + 1) * block_);
+    return static_cast<long long>(x1 - x0) * (c.y1 - c.y0 + 1);
+}
+
+long long DirtyTracker::cost(const Cand& c) const {
+    return setup_cost_px_ + areaPx(c);
+}
+
+bool DirtyTracker::buildCandidates() {
+    cand_count_ = 0;
+    for (int y = 0; y < height_; ++y) {
+        uint64_t mask = row_masks_[static_cast<size_t>(y)];
+        while (mask) {
+            int b0 = __builtin_ctzll(mask);
+            uint64_t rest = mask >> b0;
+            int len = (~rest == 0) ? (64 - b0) : __builtin_ctzll(~rest);
+            int b1 = b0 + len - 1;
+            mask = (b1 >= 63) ? 0 : (mask & ~((2ULL << b1) - 1));
+
+            // Grow the rects that reached the previous row (or were already
+            // grown into this one by an earlier run) and overlap this run.
+            int target = -1;
+            for (int i = 0; i < cand_count_; ++i) {
+                Cand& c = cands_[i];
+                if (!c.open || c.y1 < y - 1 || c.b1 < b0 || c.b0 > b1) continue;
+                if (target < 0) {
+                    target = i;
+                    c.b0 = std::min(c.b0, b0);
+                    c.b1 = std::max(c.b1, b1);
+                    c.y1 = y;
+                } else {
+                    Cand& t = cands_[target];
+                    t.b0 = std::min(t.b0, c.b0);
+                    t.b1 = std::max(t.b1, c.b1);
+                    t.y0 = std::min(t.y0, c.y0);
+                    c.open = false;
+                    c.b0 = -1; // absorbed
+                }
+            }
+            if (target < 0) {
+                if (cand_count_ >= MAX_CANDIDATES) return false;
+                cands_[cand_count_++] = Cand{b0, b1, y, y, true};
+            }
+        }
+    }
+
+    int n = 0;
+    for (int i = 0; i < cand_count_; ++i) {
+        if (cands_[i].b0 >= 0) cands_[n++] = cands_[i];
+    }
+    cand_count_ = n;
+    return true;
+}
+
+void DirtyTracker::coalesce() {
+    while (cand_count_ > 1) {
+        long long best_gain = LLONG_MIN;
+        int bi = -1, bj = -1;
+        for (int i = 0; i < cand_count_; ++i) {
+            for (int j = i + 1; j < cand_count_; ++j) {
+                const Cand& a = cands_[i];
+                const Cand& b = cands_[j];
+                Cand m{std::min(a.b0, b.b0), std::max(a.b1, b.b1),
+                       std::min(a.y0, b.y0), std::max(a.y1, b.y1), false};
+                long long gain = cost(a) + cost(b) - cost(m);
+                if (gain > best_gain) {
+                    best_gain = gain;
+                    bi = i;
+                    bj = j;
+                }
+            }
+        }
+        if (best_gain <= 0 && cand_count_ <= max_rects_) break;
+
+        Cand& a = cands_[bi];
+        const Cand& b = cands_[bj];
+        a.b0 = std::min(a.b0, b.b0);
+        a.b1 = std::max(a.b1, b.b1);
+        a.y0 = std::min(a.y0, b.y0);
+        a.y1 = std::max(a.y1, b.y1);
+        cands_[bj] = cands_[--cand_count_];
+    }
+}
+
+size_t DirtyTracker::Compute(const uint16_t* cur, const uint16_t* prev, std::vector<Rect>& rects,
+                             const std::vector<Rect>* limit) {
+    rects.clear();
+    cur_ = cur;
+    prev_ = prev;
+
+    if (limit) {
+        std::fill(row_limits_.begin(), row_limits_.end(), 0);
+        for (const auto& r : *limit) {
+            int x0 = std::max(0, r.x);
+            int x1 = std::min(width_, r.x + r.w);
+            int y0 = std::max(0, r.y);
+            int y1 = std::min(height_, r.y + r.h);
+            if (x1 <= x0 || y1 <= y0) continue;
+            int b0 = x0 / block_;
+            int b1 = (x1 - 1) / block_;
+            uint64_t bits = ((b1 >= 63) ? ~0ULL : ((2ULL << b1) - 1)) & ~((1ULL << b0) - 1);
+            for (int y = y0; y < y1; ++y) {
+                row_limits_[static_cast<size_t>(y)] |= bits;
+            }
+        }
+    } else {
+        const uint64_t all = (blocks_ >= 64) ? ~0ULL : ((1ULL << blocks_) - 1);
+        std::fill(row_limits_.begin(), row_limits_.end(), all);
+    }
+
+    if (threads_ > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = threads_ - 1;
+            ++generation_;
+        }
+        start_cv_.notify_all();
+        diffRows(0, std::min(height_, (height_ + threads_ - 1) / threads_));
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return pending_ == 0; });
+    } else {
+        diffRows(0, height_);
+    }
+
+    const size_t screen_area = static_cast<size_t>(width_) * height_;
+    if (!buildCandidates()) {
+        return screen_area;
+    }
+    if (cand_count_ == 0) {
+        return 0;
+    }
+    coalesce();
+
+    long long total_cost = 0;
+    size_t area = 0;
+    for (int i = 0; i < cand_count_; ++i) {
+        total_cost += cost(cands_[i]);
+        area += static_cast<size_t>(areaPx(cands_[i]));
+    }
+    if (total_cost >= setup_cost_px_ + static_cast<long long>(screen_area)) {
+        return screen_area;
+    }
+
+    for (int i = 0; i < cand_count_; ++i) {
+        const Cand& c = cands_[i];
+        Rect r;
+        r.x = c.b0 * block_;
+        r.y = c.y0;
+        r.w = std::min(width_, (c.b1 + 1) * block_) - r.x;
+        r.h = c.y1 - c.y0 + 1;
+        rects.push_back(r);
+    }
+    return area;
+}
@@ -0,0 +1,83 @@
+#ifndef DIRTY_TRACKER_H
+#define DIRTY_TRACKER_H
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "DirtyRect.h"
+
+// Frame diff and dirty-rect planning for partial panel updates.
+//
+// Each row of the new frame is compared with the previous one in blocks of
+// `block` pixels (NEON on ARM, 64-bit words elsewhere), producing a bitmask
+// of dirty column blocks per row, i.e. row spans at block granularity. Rows
+// can be split across helper threads (LCD_DIRTY_THREADS).
+//
+// The spans are grown into rects row by row and then coalesced greedily by
+// SPI cost: every rect pays a fixed setup cost (CASET/RASET/RAMWR, DC toggles,
+// ioctls; LCD_DIRTY_RECT_COST_PX, in pixel-equivalents) plus its area. Two
+// rects are merged when their bounding box is cheaper than both, and
+// further merges are forced until at most max_rects remain. Nothing is
+// allocated per frame.
+class DirtyTracker {
+public:
+    DirtyTracker(int width, int height, int block, int max_rects);
+    ~DirtyTracker();
+
+    DirtyTracker(const DirtyTracker&) = delete;
+    DirtyTracker& operator=(const DirtyTracker&) = delete;
+
+    // Fills rects (at most max_rects) and returns the total dirty area in
+    // pixels. Returns width*height with rects empty when a full frame is
+    // cheaper than the rect set. With limit, only blocks overlapping those
+    // regions are compared (the renderer's invalidated layers).
+    size_t Compute(const uint16_t* cur, const uint16_t* prev, std::vector<Rect>& rects,
+                   const std::vector<Rect>* limit = nullptr);
+
+private:
+    static constexpr int MAX_BLOCKS = 64;     // one uint64_t mask per row
+    static constexpr int MAX_CANDIDATES = 96; // beyond this a full frame is cheaper anyway
+
+    struct Cand {
+        int b0, b1; // column block range, inclusive
+        int y0, y1; // rows, inclusive
+        bool open;  // touched the previous row
+    };
+
+    void diffRows(int y_begin, int y_end);
+    bool buildCandidates();
+    void coalesce();
+    long long cost(const Cand& c) const;
+    long long areaPx(const Cand& c) const;
+    void helper(int index);
+
+    int width_;
+    int height_;
+    int block_;
+    int blocks_;
+    int max_rects_;
+    long long setup_cost_px_;
+
+    const uint16_t* cur_ = nullptr;
+    const uint16_t* prev_ = nullptr;
+    std::vector<uint64_t> row_masks_;
+    std::vector<uint64_t> row_limits_; // blocks to compare per row
+    std::array<Cand, MAX_CANDIDATES> cands_;
+    int cand_count_ = 0;
+
+    // Row-diff helper threads; the caller thread takes the first share
+    int threads_ = 1;
+    std::vector<std::thread> helpers_;
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    unsigned generation_ = 0;
+    int pending_ = 0;
+    bool stop_ = false;
+};
+
+#endif // DIRTY_TRACKER_H
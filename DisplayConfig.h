@@ -0,0 +1,11 @@
+#ifndef DISPLAY_CONFIG_H
+#define DISPLAY_CONFIG_H
+
+// Display Configuration (landscape). Kept apart from ILI9488.h so code that
+// only needs the geometry (Renderer, the bench) does not pull in libgpiod.
+const int DISPLAY_WIDTH = 480;
+const int DISPLAY_HEIGHT = 320;
+const int OFFSET_X = 0;
+const int OFFSET_Y = 0;
+
+#endif // DISPLAY_CONFIG_H
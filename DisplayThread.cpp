@@ -0,0 +1,158 @@
+#include "DisplayThread.h"
+#include "ILI9488.h"
+#include "utils.h"
+#include "Profiler.h"
+#include <chrono>
+#include <cstring>
+
+DisplayThread::DisplayThread(ILI9488& display, int width, int height, int max_rects)
+    : display_(display), width_(width), height_(height), max_rects_(max_rects) {
+    // "merge" (default) or "block"; "drop" is the old name of "merge"
+    policy_ = (getenv_string("LCD_DISPLAY_QUEUE", "merge") == "block") ? QueuePolicy::Block : QueuePolicy::Merge;
+    for (int i = 0; i < SLOT_COUNT; ++i) {
+        slots_[i].pixels.resize(static_cast<size_t>(width_) * height_);
+        slots_[i].rects.reserve(static_cast<size_t>(max_rects_) * QUEUE_DEPTH);
+        free_.push_back(i);
+    }
+}
+
+DisplayThread::~DisplayThread() {
+    Stop();
+}
+
+void DisplayThread::Start() {
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread(&DisplayThread::worker, this);
+}
+
+void DisplayThread::Stop() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    work_cv_.notify_all();
+    free_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void DisplayThread::copyRegions(Slot& slot, const uint16_t* src) const {
+    if (slot.full) {
+        std::memcpy(slot.pixels.data(), src, slot.pixels.size() * sizeof(uint16_t));
+        return;
+    }
+    for (const auto& r : slot.rects) {
+        for (int y = r.y; y < r.y + r.h; ++y) {
+            size_t off = static_cast<size_t>(y) * width_ + r.x;
+            std::memcpy(slot.pixels.data() + off, src + off, static_cast<size_t>(r.w) * sizeof(uint16_t));
+        }
+    }
+}
+
+void DisplayThread::send(const uint16_t* pixels, const std::vector<Rect>& rects, bool full) {
+    PROFILE_SCOPE("spi.frame");
+    auto spi_start = std::chrono::steady_clock::now();
+    size_t area = 0;
+    if (full) {
+        display_.UpdateRect(0, 0, width_, height_, pixels, width_);
+        area = static_cast<size_t>(width_) * height_;
+    } else {
+        for (const auto& r : rects) {
+            display_.UpdateRect(r.x, r.y, r.w, r.h, pixels, width_);
+            area += static_cast<size_t>(r.w) * r.h;
+        }
+    }
+    auto spi_end = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.spi_seconds += std::chrono::duration_cast<std::chrono::duration<double>>(spi_end - spi_start).count();
+    stats_.bytes += area * display_.BytesPerPixel();
+    stats_.frames++;
+    stats_.last_rects = full ? 1 : rects.size();
+}
+
+void DisplayThread::Submit(const std::vector<uint16_t>& frame, const std::vector<Rect>& rects, bool full) {
+    if (!running_) {
+        // Synchronous mode: transfer straight from the caller's frame
+        send(frame.data(), rects, full);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool queue_full = free_.empty() || pending_.size() >= static_cast<size_t>(QUEUE_DEPTH);
+    if (queue_full && policy_ == QueuePolicy::Merge && !pending_.empty()) {
+        // SPI is behind: fold this frame into the newest queued one. Old rects
+        // are re-copied too, so every region carries the latest pixels.
+        Slot& slot = slots_[pending_.back()];
+        if (full || slot.full ||
+            static_cast<int>(slot.rects.size() + rects.size()) > max_rects_ * QUEUE_DEPTH) {
+            slot.full = true;
+            slot.rects.clear();
+        } else {
+            slot.rects.insert(slot.rects.end(), rects.begin(), rects.end());
+        }
+        copyRegions(slot, frame.data());
+        lock.unlock();
+        std::lock_guard<std::mutex> slock(stats_mutex_);
+        stats_.merged++;
+        return;
+    }
+    if (queue_full) {
+        {
+            std::lock_guard<std::mutex> slock(stats_mutex_);
+            stats_.blocked++;
+        }
+        free_cv_.wait(lock, [this] {
+            return !running_ || (!free_.empty() && pending_.size() < static_cast<size_t>(QUEUE_DEPTH));
+        });
+        if (!running_) return;
+    }
+
+    int idx = free_.back();
+    free_.pop_back();
+    lock.unlock();
+
+    // The slot is owned by this thread until it is queued
+    Slot& slot = slots_[idx];
+    slot.full = full;
+    slot.rects.assign(rects.begin(), rects.end());
+    copyRegions(slot, frame.data());
+
+    lock.lock();
+    pending_.push_back(idx);
+    lock.unlock();
+    work_cv_.notify_one();
+}
+
+DisplayThread::Stats DisplayThread::TakeStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats out = stats_;
+    stats_ = Stats{};
+    stats_.last_rects = out.last_rects;
+    return out;
+}
+
+void DisplayThread::worker() {
+    while (true) {
+        int idx = -1;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this] { return !running_ || !pending_.empty(); });
+            if (!running_) break;
+            idx = pending_.front();
+            pending_.pop_front();
+        }
+
+        const Slot& slot = slots_[idx];
+        send(slot.pixels.data(), slot.rects, slot.full);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(idx);
+        }
+        free_cv_.notify_one();
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef DISPLAY_THREAD_H
+#define DISPLAY_THREAD_H
+
+#include <array>
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "DirtyRect.h"
+
+class ILI9488;
+
+// Moves SPI transfers off the render thread.
+//
+// Submit() copies the dirty regions of a rendered frame into a slot and
+// returns; a worker thread pushes queued slots to the panel. Up to two frames
+// wait in the queue behind the one being transferred. When the queue is full
+// the new frame is either merged into the newest queued one (rect lists
+// unioned, pixels overwritten with the newer content) or the caller blocks
+// until a slot frees up (LCD_DISPLAY_QUEUE=merge|block).
+class DisplayThread {
+public:
+    enum class QueuePolicy { Merge, Block };
+
+    struct Stats {
+        double spi_seconds = 0.0;
+        size_t bytes = 0;
+        int frames = 0;
+        size_t last_rects = 0;
+        int merged = 0;  // frames folded into an already queued one
+        int blocked = 0; // Submit() calls that had to wait for a slot
+    };
+
+    DisplayThread(ILI9488& display, int width, int height, int max_rects);
+    ~DisplayThread();
+
+    DisplayThread(const DisplayThread&) = delete;
+    DisplayThread& operator=(const DisplayThread&) = delete;
+
+    // Without Start() (LCD_DISPLAY_ASYNC=false) Submit() transfers inline.
+    void Start();
+    void Stop();
+
+    // rects are ignored when full is set.
+    void Submit(const std::vector<uint16_t>& frame, const std::vector<Rect>& rects, bool full);
+
+    // Counters since the previous call.
+    Stats TakeStats();
+
+private:
+    static constexpr int QUEUE_DEPTH = 2;
+    static constexpr int SLOT_COUNT = QUEUE_DEPTH + 1; // + the one on the wire
+
+    struct Slot {
+        std::vector<uint16_t> pixels;
+        std::vector<Rect> rects;
+        bool full = false;
+    };
+
+    void worker();
+    void copyRegions(Slot& slot, const uint16_t* src) const;
+    void send(const uint16_t* pixels, const std::vector<Rect>& rects, bool full);
+
+    ILI9488& display_;
+    int width_;
+    int height_;
+    int max_rects_;
+    QueuePolicy policy_ = QueuePolicy::Merge;
+
+    std::array<Slot, SLOT_COUNT> slots_;
+    std::vector<int> free_;
+    std::deque<int> pending_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable free_cv_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+    std::mutex stats_mutex_;
+    Stats stats_;
+};
+
+#endif // DISPLAY_THREAD_H
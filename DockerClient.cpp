@@ -0,0 +1,52 @@
+#include "DockerClient.h"
+#include "json.hpp"
+#include <curl/curl.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+static size_t docker_write_cb(void* contents, size_t size, size_t nmemb, void* userp) {
+    size_t total = size * nmemb;
+    auto* str = static_cast<std::string*>(userp);
+    str->append(static_cast<const char*>(contents), total);
+    return total;
+}
+
+DockerClient::DockerClient(const std::string& socket_path)
+    : socket_path_(socket_path) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+}
+
+DockerClient::~DockerClient() {
+    if (curl_) curl_easy_cleanup(static_cast<CURL*>(curl_));
+    curl_global_cleanup();
+}
+
+int DockerClient::RunningContainers() {
+    if (access(socket_path_.c_str(), W_OK) != 0) return -1;
+
+    if (!curl_) {
+        CURL* curl = curl_easy_init();
+        if (!curl) return -1;
+        curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, socket_path_.c_str());
+        // Host part is ignored on a Unix socket; only the path is routed by dockerd
+        curl_easy_setopt(curl, CURLOPT_URL, "http://localhost/containers/json");
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, docker_write_cb);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body_);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 2L);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_ = curl;
+    }
+
+    CURL* curl = static_cast<CURL*>(curl_);
+    body_.clear();
+    CURLcode res = curl_easy_perform(curl);
+    long code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    if (res != CURLE_OK || code != 200) return -1;
+
+    json j = json::parse(body_, nullptr, false);
+    if (!j.is_array()) return -1;
+    return static_cast<int>(j.size());
+}
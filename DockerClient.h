@@ -0,0 +1,29 @@
+#ifndef DOCKER_CLIENT_H
+#define DOCKER_CLIENT_H
+
+#include <string>
+
+// Docker Engine API over the daemon's Unix socket.
+//
+// One curl easy handle is kept for the lifetime of the client, so the
+// connection to dockerd stays open between polls instead of forking
+// `docker ps` (a Go binary that itself dials the same socket) every time.
+class DockerClient {
+public:
+    explicit DockerClient(const std::string& socket_path);
+    ~DockerClient();
+
+    DockerClient(const DockerClient&) = delete;
+    DockerClient& operator=(const DockerClient&) = delete;
+
+    // Number of running containers (GET /containers/json), -1 on error.
+    // Not thread-safe: call from one thread only (the slow probe thread).
+    int RunningContainers();
+
+private:
+    std::string socket_path_;
+    void* curl_ = nullptr; // CURL*
+    std::string body_;
+};
+
+#endif // DOCKER_CLIENT_H
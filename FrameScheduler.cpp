@@ -0,0 +1,90 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+constexpr long NS_PER_SEC = 1000000000L;
+
+int64_t to_ns(const timespec& ts) {
+    return static_cast<int64_t>(ts.tv_sec) * NS_PER_SEC + ts.tv_nsec;
+}
+
+timespec from_ns(int64_t ns) {
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(ns / NS_PER_SEC);
+    ts.tv_nsec = static_cast<long>(ns % NS_PER_SEC);
+    return ts;
+}
+
+int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return to_ns(ts);
+}
+}
+
+FrameScheduler::FrameScheduler(int max_fps, int max_sleep_ms)
+    : min_period_ns_(NS_PER_SEC / std::max(1, max_fps)),
+      max_sleep_ms_(std::max(1, max_sleep_ms)) {
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    last_ = from_ns(now_ns());
+}
+
+FrameScheduler::~FrameScheduler() {
+    if (wake_fd_ >= 0) close(wake_fd_);
+}
+
+void FrameScheduler::Notify() {
+    if (wake_fd_ < 0) return;
+    uint64_t one = 1;
+    ssize_t r = write(wake_fd_, &one, sizeof(one));
+    (void)r;
+}
+
+bool FrameScheduler::waitEvent(int timeout_ms) {
+    if (wake_fd_ < 0) {
+        if (timeout_ms > 0) usleep(static_cast<useconds_t>(timeout_ms) * 1000);
+        return false;
+    }
+    pollfd pfd{wake_fd_, POLLIN, 0};
+    int n = poll(&pfd, 1, timeout_ms);
+    if (n <= 0) return false;
+    uint64_t count = 0;
+    ssize_t r = read(wake_fd_, &count, sizeof(count)); // drain: events coalesce into one frame
+    (void)r;
+    return true;
+}
+
+void FrameScheduler::sleepUntil(const timespec& deadline) {
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+    }
+}
+
+bool FrameScheduler::Wait(Demand demand, int fps) {
+    const int64_t last = to_ns(last_);
+    int64_t period = min_period_ns_;
+    if (demand == Demand::EFFECTS) {
+        period = std::max<int64_t>(min_period_ns_, NS_PER_SEC / std::max(1, fps));
+    }
+    bool event = false;
+
+    if (demand == Demand::NONE) {
+        // Nothing moves: wait for a producer, then keep at least the MOTION spacing
+        event = waitEvent(max_sleep_ms_);
+    }
+    int64_t next = last + period;
+    int64_t now = now_ns();
+    if (next < now - period) {
+        next = now; // fell behind (slow frame or long block): no catch-up burst
+    }
+    if (next > now) sleepUntil(from_ns(next));
+    if (demand != Demand::NONE) event = waitEvent(0);
+
+    // Timed frames stay on their grid; an event-driven frame starts a new one
+    last_ = from_ns(demand == Demand::NONE ? std::max(next, now) : next);
+    return event;
+}
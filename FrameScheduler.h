@@ -0,0 +1,43 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <ctime>
+
+// Paces the render loop by what the screen actually needs.
+//
+// MOTION (animated values still settling, idle fade in progress) runs at
+// max_fps, bounded further by DisplayThread back-pressure; EFFECTS (pulse
+// and other time-driven effects, nothing settling) runs at the caller's
+// fps. Both sleep with clock_nanosleep(TIMER_ABSTIME) on a fixed grid, so
+// render time does not add drift. NONE blocks on an eventfd until a
+// producer calls Notify() (new metrics snapshot, printer state) or
+// max_sleep_ms passes, so a static screen is not re-rendered.
+class FrameScheduler {
+public:
+    enum class Demand { NONE, EFFECTS, MOTION };
+
+    FrameScheduler(int max_fps, int max_sleep_ms);
+    ~FrameScheduler();
+
+    FrameScheduler(const FrameScheduler&) = delete;
+    FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+    // eventfd producers write to (or call Notify()); -1 if it could not be created
+    int WakeFd() const { return wake_fd_; }
+    void Notify();
+
+    // Blocks until the next frame is due. fps applies to EFFECTS.
+    // Returns true if a producer event was pending or arrived.
+    bool Wait(Demand demand, int fps);
+
+private:
+    bool waitEvent(int timeout_ms);
+    void sleepUntil(const timespec& deadline);
+
+    int wake_fd_ = -1;
+    long min_period_ns_;
+    int max_sleep_ms_;
+    timespec last_{0, 0}; // start of the previous frame, CLOCK_MONOTONIC
+};
+
+#endif // FRAME_SCHEDULER_H
@@ -0,0 +1,104 @@
+#include "GlyphCache.h"
+#include "stb_truetype.h"
+#include <algorithm>
+#include <cmath>
+
+GlyphCache::GlyphCache(const stbtt_fontinfo* font) : font_(font) {
+    has_kern_ = font_ && (font_->kern != 0 || font_->gpos != 0);
+}
+
+void GlyphCache::Clear() {
+    faces_.clear();
+    glyphs_.clear();
+    atlas_.clear();
+}
+
+GlyphCache::Face& GlyphCache::face(float size) {
+    for (auto& f : faces_) {
+        if (f.size_ == size) return f;
+    }
+    faces_.emplace_back();
+    Face& f = faces_.back();
+    f.size_ = size;
+    f.ascii_.fill(-1);
+    if (font_) {
+        f.scale_ = stbtt_ScaleForPixelHeight(font_, size);
+        int ascent = 0, descent = 0, line_gap = 0;
+        stbtt_GetFontVMetrics(font_, &ascent, &descent, &line_gap);
+        f.ascent_ = static_cast<int>(ascent * f.scale_);
+    }
+    return f;
+}
+
+int32_t GlyphCache::rasterize(Face& face, int codepoint) {
+    Glyph g;
+    if (font_) {
+        int advance = 0, lsb = 0;
+        stbtt_GetCodepointHMetrics(font_, codepoint, &advance, &lsb);
+        g.advance = static_cast<int16_t>(advance * face.scale_);
+
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        stbtt_GetCodepointBitmapBox(font_, codepoint, face.scale_, face.scale_, &x0, &y0, &x1, &y1);
+        int w = x1 - x0;
+        int h = y1 - y0;
+        if (w > 0 && h > 0) {
+            g.x0 = static_cast<int16_t>(x0);
+            g.y0 = static_cast<int16_t>(y0);
+            g.w = static_cast<int16_t>(w);
+            g.h = static_cast<int16_t>(h);
+            g.offset = static_cast<uint32_t>(atlas_.size());
+            atlas_.resize(atlas_.size() + static_cast<size_t>(w) * h);
+            stbtt_MakeCodepointBitmap(font_, atlas_.data() + g.offset, w, h, w,
+                                      face.scale_, face.scale_, codepoint);
+        }
+    }
+    glyphs_.push_back(g);
+    return static_cast<int32_t>(glyphs_.size() - 1);
+}
+
+const GlyphCache::Glyph& GlyphCache::glyph(Face& face, int codepoint) {
+    if (codepoint >= 0 && codepoint < 128) {
+        int32_t& idx = face.ascii_[static_cast<size_t>(codepoint)];
+        if (idx < 0) idx = rasterize(face, codepoint);
+        return glyphs_[static_cast<size_t>(idx)];
+    }
+    auto it = face.other_.find(codepoint);
+    if (it == face.other_.end()) {
+        it = face.other_.emplace(codepoint, rasterize(face, codepoint)).first;
+    }
+    return glyphs_[static_cast<size_t>(it->second)];
+}
+
+int GlyphCache::lookupKern(Face& face, int a, int b) const {
+    return static_cast<int>(std::lround(stbtt_GetCodepointKernAdvance(font_, a, b) * face.scale_));
+}
+
+int GlyphCache::kern(Face& face, int a, int b) {
+    if (!has_kern_) return 0;
+    if (a >= 0 && a < 128 && b >= 0 && b < 128) {
+        if (face.ascii_kern_.empty()) face.ascii_kern_.assign(128 * 128, KERN_UNKNOWN);
+        int8_t& slot = face.ascii_kern_[static_cast<size_t>(a) * 128 + b];
+        if (slot == KERN_UNKNOWN) {
+            slot = static_cast<int8_t>(std::clamp(lookupKern(face, a, b), INT8_MIN + 1, INT8_MAX));
+        }
+        return slot;
+    }
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+    auto it = face.kern_.find(key);
+    if (it != face.kern_.end()) return it->second;
+    int k = lookupKern(face, a, b);
+    face.kern_.emplace(key, static_cast<int16_t>(k));
+    return k;
+}
+
+int GlyphCache::measure(Face& face, const char* text, size_t len) {
+    int width = 0;
+    int prev = 0;
+    for (size_t i = 0; i < len; ++i) {
+        int c = text[i];
+        if (i > 0) width += kern(face, prev, c);
+        width += glyph(face, c).advance;
+        prev = c;
+    }
+    return width;
+}
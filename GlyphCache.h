@@ -0,0 +1,75 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+struct stbtt_fontinfo;
+
+// Rasterised glyphs keyed by (codepoint, pixel size).
+//
+// Alpha masks are packed back to back in one byte atlas and rasterised on
+// first use only, together with the pixel advance; kerning pairs are cached
+// per face. The renderer uses a handful of sizes and ASCII text, so each
+// face keeps direct tables for codepoints 0..127 and for ASCII kerning pairs
+// (filled on first use, so warm text never allocates) and maps for the rest.
+// Not thread-safe: owned and used by the render thread.
+class GlyphCache {
+public:
+    struct Glyph {
+        int16_t x0 = 0, y0 = 0; // mask offset from the pen position on the baseline
+        int16_t w = 0, h = 0;
+        int16_t advance = 0;    // pixels, truncated like the renderer always laid text out
+        uint32_t offset = 0;    // first mask byte in the atlas
+    };
+
+    class Face {
+    public:
+        float size() const { return size_; }
+        int ascent() const { return ascent_; }
+
+    private:
+        friend class GlyphCache;
+        float size_ = 0.0f;
+        float scale_ = 0.0f;
+        int ascent_ = 0;
+        std::array<int32_t, 128> ascii_{};
+        std::unordered_map<int, int32_t> other_;
+        std::vector<int8_t> ascii_kern_; // 128 x 128, KERN_UNKNOWN until looked up
+        std::unordered_map<uint64_t, int16_t> kern_;
+    };
+
+    explicit GlyphCache(const stbtt_fontinfo* font);
+
+    // Face for a pixel height; created on first use. References stay valid
+    // until Clear().
+    Face& face(float size);
+    const Glyph& glyph(Face& face, int codepoint);
+    int kern(Face& face, int a, int b);
+    const uint8_t* mask(const Glyph& g) const { return atlas_.data() + g.offset; }
+
+    // Pen advance of text in pixels (advances plus kerning).
+    int measure(Face& face, const char* text, size_t len);
+
+    void Clear();
+    size_t AtlasBytes() const { return atlas_.size(); }
+    size_t GlyphCount() const { return glyphs_.size(); }
+
+private:
+    int32_t rasterize(Face& face, int codepoint);
+    int lookupKern(Face& face, int a, int b) const;
+
+    static constexpr int8_t KERN_UNKNOWN = INT8_MIN;
+
+    const stbtt_fontinfo* font_;
+    bool has_kern_ = false;
+    std::deque<Face> faces_;
+    std::vector<Glyph> glyphs_;
+    std::vector<uint8_t> atlas_;
+};
+
+#endif // GLYPH_CACHE_H
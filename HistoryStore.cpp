@@ -0,0 +1,212 @@
+#include "HistoryStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char MAGIC[8] = {'L', 'C', 'D', 'H', 'I', 'S', 'T', '1'};
+constexpr uint32_t FILE_VERSION = 1;
+// Bucket length per tier; RAW stores every sample
+constexpr int64_t BUCKET_MS[HistoryStore::TIER_COUNT] = {0, 1000, 60000, 3600000};
+constexpr uint32_t TIER_CAPACITY[HistoryStore::TIER_COUNT] = {0, 600, 1440, 720};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t series;
+    uint32_t tiers;
+    uint32_t reserved;
+    int64_t bucket_ms[HistoryStore::TIER_COUNT];
+    uint32_t capacity[HistoryStore::TIER_COUNT];
+};
+}
+
+struct HistoryStore::TierHeader {
+    int64_t bucket_start_ms; // open bucket (RAW: newest sample)
+    uint32_t head;           // oldest bucket
+    uint32_t size;
+    double acc_sum;
+    float acc_min;
+    float acc_max;
+    uint32_t acc_count;
+    uint32_t reserved;
+};
+
+HistoryStore::~HistoryStore() {
+    Close();
+}
+
+int64_t HistoryStore::NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool HistoryStore::Open(const std::string& path, size_t raw_capacity) {
+    Close();
+    if (path.empty() || raw_capacity == 0) return false;
+
+    std::memcpy(capacity_, TIER_CAPACITY, sizeof(capacity_));
+    capacity_[RAW] = static_cast<uint32_t>(raw_capacity);
+    size_t off = sizeof(FileHeader);
+    for (int s = 0; s < SERIES_COUNT; ++s) {
+        for (int t = 0; t < TIER_COUNT; ++t) {
+            offsets_[s][t] = off;
+            off += sizeof(TierHeader) + static_cast<size_t>(capacity_[t]) * sizeof(Bucket);
+        }
+    }
+    const size_t want = off;
+
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "History file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st{};
+    bool fresh = fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) != want;
+    if (fresh) {
+        // Allocate real blocks: a write into a hole on a full disk would SIGBUS
+        if (ftruncate(fd_, 0) != 0 || posix_fallocate(fd_, 0, static_cast<off_t>(want)) != 0) {
+            std::cerr << "History file " << path << ": cannot allocate " << want << " bytes" << std::endl;
+            Close();
+            return false;
+        }
+    }
+    void* p = mmap(nullptr, want, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "History file " << path << ": mmap failed" << std::endl;
+        Close();
+        return false;
+    }
+    base_ = static_cast<uint8_t*>(p);
+    size_ = want;
+
+    const auto* h = reinterpret_cast<const FileHeader*>(base_);
+    bool match = !fresh && std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 h->version == FILE_VERSION && h->series == SERIES_COUNT && h->tiers == TIER_COUNT;
+    for (int t = 0; match && t < TIER_COUNT; ++t) {
+        match = h->bucket_ms[t] == BUCKET_MS[t] && h->capacity[t] == capacity_[t];
+    }
+    for (int s = 0; match && s < SERIES_COUNT; ++s) {
+        for (int t = 0; match && t < TIER_COUNT; ++t) {
+            const TierHeader* th = tier(static_cast<Series>(s), static_cast<Tier>(t));
+            match = th->head < std::max<uint32_t>(1, capacity_[t]) && th->size <= capacity_[t];
+        }
+    }
+    if (!match) initFile();
+    return true;
+}
+
+void HistoryStore::initFile() {
+    std::memset(base_, 0, size_);
+    auto* h = reinterpret_cast<FileHeader*>(base_);
+    std::memcpy(h->magic, MAGIC, sizeof(MAGIC));
+    h->version = FILE_VERSION;
+    h->series = SERIES_COUNT;
+    h->tiers = TIER_COUNT;
+    for (int t = 0; t < TIER_COUNT; ++t) {
+        h->bucket_ms[t] = BUCKET_MS[t];
+        h->capacity[t] = capacity_[t];
+    }
+}
+
+void HistoryStore::Close() {
+    if (base_) {
+        munmap(base_, size_);
+        base_ = nullptr;
+        size_ = 0;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+HistoryStore::TierHeader* HistoryStore::tier(Series s, Tier t) const {
+    return reinterpret_cast<TierHeader*>(base_ + offsets_[s][t]);
+}
+
+HistoryStore::Bucket* HistoryStore::buckets(Series s, Tier t) const {
+    return reinterpret_cast<Bucket*>(base_ + offsets_[s][t] + sizeof(TierHeader));
+}
+
+void HistoryStore::append(Series s, Tier t, const Bucket& b) {
+    TierHeader* th = tier(s, t);
+    const uint32_t cap = capacity_[t];
+    Bucket* ring = buckets(s, t);
+    if (th->size < cap) {
+        ring[(th->head + th->size) % cap] = b;
+        th->size++;
+    } else {
+        ring[th->head] = b;
+        th->head = (th->head + 1) % cap;
+    }
+}
+
+void HistoryStore::Push(Series s, float value, int64_t now_ms) {
+    if (!base_) return;
+
+    Bucket raw;
+    raw.min = raw.max = raw.avg = value;
+    raw.count = 1;
+    append(s, RAW, raw);
+    tier(s, RAW)->bucket_start_ms = now_ms;
+
+    for (int ti = SEC; ti < TIER_COUNT; ++ti) {
+        const Tier t = static_cast<Tier>(ti);
+        const int64_t len = BUCKET_MS[t];
+        const int64_t start = now_ms - now_ms % len;
+        TierHeader* th = tier(s, t);
+
+        if (th->acc_count > 0 && start != th->bucket_start_ms) {
+            if (start > th->bucket_start_ms) {
+                Bucket b;
+                b.min = th->acc_min;
+                b.max = th->acc_max;
+                b.avg = static_cast<float>(th->acc_sum / th->acc_count);
+                b.count = th->acc_count;
+                append(s, t, b);
+                // Empty buckets for the time nothing was pushed (e.g. service stopped)
+                int64_t gaps = (start - th->bucket_start_ms) / len - 1;
+                gaps = std::min<int64_t>(gaps, capacity_[t]);
+                for (int64_t g = 0; g < gaps; ++g) append(s, t, Bucket{});
+                versions_[t]++;
+            }
+            // A clock step backwards just restarts the open bucket
+            th->acc_count = 0;
+        }
+        if (th->acc_count == 0) {
+            th->bucket_start_ms = start;
+            th->acc_sum = 0.0;
+            th->acc_min = value;
+            th->acc_max = value;
+        }
+        th->acc_sum += value;
+        th->acc_min = std::min(th->acc_min, value);
+        th->acc_max = std::max(th->acc_max, value);
+        th->acc_count++;
+    }
+}
+
+size_t HistoryStore::Read(Series s, Tier t, std::vector<Bucket>& out) const {
+    out.clear();
+    if (!base_) return 0;
+    const TierHeader* th = tier(s, t);
+    const Bucket* ring = buckets(s, t);
+    const uint32_t cap = capacity_[t];
+    out.reserve(th->size);
+    for (uint32_t i = 0; i < th->size; ++i) {
+        out.push_back(ring[(th->head + i) % cap]);
+    }
+    return out.size();
+}
+
+int64_t HistoryStore::LastTime(Series s, Tier t) const {
+    if (!base_) return 0;
+    return tier(s, t)->bucket_start_ms;
+}
@@ -0,0 +1,66 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Metric history in tiers, persisted in a fixed-size memory-mapped file.
+//
+// RAW keeps the last samples exactly as the graphs got them; SEC, MIN and
+// HOUR are streaming min/max/avg downsamples (10 min, 24 h and 30 days).
+// The unfinished bucket of each tier lives in the file too, so a restart
+// picks up mid-bucket. Buckets that saw no samples (service down) are
+// stored with count == 0. Writes only dirty the page cache; the kernel
+// flushes them. The layout is checked on Open() and the file re-created
+// when it does not match. Not thread-safe: used from the render thread.
+class HistoryStore {
+public:
+    enum Series { CPU, TEMP, NET1, NET2, SERIES_COUNT };
+    enum Tier { RAW, SEC, MIN, HOUR, TIER_COUNT };
+
+    struct Bucket {
+        float min = 0.0f;
+        float max = 0.0f;
+        float avg = 0.0f;
+        uint32_t count = 0;
+    };
+
+    HistoryStore() = default;
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    bool Open(const std::string& path, size_t raw_capacity);
+    void Close();
+    bool IsOpen() const { return base_ != nullptr; }
+
+    void Push(Series s, float value, int64_t now_ms);
+
+    // Oldest first. Returns the number of buckets written to out.
+    size_t Read(Series s, Tier t, std::vector<Bucket>& out) const;
+    // Time of the newest RAW sample, or the start of the open bucket; 0 if empty
+    int64_t LastTime(Series s, Tier t) const;
+    // Bumped whenever a tier completes a bucket (any series)
+    uint64_t Version(Tier t) const { return versions_[t]; }
+
+    static int64_t NowMs(); // wall clock, so tiers line up across restarts
+
+private:
+    struct TierHeader;
+    TierHeader* tier(Series s, Tier t) const;
+    Bucket* buckets(Series s, Tier t) const;
+    void append(Series s, Tier t, const Bucket& b);
+    void initFile();
+
+    uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    int fd_ = -1;
+    uint32_t capacity_[TIER_COUNT] = {0, 0, 0, 0};
+    size_t offsets_[SERIES_COUNT][TIER_COUNT] = {};
+    uint64_t versions_[TIER_COUNT] = {0, 0, 0, 0};
+};
+
+#endif // HISTORY_STORE_H
@@ -10,14 +10,32 @@
 #include <cstring>
 #include <cstdlib>
 #include <algorithm>
+#include <cstdio>
 #include "utils.h"
+#include "Profiler.h"
 
 namespace {
-constexpr uint8_t ILI9488_PIXFMT_18BPP = 0x66; // RGB666
+// With MV set the panel's vertical scroll (VSCRDEF/VSCRSADD) moves bands of
+// screen columns over the full height, header included, so the graph panels
+// are sent as dirty rects rather than scrolled in hardware
 constexpr uint8_t ILI9488_MADCTL_LANDSCAPE = 0x28; // MV|BGR
 constexpr uint32_t SPI_SPEED_HZ_DEFAULT = 16000000;
 constexpr uint32_t SPI_SPEED_HZ_MAX = 24000000;
 constexpr size_t CHUNK_SIZE_DEFAULT = 1024;
+constexpr size_t SPIDEV_BUFSIZ_DEFAULT = 4096;
+// SPI_IOC_MESSAGE(N) encodes N * sizeof(spi_ioc_transfer) in the 14-bit ioctl size field
+constexpr size_t SPI_MSG_MAX_XFERS = ((1u << _IOC_SIZEBITS) - 1) / sizeof(spi_ioc_transfer);
+constexpr size_t XFER_BYTES_DEFAULT = 65532; // below the 16-bit length limit of common controllers
+constexpr size_t STAGE_ALIGN = 64;
+
+size_t read_spidev_bufsiz() {
+    FILE* f = std::fopen("/sys/module/spidev/parameters/bufsiz", "r");
+    if (!f) return SPIDEV_BUFSIZ_DEFAULT;
+    unsigned long v = 0;
+    bool ok = std::fscanf(f, "%lu", &v) == 1 && v > 0;
+    std::fclose(f);
+    return ok ? static_cast<size_t>(v) : SPIDEV_BUFSIZ_DEFAULT;
+}
 }
 
 ILI9488::ILI9488(const std::string& spi_device,
@@ -59,9 +77,16 @@ ILI9488::~ILI9488() {
             close(spi_fd_);
         }
     }
+    std::free(stage_);
 }
 
 bool ILI9488::Init() {
+    if (!Wake()) return false;
+    DisplayOn();
+    return true;
+}
+
+bool ILI9488::Wake() {
     if (!gpio_ready_) {
         std::cerr << "  GPIO not initialized, cannot init display" << std::endl << std::flush;
         return false;
@@ -78,15 +103,56 @@ bool ILI9488::Init() {
     uint8_t bits = 8;
     spi_speed_hz_ = static_cast<uint32_t>(getenv_int("ILI9488_SPI_SPEED_HZ", SPI_SPEED_HZ_DEFAULT));
     if (spi_speed_hz_ > SPI_SPEED_HZ_MAX) spi_speed_hz_ = SPI_SPEED_HZ_MAX;
+    format_ = SelectPixelFormat();
+    bpp_ = PixelFormatBytes(format_);
     chunk_size_bytes_ = static_cast<size_t>(getenv_int("ILI9488_SPI_CHUNK", static_cast<int>(CHUNK_SIZE_DEFAULT)));
-    if (chunk_size_bytes_ < 3) chunk_size_bytes_ = 3;
-    if (chunk_size_bytes_ % 3 != 0) {
-        chunk_size_bytes_ -= (chunk_size_bytes_ % 3);
-        if (chunk_size_bytes_ < 3) chunk_size_bytes_ = 3;
-    }
+    if (chunk_size_bytes_ < bpp_) chunk_size_bytes_ = bpp_;
+    chunk_size_bytes_ -= chunk_size_bytes_ % bpp_;
     throttle_us_ = static_cast<unsigned int>(getenv_int("ILI9488_SPI_THROTTLE_US", 0));
     uint32_t speed = spi_speed_hz_;
 
+    if (format_ == PixelFormat::RGB666) {
+        convert_ = SelectRgb565To666(&convert_name_);
+    } else {
+        // Commands stay 8-bit; the pixel transfers use 16-bit words if the
+        // controller takes them, so the frame buffer needs no conversion
+        word_bits_ = getenv_bool("ILI9488_SPI_WORD16", true) ? 16 : 8;
+        if (word_bits_ == 16) {
+            uint8_t bits16 = 16;
+            uint8_t bits8 = 8;
+            if (ioctl(spi_fd_, SPI_IOC_WR_BITS_PER_WORD, &bits16) == -1) {
+                std::cerr << "  SPI controller rejects 16-bit words, sending RGB565 byte-swapped" << std::endl << std::flush;
+                word_bits_ = 8;
+            }
+            ioctl(spi_fd_, SPI_IOC_WR_BITS_PER_WORD, &bits8);
+        }
+        convert_ = (word_bits_ == 16) ? Rgb565Copy : Rgb565ToBigEndian;
+        convert_name_ = (word_bits_ == 16) ? "copy" : "swap";
+    }
+
+    batch_enabled_ = getenv_bool("ILI9488_SPI_BATCH", true);
+    if (batch_enabled_) {
+        // spidev copies a whole message into its bounce buffer, so the sum of
+        // all entries in one ioctl must fit bufsiz. CS is released between
+        // ioctls, so each message has to end on a pixel boundary.
+        spidev_bufsiz_ = read_spidev_bufsiz();
+        batch_msg_bytes_ = spidev_bufsiz_ - (spidev_bufsiz_ % bpp_);
+        batch_xfer_bytes_ = static_cast<size_t>(getenv_int("ILI9488_SPI_XFER", static_cast<int>(XFER_BYTES_DEFAULT)));
+        batch_xfer_bytes_ = std::max<size_t>(bpp_, std::min(batch_xfer_bytes_, batch_msg_bytes_));
+        batch_xfer_bytes_ -= batch_xfer_bytes_ % bpp_; // 16-bit words need even lengths
+        batch_msg_bytes_ = std::min(batch_msg_bytes_, batch_xfer_bytes_ * SPI_MSG_MAX_XFERS);
+        batch_msg_bytes_ -= batch_msg_bytes_ % bpp_;
+
+        size_t frame_bytes = static_cast<size_t>(DISPLAY_WIDTH) * DISPLAY_HEIGHT * bpp_;
+        size_t stage_bytes = (frame_bytes + STAGE_ALIGN - 1) / STAGE_ALIGN * STAGE_ALIGN;
+        stage_ = static_cast<uint8_t*>(std::aligned_alloc(STAGE_ALIGN, stage_bytes));
+        if (!stage_ || batch_msg_bytes_ < bpp_) {
+            batch_enabled_ = false;
+        } else {
+            xfers_.assign((batch_msg_bytes_ + batch_xfer_bytes_ - 1) / batch_xfer_bytes_, spi_ioc_transfer{});
+        }
+    }
+
     std::cout << "  Setting SPI parameters..." << std::endl << std::flush;
     if (ioctl(spi_fd_, SPI_IOC_WR_MODE, &mode) == -1 ||
         ioctl(spi_fd_, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1 ||
@@ -100,7 +166,17 @@ bool ILI9488::Init() {
     std::cout << "  ILI9488: speed=" << spi_speed_hz_ << "Hz"
               << " chunk=" << chunk_size_bytes_ << "B"
               << " throttle=" << throttle_us_ << "us"
-              << " COLMOD=0x66"
+              << " batch=" << (batch_enabled_ ? "on" : "off");
+    if (batch_enabled_) {
+        std::cout << " bufsiz=" << spidev_bufsiz_ << "B"
+                  << " msg=" << batch_msg_bytes_ << "B"
+                  << " xfer=" << batch_xfer_bytes_ << "B";
+    }
+    std::cout
+              << " format=" << PixelFormatName(format_)
+              << " words=" << static_cast<int>(word_bits_)
+              << " kernel=" << convert_name_
+              << " COLMOD=0x" << std::hex << static_cast<int>(PixelFormatColmod(format_)) << std::dec
               << " MADCTL=0x28"
               << " size=" << DISPLAY_WIDTH << "x" << DISPLAY_HEIGHT
               << std::endl << std::flush;
@@ -116,32 +192,35 @@ bool ILI9488::Init() {
     }
     std::cout << "  Display reset." << std::endl << std::flush;
 
+    // Datasheet waits: 120 ms from SWRESET to SLPOUT, 5 ms after SLPOUT
+    // before the next command. COLMOD and MADCTL take effect at once.
     std::cout << "  Sending SWRESET..." << std::endl << std::flush;
     SendCommand(ILI9488_SWRESET);
-    usleep(150000);
+    usleep(120000);
 
     std::cout << "  Sending SLPOUT..." << std::endl << std::flush;
     SendCommand(ILI9488_SLPOUT);
-    usleep(120000);
+    usleep(5000);
 
-    std::cout << "  Sending COLMOD (RGB666)..." << std::endl << std::flush;
-    SendCommand(ILI9488_COLMOD, {ILI9488_PIXFMT_18BPP});
-    usleep(10000);
+    std::cout << "  Sending COLMOD (" << PixelFormatName(format_) << ")..." << std::endl << std::flush;
+    SendCommand(ILI9488_COLMOD, {PixelFormatColmod(format_)});
 
     std::cout << "  Sending MADCTL (landscape)..." << std::endl << std::flush;
     SendCommand(ILI9488_MADCTL, {ILI9488_MADCTL_LANDSCAPE});
-    usleep(10000);
 
+    is_initialized_ = true;
+    return true;
+}
+
+void ILI9488::DisplayOn() {
     std::cout << "  Sending DISPON..." << std::endl << std::flush;
     SendCommand(ILI9488_DISPON);
-    usleep(100000);
+    // One scan-out (~16 ms) before the backlight shows it
+    usleep(20000);
 
     std::cout << "  Enabling backlight..." << std::endl << std::flush;
     SetBacklight(true);
     std::cout << "  Backlight enabled." << std::endl << std::flush;
-
-    is_initialized_ = true;
-    return true;
 }
 
 void ILI9488::SendCommand(uint8_t cmd, const std::vector<uint8_t>& data) {
@@ -169,6 +248,7 @@ void ILI9488::Display(const std::vector<uint16_t>& buffer) {
 void ILI9488::UpdateRect(int x, int y, int w, int h, const uint16_t* rgb565, int stride_pixels) {
     if (!is_initialized_) return;
     if (!rgb565 || w <= 0 || h <= 0) return;
+    PROFILE_SCOPE("spi.rect");
 
     int x0 = std::max(0, x);
     int y0 = std::max(0, y);
@@ -179,14 +259,80 @@ void ILI9488::UpdateRect(int x, int y, int w, int h, const uint16_t* rgb565, int
     int rw = x1 - x0;
     int rh = y1 - y0;
 
+    if (batch_enabled_) {
+        if (UpdateRectBatched(x0, y0, rw, rh, rgb565, stride_pixels)) return;
+        // Driver rejected the batch (e.g. a controller with a smaller transfer
+        // limit): stay on per-chunk transfers from now on and resend the rect.
+        batch_enabled_ = false;
+    }
+    UpdateRectChunked(x0, y0, rw, rh, rgb565, stride_pixels);
+}
+
+bool ILI9488::UpdateRectBatched(int x0, int y0, int rw, int rh, const uint16_t* rgb565, int stride_pixels) {
+    // Convert the whole rect up front so the SPI loop only issues ioctls.
+    // Full-width rows of RGB565 in 16-bit words are sent from the frame itself.
+    const uint8_t* data = stage_;
+    if (word_bits_ == 16 && rw == stride_pixels) {
+        data = reinterpret_cast<const uint8_t*>(rgb565 + y0 * stride_pixels + x0);
+    } else {
+        uint8_t* out = stage_;
+        for (int row = 0; row < rh; ++row) {
+            const uint16_t* src = rgb565 + (y0 + row) * stride_pixels + x0;
+            convert_(src, out, static_cast<size_t>(rw));
+            out += static_cast<size_t>(rw) * bpp_;
+        }
+    }
+    const size_t total = static_cast<size_t>(rw) * rh * bpp_;
+
     SetWindow(static_cast<uint16_t>(x0),
               static_cast<uint16_t>(y0),
-              static_cast<uint16_t>(x1 - 1),
-              static_cast<uint16_t>(y1 - 1));
+              static_cast<uint16_t>(x0 + rw - 1),
+              static_cast<uint16_t>(y0 + rh - 1));
+    dc_line_.set_value(1);
+
+    size_t offset = 0;
+    size_t msg_index = 0;
+    while (offset < total) {
+        size_t msg_bytes = std::min(batch_msg_bytes_, total - offset);
+        unsigned int n = 0;
+        for (size_t pos = 0; pos < msg_bytes; pos += batch_xfer_bytes_, ++n) {
+            spi_ioc_transfer& tr = xfers_[n];
+            tr = spi_ioc_transfer{};
+            tr.tx_buf = (unsigned long)(data + offset + pos);
+            tr.len = static_cast<uint32_t>(std::min(batch_xfer_bytes_, msg_bytes - pos));
+            tr.speed_hz = spi_speed_hz_;
+            tr.bits_per_word = word_bits_;
+        }
+
+        if (ioctl(spi_fd_, SPI_IOC_MESSAGE(n), xfers_.data()) < static_cast<int>(msg_bytes)) {
+            std::cerr << "Failed to send batched SPI message: " << std::strerror(errno)
+                      << " msg=" << msg_index
+                      << " bytes=" << offset << "+" << msg_bytes
+                      << " xfers=" << n
+                      << " speed=" << spi_speed_hz_
+                      << ", falling back to chunked transfers"
+                      << std::endl << std::flush;
+            return false;
+        }
+
+        offset += msg_bytes;
+        ++msg_index;
+        if (throttle_us_ > 0) {
+            usleep(throttle_us_);
+        }
+    }
+    return true;
+}
+
+void ILI9488::UpdateRectChunked(int x0, int y0, int rw, int rh, const uint16_t* rgb565, int stride_pixels) {
+    SetWindow(static_cast<uint16_t>(x0),
+              static_cast<uint16_t>(y0),
+              static_cast<uint16_t>(x0 + rw - 1),
+              static_cast<uint16_t>(y0 + rh - 1));
 
     dc_line_.set_value(1);
 
-    const size_t chunk_pixels = std::max<size_t>(1, chunk_size_bytes_ / 3);
+    const size_t chunk_pixels = std::max<size_t>(1, chunk_size_bytes_ / bpp_);
     if (tx_buf_.capacity() < chunk_size_bytes_) {
         tx_buf_.reserve(chunk_size_bytes_);
     }
@@ -198,24 +344,15 @@ void ILI9488::UpdateRect(int x, int y, int w, int h, const uint16_t* rgb565, int
         int remaining = rw;
         while (remaining > 0) {
             size_t this_pixels = std::min(chunk_pixels, static_cast<size_t>(remaining));
-            size_t this_bytes = this_pixels * 3;
+            size_t this_bytes = this_pixels * bpp_;
             tx_buf_.resize(this_bytes);
-            uint8_t* out = tx_buf_.data();
-            for (size_t i = 0; i < this_pixels; ++i) {
-                uint16_t px = src[i];
-                uint8_t r5 = (px >> 11) & 0x1F;
-                uint8_t g6 = (px >> 5) & 0x3F;
-                uint8_t b5 = px & 0x1F;
-                out[i * 3 + 0] = static_cast<uint8_t>(r5 << 3);
-                out[i * 3 + 1] = static_cast<uint8_t>(g6 << 2);
-                out[i * 3 + 2] = static_cast<uint8_t>(b5 << 3);
-            }
+            convert_(src, tx_buf_.data(), this_pixels);
 
             struct spi_ioc_transfer tr = {};
             tr.tx_buf = (unsigned long)(tx_buf_.data());
             tr.len = this_bytes;
             tr.speed_hz = spi_speed_hz_;
-            tr.bits_per_word = 8;
+            tr.bits_per_word = word_bits_;
 
             if (ioctl(spi_fd_, SPI_IOC_MESSAGE(1), &tr) < 1) {
                 std::cerr << "Failed to send SPI message chunk: " << std::strerror(errno)
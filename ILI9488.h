@@ -5,12 +5,9 @@
 #include <string>
 #include <vector>
 #include <cstdint>
-
-// Display Configuration (landscape)
-const int DISPLAY_WIDTH = 480;
-const int DISPLAY_HEIGHT = 320;
-const int OFFSET_X = 0;
-const int OFFSET_Y = 0;
+#include <linux/spi/spidev.h>
+#include "PixelConvert.h"
+#include "DisplayConfig.h"
 
 // ILI9488 Commands
 const uint8_t ILI9488_SWRESET = 0x01;
@@ -30,17 +27,29 @@ public:
             const std::string& bl_chip_path, int bl_pin);
     ~ILI9488();
 
+    // Wake() then DisplayOn()
     bool Init();
+    // Opens SPI, resets the controller and leaves it out of sleep with the
+    // display still off: frames written now are shown by DisplayOn()
+    bool Wake();
+    // DISPON and backlight
+    void DisplayOn();
     void SendCommand(uint8_t cmd, const std::vector<uint8_t>& data = {});
     void SendData(const std::vector<uint8_t>& data);
     void Display(const std::vector<uint16_t>& buffer);
     void UpdateRect(int x, int y, int w, int h, const uint16_t* rgb565, int stride_pixels);
     void Clear(uint16_t color);
     void SetBacklight(bool on);
+    // Bytes per pixel on the wire for the selected ILI9488_PIXEL_FORMAT (after Init)
+    size_t BytesPerPixel() const { return bpp_; }
 
 private:
     void Reset();
     void SetWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+    // Whole rect converted into stage_, sent as SPI_IOC_MESSAGE(N) batches;
+    // false if the driver rejected the batch (caller falls back to chunks).
+    bool UpdateRectBatched(int x0, int y0, int rw, int rh, const uint16_t* rgb565, int stride_pixels);
+    void UpdateRectChunked(int x0, int y0, int rw, int rh, const uint16_t* rgb565, int stride_pixels);
 
     std::string spi_device_;
     int spi_fd_ = -1;
@@ -48,6 +57,19 @@ private:
     size_t chunk_size_bytes_ = 1024;
     unsigned int throttle_us_ = 0;
     std::vector<uint8_t> tx_buf_;
+    PixelConvertFn convert_ = Rgb565To666Scalar;
+    const char* convert_name_ = "scalar";
+    PixelFormat format_ = PixelFormat::RGB666; // ILI9488_PIXEL_FORMAT
+    size_t bpp_ = 3;                           // bytes per pixel on the wire
+    uint8_t word_bits_ = 8;                    // bits_per_word of pixel transfers
+
+    // Batched transfer path (ILI9488_SPI_BATCH)
+    bool batch_enabled_ = true;
+    size_t spidev_bufsiz_ = 4096;  // /sys/module/spidev/parameters/bufsiz
+    size_t batch_msg_bytes_ = 0;   // bytes per ioctl, <= bufsiz, whole pixels
+    size_t batch_xfer_bytes_ = 0;  // bytes per spi_ioc_transfer entry
+    uint8_t* stage_ = nullptr;     // full-frame staging buffer in the wire format, 64-byte aligned
+    std::vector<spi_ioc_transfer> xfers_;
 
     gpiod::chip dc_chip_;
     gpiod::line dc_line_;
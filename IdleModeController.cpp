@@ -3,35 +3,25 @@
 
 IdleModeController::IdleModeController()
     : idle_threshold_seconds(30.0),
+      idle_elapsed(0.0),
       _is_idle(false),
       idle_timer_running(false),
       transition_progress(0.0) {}
 
-bool IdleModeController::is_idle() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return _is_idle;
-}
-
-double IdleModeController::get_transition_progress() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return transition_progress;
-}
-
-void IdleModeController::update(const SystemMetrics& metrics, double dt) {
-    std::lock_guard<std::mutex> lock(mutex_);
+void IdleModeController::update(const MetricsSnapshot& metrics, double dt) {
     bool system_is_idle = (metrics.cpu_usage < 10.0 &&
                            metrics.temp < 50.0 &&
                            metrics.net1_mbps < 10.0 &&
                            metrics.net2_mbps < 10.0);
 
     if (system_is_idle) {
+        // Timed from dt rather than the wall clock so replayed sequences (bench) behave the same
         if (!idle_timer_running) {
-            idle_start_time = std::chrono::steady_clock::now();
+            idle_elapsed = 0.0;
             idle_timer_running = true;
         } else {
-            auto now = std::chrono::steady_clock::now();
-            double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(now - idle_start_time).count();
-            if (elapsed > idle_threshold_seconds) {
+            idle_elapsed += dt;
+            if (idle_elapsed > idle_threshold_seconds) {
                 _is_idle = true;
             }
         }
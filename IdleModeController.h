@@ -2,23 +2,21 @@
 #define IDLE_MODE_CONTROLLER_H
 
 #include "SystemMetrics.h"
-#include <chrono>
-#include <mutex>
 
+// Render thread only: no locking.
 class IdleModeController {
 public:
     IdleModeController();
 
     // Обновить состояние idle режима
-    void update(const SystemMetrics& metrics, double dt);
+    void update(const MetricsSnapshot& metrics, double dt);
 
-    bool is_idle() const;
-    double get_transition_progress() const;
+    bool is_idle() const { return _is_idle; }
+    double get_transition_progress() const { return transition_progress; }
 
 private:
-    mutable std::mutex mutex_;
     const double idle_threshold_seconds;
-    std::chrono::steady_clock::time_point idle_start_time;
+    double idle_elapsed; // seconds of quiet so far, accumulated from dt
     bool _is_idle;
     bool idle_timer_running;
     double transition_progress; // 0.0 = active, 1.0 = full idle
@@ -0,0 +1,195 @@
+#include "NetCounters.h"
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+
+namespace {
+constexpr auto REPROBE_INTERVAL = std::chrono::seconds(30);
+constexpr size_t NL_BUF_SIZE = 32768;
+
+bool ethtool_ioctl(int fd, const std::string& ifname, void* data) {
+    if (fd < 0 || ifname.size() >= IFNAMSIZ) return false;
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::memcpy(ifr.ifr_name, ifname.c_str(), ifname.size());
+    ifr.ifr_data = static_cast<char*>(data);
+    return ioctl(fd, SIOCETHTOOL, &ifr) == 0;
+}
+}
+
+NetCounters::NetCounters() {
+    ioctl_fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    nl_fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (nl_fd_ >= 0) {
+        sockaddr_nl local{};
+        local.nl_family = AF_NETLINK;
+        if (bind(nl_fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+            close(nl_fd_);
+            nl_fd_ = -1;
+        } else {
+            timeval tv{0, 200000};
+            setsockopt(nl_fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        }
+    }
+    nl_buf_.resize(NL_BUF_SIZE);
+}
+
+NetCounters::~NetCounters() {
+    if (ioctl_fd_ >= 0) close(ioctl_fd_);
+    if (nl_fd_ >= 0) close(nl_fd_);
+}
+
+void NetCounters::probeEthtool(const std::string& ifname, IfaceState& st) {
+    st.ethtool_ok = false;
+    st.rx_idx = -1;
+    st.tx_idx = -1;
+    st.ifindex = if_nametoindex(ifname.c_str());
+    st.next_probe = std::chrono::steady_clock::now() + REPROBE_INTERVAL;
+
+    struct ethtool_drvinfo drvinfo;
+    std::memset(&drvinfo, 0, sizeof(drvinfo));
+    drvinfo.cmd = ETHTOOL_GDRVINFO;
+    if (!ethtool_ioctl(ioctl_fd_, ifname, &drvinfo) || drvinfo.n_stats == 0) return;
+
+    const uint32_t n = drvinfo.n_stats;
+    std::vector<uint8_t> strings_buf(sizeof(struct ethtool_gstrings) + static_cast<size_t>(n) * ETH_GSTRING_LEN);
+    auto* strings = reinterpret_cast<struct ethtool_gstrings*>(strings_buf.data());
+    strings->cmd = ETHTOOL_GSTRINGS;
+    strings->string_set = ETH_SS_STATS;
+    strings->len = n;
+    if (!ethtool_ioctl(ioctl_fd_, ifname, strings)) return;
+
+    const uint32_t count = std::min(n, strings->len);
+    for (uint32_t i = 0; i < count; ++i) {
+        const char* name = reinterpret_cast<const char*>(strings->data + static_cast<size_t>(i) * ETH_GSTRING_LEN);
+        if (std::strncmp(name, "rx_octets", ETH_GSTRING_LEN) == 0) st.rx_idx = static_cast<int>(i);
+        if (std::strncmp(name, "tx_octets", ETH_GSTRING_LEN) == 0) st.tx_idx = static_cast<int>(i);
+    }
+    if (st.rx_idx < 0 || st.tx_idx < 0) return;
+
+    // struct ethtool_stats is {u32 cmd; u32 n_stats; u64 data[]}: one u64 header slot.
+    st.n_stats = n;
+    st.stats_buf.assign(static_cast<size_t>(n) + 1, 0);
+    st.ethtool_ok = true;
+}
+
+bool NetCounters::readEthtool(const std::string& ifname, IfaceState& st, uint64_t& rx, uint64_t& tx) {
+    auto* stats = reinterpret_cast<struct ethtool_stats*>(st.stats_buf.data());
+    stats->cmd = ETHTOOL_GSTATS;
+    stats->n_stats = st.n_stats;
+    if (!ethtool_ioctl(ioctl_fd_, ifname, stats) || stats->n_stats != st.n_stats) {
+        return false;
+    }
+    rx = stats->data[st.rx_idx];
+    tx = stats->data[st.tx_idx];
+    return true;
+}
+
+bool NetCounters::readNetlink(IfaceState& st, uint64_t& rx, uint64_t& tx) {
+    if (nl_fd_ < 0 || st.ifindex == 0) return false;
+
+    struct {
+        nlmsghdr nh;
+        ifinfomsg ifi;
+    } req;
+    std::memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(ifinfomsg));
+    req.nh.nlmsg_type = RTM_GETLINK;
+    req.nh.nlmsg_flags = NLM_F_REQUEST;
+    req.nh.nlmsg_seq = ++nl_seq_;
+    req.ifi.ifi_family = AF_UNSPEC;
+    req.ifi.ifi_index = static_cast<int>(st.ifindex);
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(nl_fd_, &req, req.nh.nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+        return false;
+    }
+
+    // Drain until our reply shows up (stale replies from a timed-out request may be queued)
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        ssize_t r = recv(nl_fd_, nl_buf_.data(), nl_buf_.size(), 0);
+        if (r <= 0) return false;
+        int len = static_cast<int>(r);
+        for (auto* nh = reinterpret_cast<nlmsghdr*>(nl_buf_.data());
+             NLMSG_OK(nh, len);
+             nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_seq != nl_seq_) continue;
+            if (nh->nlmsg_type == NLMSG_ERROR) return false;
+            if (nh->nlmsg_type != RTM_NEWLINK) continue;
+
+            auto* ifi = static_cast<ifinfomsg*>(NLMSG_DATA(nh));
+            int attr_len = static_cast<int>(IFLA_PAYLOAD(nh));
+            for (auto* rta = IFLA_RTA(ifi); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+                if (rta->rta_type == IFLA_STATS64 && RTA_PAYLOAD(rta) >= sizeof(rtnl_link_stats64)) {
+                    rtnl_link_stats64 s;
+                    std::memcpy(&s, RTA_DATA(rta), sizeof(s));
+                    rx = s.rx_bytes;
+                    tx = s.tx_bytes;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+bool NetCounters::ReadBytes(const std::string& ifname, uint64_t& rx, uint64_t& tx) {
+    auto it = ifaces_.find(ifname);
+    if (it == ifaces_.end()) {
+        it = ifaces_.emplace(ifname, IfaceState{}).first;
+        probeEthtool(ifname, it->second);
+    }
+    IfaceState& st = it->second;
+
+    if (st.ethtool_ok && readEthtool(ifname, st, rx, tx)) {
+        return true;
+    }
+    // Interface may have been renamed, reloaded or brought up later
+    if (std::chrono::steady_clock::now() >= st.next_probe) {
+        probeEthtool(ifname, st);
+        if (st.ethtool_ok && readEthtool(ifname, st, rx, tx)) {
+            return true;
+        }
+    }
+    return readNetlink(st, rx, tx);
+}
+
+int NetCounters::LinkSpeedMbps(const std::string& ifname) const {
+    // ETHTOOL_GLINKSETTINGS handshake: the first call reports the mask size.
+    // The request is followed by three link-mode bitmaps of nwords u32 each.
+    uint32_t buf[(sizeof(struct ethtool_link_settings) / 4) + 3 * 127];
+    auto* ls = reinterpret_cast<struct ethtool_link_settings*>(buf);
+    std::memset(buf, 0, sizeof(buf));
+    ls->cmd = ETHTOOL_GLINKSETTINGS;
+    if (ethtool_ioctl(ioctl_fd_, ifname, ls) && ls->link_mode_masks_nwords < 0) {
+        int8_t nwords = static_cast<int8_t>(-ls->link_mode_masks_nwords);
+        std::memset(buf, 0, sizeof(buf));
+        ls->cmd = ETHTOOL_GLINKSETTINGS;
+        ls->link_mode_masks_nwords = nwords;
+        if (ethtool_ioctl(ioctl_fd_, ifname, ls) && ls->link_mode_masks_nwords > 0) {
+            uint32_t speed = ls->speed;
+            if (speed == 0 || speed == static_cast<uint32_t>(SPEED_UNKNOWN)) return -1;
+            return static_cast<int>(speed);
+        }
+    }
+
+    struct ethtool_cmd ecmd;
+    std::memset(&ecmd, 0, sizeof(ecmd));
+    ecmd.cmd = ETHTOOL_GSET;
+    if (ethtool_ioctl(ioctl_fd_, ifname, &ecmd)) {
+        uint32_t speed = ethtool_cmd_speed(&ecmd);
+        if (speed == 0 || speed == static_cast<uint32_t>(SPEED_UNKNOWN)) return -1;
+        return static_cast<int>(speed);
+    }
+    return -1;
+}
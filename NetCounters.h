@@ -0,0 +1,54 @@
+#ifndef NET_COUNTERS_H
+#define NET_COUNTERS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdint>
+
+// Fork-free interface counters and link speed.
+//
+// Byte counters come from ETHTOOL_GSTATS (rx_octets/tx_octets, which stay
+// correct on r8125 where sysfs rx_bytes does not), falling back to
+// rtnl_link_stats64 over a persistent NETLINK_ROUTE socket. The stat-string
+// indices are looked up once per interface and the stats buffer is reused,
+// so a sample costs one or two syscalls.
+class NetCounters {
+public:
+    NetCounters();
+    ~NetCounters();
+
+    NetCounters(const NetCounters&) = delete;
+    NetCounters& operator=(const NetCounters&) = delete;
+
+    // Not thread-safe: call from one thread only (the fast probe thread).
+    bool ReadBytes(const std::string& ifname, uint64_t& rx, uint64_t& tx);
+
+    // Link speed in Mbps via ETHTOOL_GLINKSETTINGS (ETHTOOL_GSET fallback),
+    // -1 if unknown. Safe to call from another thread than ReadBytes.
+    int LinkSpeedMbps(const std::string& ifname) const;
+
+private:
+    struct IfaceState {
+        bool ethtool_ok = false;
+        uint32_t n_stats = 0;
+        int rx_idx = -1;
+        int tx_idx = -1;
+        unsigned int ifindex = 0;
+        std::vector<uint64_t> stats_buf; // struct ethtool_stats + n_stats u64
+        std::chrono::steady_clock::time_point next_probe;
+    };
+
+    void probeEthtool(const std::string& ifname, IfaceState& st);
+    bool readEthtool(const std::string& ifname, IfaceState& st, uint64_t& rx, uint64_t& tx);
+    bool readNetlink(IfaceState& st, uint64_t& rx, uint64_t& tx);
+
+    int ioctl_fd_ = -1;
+    int nl_fd_ = -1;
+    uint32_t nl_seq_ = 0;
+    std::vector<uint8_t> nl_buf_;
+    std::map<std::string, IfaceState> ifaces_;
+};
+
+#endif // NET_COUNTERS_H
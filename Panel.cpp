@@ -0,0 +1,359 @@
+#include "Panel.h"
+#include "HistoryStore.h"
+#include "RemoteMetrics.h"
+#include "Profiler.h"
+#include "utils.h"
+#include <algorithm>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+const int TARGET_FPS = getenv_int("LCD_FPS", 5);
+const int IDLE_FPS = getenv_int("LCD_IDLE_FPS", 3);
+const int MAX_FPS = getenv_int("LCD_MAX_FPS", 15);
+const int FRAME_MAX_SLEEP_MS = getenv_int("LCD_FRAME_MAX_SLEEP_MS", 1000);
+const int TILE_SIZE = getenv_int("LCD_DIRTY_TILE", 16);
+const int DIRTY_MAX_RECTS = getenv_int("LCD_DIRTY_MAX_RECTS", 8);
+const double FULL_FRAME_THRESHOLD = getenv_double("LCD_FULL_FRAME_THRESHOLD", 0.6);
+const int SPI_BUDGET_KB = getenv_int("LCD_SPI_BUDGET_KB", 0);
+const bool DISPLAY_ASYNC = getenv_bool("LCD_DISPLAY_ASYNC", true);
+
+std::string panel_env(int index, const char* key) {
+    return "LCD_PANEL" + std::to_string(index) + "_" + key;
+}
+
+// "chip:pin", e.g. /dev/gpiochip3:13
+bool parse_line(const std::string& s, std::string& chip, int& pin) {
+    const size_t colon = s.rfind(':');
+    if (colon == std::string::npos || colon == 0) return false;
+    try {
+        size_t used = 0;
+        pin = std::stoi(s.substr(colon + 1), &used);
+        if (used != s.size() - colon - 1 || pin < 0) return false;
+    } catch (...) {
+        return false;
+    }
+    chip = s.substr(0, colon);
+    return true;
+}
+
+size_t budget_px(const ILI9488& display) {
+    return static_cast<size_t>(std::max(0, SPI_BUDGET_KB)) * 1024 / display.BytesPerPixel();
+}
+}
+
+std::vector<PanelConfig> LoadPanelConfigs() {
+    // The wiring of the original single-panel build
+    const char* defaults[] = {"/dev/spidev0.0", "/dev/gpiochip3:13", "/dev/gpiochip3:14", "/dev/gpiochip1:2"};
+
+    std::vector<PanelConfig> panels;
+    for (int i = 0; i < PanelConfig::MAX_PANELS; ++i) {
+        PanelConfig c;
+        c.index = i;
+        c.spi_dev = getenv_string(panel_env(i, "SPI").c_str(), i == 0 ? defaults[0] : "");
+        if (c.spi_dev.empty()) continue;
+        const char* keys[] = {"DC", "RST", "BL"};
+        std::string* chips[] = {&c.dc_chip, &c.rst_chip, &c.bl_chip};
+        int* pins[] = {&c.dc_pin, &c.rst_pin, &c.bl_pin};
+        bool ok = true;
+        for (int k = 0; k < 3; ++k) {
+            const std::string name = panel_env(i, keys[k]);
+            const std::string v = getenv_string(name.c_str(), i == 0 ? defaults[k + 1] : "");
+            if (!parse_line(v, *chips[k], *pins[k])) {
+                std::cerr << "Panel " << i << ": " << name << " must be chip:pin (got \"" << v << "\"), skipped"
+                          << std::endl;
+                ok = false;
+                break;
+            }
+        }
+        if (!ok) continue;
+        c.source = getenv_string(panel_env(i, "SOURCE").c_str(), "local");
+        if (c.source.empty()) c.source = "local";
+        if (c.source != "local" && c.source.size() >= METRICS_HOST_LEN) {
+            c.source.resize(METRICS_HOST_LEN - 1); // as the sender truncates it
+        }
+        c.cpu = getenv_int(panel_env(i, "CPU").c_str(), -1);
+        panels.push_back(c);
+    }
+    return panels;
+}
+
+bool MetricsSource::Poll(MetricsSnapshot& view, uint64_t& seen) const {
+    if (local) return local->Poll(view, seen);
+    if (remote) return remote->Poll(host, view, seen);
+    return false;
+}
+
+PanelPipeline::PanelPipeline(const PanelConfig& config, const MetricsSource& source, PrinterClient* printer)
+    : config_(config),
+      source_(source),
+      printer_(printer),
+      tag_(config.index == 0 ? "" : "[" + std::to_string(config.index) + "]"),
+      display_(config.spi_dev, config.dc_chip, config.dc_pin, config.rst_chip, config.rst_pin,
+               config.bl_chip, config.bl_pin),
+      display_thread_(display_, DISPLAY_WIDTH, DISPLAY_HEIGHT, DIRTY_MAX_RECTS),
+      // Wakes the render loop on new data instead of polling at a fixed rate
+      scheduler_(std::max(TARGET_FPS, MAX_FPS), FRAME_MAX_SLEEP_MS),
+      dirty_tracker_(DISPLAY_WIDTH, DISPLAY_HEIGHT, TILE_SIZE, DIRTY_MAX_RECTS),
+      progressive_(DISPLAY_WIDTH, DISPLAY_HEIGHT, TILE_SIZE, 0, DIRTY_MAX_RECTS),
+      scene_(DISPLAY_WIDTH * DISPLAY_HEIGHT),
+      prev_(DISPLAY_WIDTH * DISPLAY_HEIGHT) {
+    anim_cpu_ = animator_.add("cpu");
+    anim_temp_ = animator_.add("temp");
+    anim_net1_ = animator_.add("net1");
+    anim_net2_ = animator_.add("net2");
+    if (printer_) {
+        const Rect box = renderer_.ThumbnailBox();
+        printer_->SetThumbBox(box.w, box.h);
+    }
+    invalidated_.reserve(8);
+    rects_.reserve(static_cast<size_t>(std::max(1, DIRTY_MAX_RECTS)));
+
+    // Metrics ticks for `lcd_bench --trace`: t,cpu,temp,mem,net1,net2
+    const std::string bench_record_path = getenv_string("LCD_BENCH_RECORD", "");
+    if (config_.index == 0 && !bench_record_path.empty()) {
+        bench_record_.open(bench_record_path, std::ios::app);
+    }
+}
+
+PanelPipeline::~PanelPipeline() {
+    Stop();
+}
+
+bool PanelPipeline::Init() {
+    std::cout << "Panel " << config_.index << ": " << config_.spi_dev << ", metrics from " << config_.source
+              << std::endl;
+    const auto init_start = std::chrono::steady_clock::now();
+
+    // The reset spends ~0.3 s in datasheet waits. Meanwhile this thread
+    // renders the first frame (rasterising its glyphs on the way) from the
+    // last values in the history file, or the bare layout without one.
+    bool awake = false;
+    std::thread wake([this, &awake] { awake = display_.Wake(); });
+    if (renderer_.LastKnown(metrics_)) {
+        animator_.snap(anim_cpu_, metrics_.cpu_usage);
+        animator_.snap(anim_temp_, metrics_.temp);
+        animator_.snap(anim_net1_, metrics_.net1_mbps);
+        animator_.snap(anim_net2_, metrics_.net2_mbps);
+    }
+    {
+        double time_sec = std::chrono::duration_cast<std::chrono::duration<double>>(
+                              init_start.time_since_epoch()).count();
+        const PrinterMetrics& printer_snapshot = printer_ ? printer_->Snapshot() : no_printer_;
+        renderer_.Render(metrics_, printer_snapshot, animator_, idle_controller_, time_sec, scene_, &invalidated_);
+    }
+    wake.join();
+    if (!awake) {
+        std::cerr << "Panel " << config_.index << ": failed to initialize display" << std::endl << std::flush;
+        return false;
+    }
+    // Into GRAM before DISPON, so the panel lights up with it
+    display_.Display(scene_);
+    display_.DisplayOn();
+    prev_ = scene_;
+    first_frame_ = false;
+    std::cout << "Panel " << config_.index << ": first frame after "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - init_start)
+                     .count()
+              << " ms" << std::endl;
+
+    // Busy frames go out in budgeted slices, most visible change first. The
+    // budget is in pixels, so it waits for Init() to pick the pixel format.
+    progressive_ = ProgressiveUpdate(DISPLAY_WIDTH, DISPLAY_HEIGHT, TILE_SIZE, budget_px(display_), DIRTY_MAX_RECTS);
+    if (progressive_.Enabled()) {
+        std::cout << "SPI budget" << tag_ << ": " << SPI_BUDGET_KB << " KB/frame (" << budget_px(display_)
+                  << " px)" << std::endl;
+    }
+    // SPI transfers run on their own thread so the next frame renders meanwhile
+    if (DISPLAY_ASYNC) {
+        display_thread_.Start();
+    }
+    return true;
+}
+
+void PanelPipeline::AttachHistory(HistoryStore& history, const std::string& path) {
+    if (!path.empty() && history.Open(path, renderer_.HistorySize())) {
+        renderer_.AttachHistory(&history);
+    }
+}
+
+void PanelPipeline::Start() {
+    if (running_) return;
+    running_ = true;
+    thread_ = std::thread(&PanelPipeline::run, this);
+}
+
+void PanelPipeline::Stop() {
+    if (!running_) return;
+    running_ = false;
+    scheduler_.Notify();
+    if (thread_.joinable()) thread_.join();
+    display_thread_.Stop();
+    display_.SetBacklight(false);
+}
+
+void PanelPipeline::ReloadLayout() {
+    reload_layout_ = true;
+    scheduler_.Notify();
+}
+
+void PanelPipeline::run() {
+    if (config_.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config_.cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            std::cerr << "Panel " << config_.index << ": cannot pin to CPU " << config_.cpu << std::endl;
+        }
+    }
+    record_start_ = std::chrono::steady_clock::now();
+    last_log_ = record_start_;
+    last_frame_time_ = record_start_;
+    while (running_) {
+        frame();
+    }
+}
+
+void PanelPipeline::frame() {
+    auto frame_start = std::chrono::steady_clock::now();
+    auto dt_duration = frame_start - last_frame_time_;
+    double dt = std::chrono::duration_cast<std::chrono::duration<double>>(dt_duration).count();
+    last_frame_time_ = frame_start;
+
+    if (reload_layout_.exchange(false) && renderer_.ReloadLayout() && printer_) {
+        const Rect box = renderer_.ThumbnailBox();
+        printer_->SetThumbBox(box.w, box.h);
+    }
+
+    bool metrics_updated = source_.Poll(metrics_, metrics_seen_);
+    if (metrics_updated) {
+        renderer_.UpdateHistories(metrics_);
+        renderer_.UpdateTickerText(metrics_);
+        if (bench_record_.is_open()) {
+            double t = std::chrono::duration_cast<std::chrono::duration<double>>(frame_start - record_start_).count();
+            bench_record_ << t << ',' << metrics_.cpu_usage << ',' << metrics_.temp << ','
+                          << metrics_.mem_percent << ',' << metrics_.net1_mbps << ','
+                          << metrics_.net2_mbps << '\n';
+        }
+    }
+
+    // Set animation targets
+    animator_.set_target(anim_cpu_, metrics_.cpu_usage);
+    animator_.set_target(anim_temp_, metrics_.temp);
+    animator_.set_target(anim_net1_, metrics_.net1_mbps);
+    animator_.set_target(anim_net2_, metrics_.net2_mbps);
+    animator_.step(dt);
+    idle_controller_.update(metrics_, dt);
+
+    auto render_start = std::chrono::steady_clock::now();
+    double time_sec = std::chrono::duration_cast<std::chrono::duration<double>>(frame_start.time_since_epoch()).count();
+    const PrinterMetrics& printer_snapshot = printer_ ? printer_->Snapshot() : no_printer_;
+    {
+        PROFILE_SCOPE("render.frame");
+        renderer_.Render(metrics_, printer_snapshot, animator_, idle_controller_, time_sec, scene_, &invalidated_);
+    }
+    // Regions held back by the SPI budget still differ from the panel
+    progressive_.TakeDeferred(invalidated_);
+    auto render_end = std::chrono::steady_clock::now();
+    render_time_acc_ += std::chrono::duration_cast<std::chrono::duration<double>>(render_end - render_start).count();
+    render_frames_++;
+
+    bool send_frame = false;
+    size_t dirty_area = 0;
+    const size_t screen_area = static_cast<size_t>(DISPLAY_WIDTH) * DISPLAY_HEIGHT;
+
+    if (first_frame_) {
+        send_frame = true;
+        dirty_area = screen_area;
+    } else if (!invalidated_.empty()) {
+        // Only the layers the renderer repainted can differ from the panel
+        PROFILE_SCOPE("dirty.compute");
+        dirty_area = dirty_tracker_.Compute(scene_.data(), prev_.data(), rects_, &invalidated_);
+        if (dirty_area > 0) {
+            double dirty_ratio = (screen_area > 0) ? (static_cast<double>(dirty_area) / screen_area) : 1.0;
+            if (dirty_ratio > FULL_FRAME_THRESHOLD || rects_.empty()) {
+                dirty_area = screen_area;
+            }
+            send_frame = true;
+        }
+    }
+
+    if (send_frame) {
+        bool full = first_frame_ || dirty_area == screen_area;
+        if (!first_frame_ && progressive_.Enabled()) {
+            if (full) rects_.assign(1, Rect{0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT});
+            if (progressive_.Limit(scene_.data(), prev_.data(), rects_)) {
+                full = false;
+                dirty_area = 0;
+                for (const auto& r : rects_) dirty_area += static_cast<size_t>(r.w) * r.h;
+            }
+        }
+        display_thread_.Submit(scene_, rects_, full);
+        last_dirty_area_ = dirty_area;
+
+        if (full) {
+            prev_ = scene_;
+        } else {
+            for (const auto& r : rects_) {
+                for (int y = r.y; y < r.y + r.h; ++y) {
+                    size_t off = static_cast<size_t>(y) * DISPLAY_WIDTH + r.x;
+                    std::copy_n(scene_.begin() + off, r.w, prev_.begin() + off);
+                }
+            }
+        }
+        first_frame_ = false;
+    }
+
+    // Values still converging, the idle fade running or a budgeted frame
+    // still catching up: full rate.
+    // Time-driven effects only: LCD_FPS / LCD_IDLE_FPS. Otherwise wait for data.
+    double fade = idle_controller_.get_transition_progress();
+    FrameScheduler::Demand demand = FrameScheduler::Demand::NONE;
+    if (animator_.settling() || (fade > 0.002 && fade < 0.998) || progressive_.Pending()) {
+        demand = FrameScheduler::Demand::MOTION;
+    } else if (renderer_.Animating()) {
+        demand = FrameScheduler::Demand::EFFECTS;
+    }
+    int effects_fps = idle_controller_.is_idle() ? std::max(1, IDLE_FPS) : TARGET_FPS;
+    scheduler_.Wait(demand, effects_fps);
+
+    logStats();
+}
+
+void PanelPipeline::logStats() {
+    auto now = std::chrono::steady_clock::now();
+    auto log_elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_log_).count();
+    if (log_elapsed < 5) return;
+    double sec = static_cast<double>(log_elapsed);
+    DisplayThread::Stats spi = display_thread_.TakeStats();
+    double fps_render = render_frames_ / sec;
+    double fps_spi = spi.frames / sec;
+    double dirty_pct = 0.0;
+    size_t screen_area = static_cast<size_t>(DISPLAY_WIDTH) * DISPLAY_HEIGHT;
+    if (screen_area > 0) {
+        dirty_pct = 100.0 * static_cast<double>(last_dirty_area_) / screen_area;
+    }
+    std::cerr << "LCD PERF" << tag_ << ": render_fps=" << fps_render
+              << " spi_fps=" << fps_spi
+              << " bytes_5s=" << spi.bytes
+              << " dirty_rects=" << spi.last_rects
+              << " dirty_pct=" << dirty_pct
+              << " render_ms=" << (render_time_acc_ * 1000.0)
+              << " spi_ms=" << (spi.spi_seconds * 1000.0)
+              << " merged=" << spi.merged
+              << " blocked=" << spi.blocked
+              << std::endl;
+    if (source_.remote) {
+        // A silent host leaves its last values on screen
+        const int64_t age = source_.remote->AgeMs(source_.host);
+        if (age < 0 || age > 10000) {
+            std::cerr << "Panel " << config_.index << ": no metrics from " << source_.host
+                      << (age < 0 ? " yet" : " for " + std::to_string(age / 1000) + "s") << std::endl;
+        }
+    }
+    render_time_acc_ = 0.0;
+    render_frames_ = 0;
+    last_log_ = now;
+}
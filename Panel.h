@@ -0,0 +1,131 @@
+#ifndef PANEL_H
+#define PANEL_H
+
+#include "ILI9488.h"
+#include "SystemMetrics.h"
+#include "Renderer.h"
+#include "PrinterClient.h"
+#include "AnimationEngine.h"
+#include "IdleModeController.h"
+#include "DisplayThread.h"
+#include "DirtyTracker.h"
+#include "ProgressiveUpdate.h"
+#include "FrameScheduler.h"
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class HistoryStore;
+class MetricsListener;
+
+// One panel: its wiring, what it shows and where it renders.
+//
+// Panel 0 is the original wiring (spidev0.0, DC/RST on gpiochip3 13/14,
+// backlight gpiochip1 2); each LCD_PANEL0_* variable overrides a part of it.
+// Panels 1..3 are added with LCD_PANEL<N>_SPI and need all their pins:
+//   LCD_PANEL1_SPI=/dev/spidev1.0
+//   LCD_PANEL1_DC=/dev/gpiochip3:15  LCD_PANEL1_RST=...  LCD_PANEL1_BL=...
+//   LCD_PANEL1_SOURCE=local | <host pushed to LCD_METRICS_PORT>
+//   LCD_PANEL1_CPU=6   (pin the panel's render thread; -1 = any core)
+struct PanelConfig {
+    static constexpr int MAX_PANELS = 4;
+
+    int index = 0;
+    std::string spi_dev;
+    std::string dc_chip, rst_chip, bl_chip;
+    int dc_pin = -1, rst_pin = -1, bl_pin = -1;
+    std::string source = "local";
+    int cpu = -1;
+};
+
+// Reads the LCD_PANEL<N>_* variables. Panels with bad settings are reported
+// and left out; an empty LCD_PANEL0_SPI leaves panel 0 out (push-only box).
+std::vector<PanelConfig> LoadPanelConfigs();
+
+// Where a panel's metrics come from: this host's probes or a pushed host
+struct MetricsSource {
+    const SystemMetrics* local = nullptr;
+    const MetricsListener* remote = nullptr;
+    std::string host; // remote only
+
+    bool Poll(MetricsSnapshot& view, uint64_t& seen) const;
+};
+
+// Display, renderer and frame loop of one panel. The loop runs on the
+// panel's own thread, so panels render in parallel; metrics are collected
+// once (SystemMetrics, MetricsListener) and each panel polls its source,
+// keeping its own copy. The primary panel also shows the print screen and
+// owns the persisted history.
+class PanelPipeline {
+public:
+    PanelPipeline(const PanelConfig& config, const MetricsSource& source, PrinterClient* printer);
+    ~PanelPipeline();
+
+    PanelPipeline(const PanelPipeline&) = delete;
+    PanelPipeline& operator=(const PanelPipeline&) = delete;
+
+    // Brings the panel up showing a first frame and starts its SPI thread;
+    // false if the panel failed. Panels may be brought up in parallel.
+    bool Init();
+    // Opens the persisted graph history for this panel's renderer (one
+    // panel only: it records the local metrics). Before Init(), so the
+    // first frame shows the last known values.
+    void AttachHistory(HistoryStore& history, const std::string& path);
+    // eventfd for the producers feeding this panel (metrics, printer)
+    int WakeFd() const { return scheduler_.WakeFd(); }
+
+    void Start();
+    void Stop(); // also blanks the backlight
+
+    // Re-read LCD_LAYOUT_FILE before the next frame (SIGHUP)
+    void ReloadLayout();
+
+private:
+    void run();
+    void frame();
+    void logStats();
+
+    PanelConfig config_;
+    MetricsSource source_;
+    PrinterClient* printer_; // nullptr: no print screen on this panel
+    std::string tag_;        // "" for panel 0, "[N]" in the log otherwise
+
+    ILI9488 display_;
+    DisplayThread display_thread_;
+    FrameScheduler scheduler_;
+    Renderer renderer_;
+    AnimationEngine animator_;
+    AnimationEngine::Handle anim_cpu_, anim_temp_, anim_net1_, anim_net2_;
+    IdleModeController idle_controller_;
+    DirtyTracker dirty_tracker_;
+    ProgressiveUpdate progressive_;
+
+    MetricsSnapshot metrics_; // this panel's copy of its source
+    uint64_t metrics_seen_ = 0;
+    PrinterMetrics no_printer_;
+
+    // scene is the renderer's retained frame; prev mirrors what the panel shows
+    std::vector<uint16_t> scene_;
+    std::vector<uint16_t> prev_;
+    std::vector<Rect> invalidated_;
+    std::vector<Rect> rects_;
+    bool first_frame_ = true;
+
+    // Metrics ticks for `lcd_bench --trace` (primary panel)
+    std::ofstream bench_record_;
+    std::chrono::steady_clock::time_point record_start_;
+
+    std::chrono::steady_clock::time_point last_frame_time_;
+    std::chrono::steady_clock::time_point last_log_;
+    double render_time_acc_ = 0.0;
+    int render_frames_ = 0;
+    size_t last_dirty_area_ = 0;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> reload_layout_{false};
+};
+
+#endif // PANEL_H
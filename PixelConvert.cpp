@@ -0,0 +1,137 @@
+#include "PixelConvert.h"
+#include "utils.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+#if defined(PIXEL_CONVERT_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+void Rgb565To666Scalar(const uint16_t* src, uint8_t* dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i) {
+        uint16_t px = src[i];
+        uint8_t r5 = (px >> 11) & 0x1F;
+        uint8_t g6 = (px >> 5) & 0x3F;
+        uint8_t b5 = px & 0x1F;
+        dst[i * 3 + 0] = static_cast<uint8_t>(r5 << 3);
+        dst[i * 3 + 1] = static_cast<uint8_t>(g6 << 2);
+        dst[i * 3 + 2] = static_cast<uint8_t>(b5 << 3);
+    }
+}
+
+namespace {
+// R = high byte & 0xF8, G = (px >> 3) & 0xFC, B = (px << 3) & 0xF8,
+// returned as the three output bytes in the low 24 bits.
+inline uint32_t pack666(uint32_t px) {
+    return ((px >> 8) & 0xF8) | (((px >> 3) & 0xFC) << 8) | (((px << 3) & 0xF8) << 16);
+}
+}
+
+void Rgb565To666Generic(const uint16_t* src, uint8_t* dst, size_t pixels) {
+    size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Four pixels become three 32-bit stores instead of twelve byte stores
+    for (; i + 4 <= pixels; i += 4) {
+        uint32_t p0 = pack666(src[i]);
+        uint32_t p1 = pack666(src[i + 1]);
+        uint32_t p2 = pack666(src[i + 2]);
+        uint32_t p3 = pack666(src[i + 3]);
+        uint32_t w0 = p0 | (p1 << 24);
+        uint32_t w1 = (p1 >> 8) | (p2 << 16);
+        uint32_t w2 = (p2 >> 16) | (p3 << 8);
+        std::memcpy(dst + i * 3 + 0, &w0, 4);
+        std::memcpy(dst + i * 3 + 4, &w1, 4);
+        std::memcpy(dst + i * 3 + 8, &w2, 4);
+    }
+#endif
+    Rgb565To666Scalar(src + i, dst + i * 3, pixels - i);
+}
+
+#if defined(PIXEL_CONVERT_HAVE_NEON)
+void Rgb565To666Neon(const uint16_t* src, uint8_t* dst, size_t pixels) {
+    const uint8x16_t mask_rb = vdupq_n_u8(0xF8);
+    const uint8x16_t mask_g = vdupq_n_u8(0xFC);
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint16x8_t lo = vld1q_u16(src + i);
+        uint16x8_t hi = vld1q_u16(src + i + 8);
+        uint8x16x3_t rgb;
+        rgb.val[0] = vandq_u8(vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)), mask_rb);
+        rgb.val[1] = vandq_u8(vcombine_u8(vshrn_n_u16(lo, 3), vshrn_n_u16(hi, 3)), mask_g);
+        rgb.val[2] = vcombine_u8(vmovn_u16(vshlq_n_u16(lo, 3)), vmovn_u16(vshlq_n_u16(hi, 3)));
+        vst3q_u8(dst + i * 3, rgb);
+    }
+    Rgb565To666Scalar(src + i, dst + i * 3, pixels - i);
+}
+#endif
+
+bool VerifyRgb565To666(PixelConvertFn fn) {
+    constexpr size_t N = 65536;
+    std::vector<uint16_t> src(N + 1);
+    for (size_t i = 0; i < N; ++i) src[i] = static_cast<uint16_t>(i);
+    src[N] = 0xFFFF;
+    std::vector<uint8_t> ref((N + 1) * 3), out((N + 1) * 3);
+
+    // Full run, then odd offsets/lengths so SIMD heads and tails are covered
+    const size_t cases[][2] = {{0, N}, {1, N - 1}, {3, 37}, {5, 15}, {7, 1}, {0, 0}};
+    for (const auto& c : cases) {
+        const size_t off = c[0], len = c[1];
+        std::memset(ref.data(), 0xA5, ref.size());
+        std::memset(out.data(), 0xA5, out.size());
+        Rgb565To666Scalar(src.data() + off, ref.data() + off * 3, len);
+        fn(src.data() + off, out.data() + off * 3, len);
+        if (std::memcmp(ref.data(), out.data(), ref.size()) != 0) return false;
+    }
+    return true;
+}
+
+PixelConvertFn SelectRgb565To666(const char** name) {
+    std::string want = getenv_string("ILI9488_PIXEL_KERNEL", "auto");
+
+    struct Candidate {
+        const char* name;
+        PixelConvertFn fn;
+    };
+    const Candidate candidates[] = {
+#if defined(PIXEL_CONVERT_HAVE_NEON)
+        {"neon", Rgb565To666Neon},
+#endif
+        {"generic", Rgb565To666Generic},
+    };
+
+    PixelConvertFn chosen = Rgb565To666Scalar;
+    const char* chosen_name = "scalar";
+    if (want != "scalar") {
+        for (const auto& c : candidates) {
+            if (want != "auto" && want != c.name) continue;
+            if (VerifyRgb565To666(c.fn)) {
+                chosen = c.fn;
+                chosen_name = c.name;
+                break;
+            }
+            std::cerr << "  PixelConvert: " << c.name << " kernel mismatches scalar reference, skipped" << std::endl;
+        }
+    }
+    if (name) *name = chosen_name;
+    return chosen;
+}
+
+PixelFormat SelectPixelFormat() {
+    std::string want = getenv_string("ILI9488_PIXEL_FORMAT", "rgb666");
+    if (want == "rgb565") return PixelFormat::RGB565;
+    if (want != "rgb666") {
+        std::cerr << "  PixelConvert: unknown ILI9488_PIXEL_FORMAT=" << want << ", using rgb666" << std::endl;
+    }
+    return PixelFormat::RGB666;
+}
+
+void Rgb565Copy(const uint16_t* src, uint8_t* dst, size_t pixels) {
+    std::memcpy(dst, src, pixels * sizeof(uint16_t));
+}
+
+void Rgb565ToBigEndian(const uint16_t* src, uint8_t* dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i) {
+        dst[i * 2 + 0] = static_cast<uint8_t>(src[i] >> 8);
+        dst[i * 2 + 1] = static_cast<uint8_t>(src[i]);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// RGB565 -> RGB666 (one byte per channel, 2 low bits zero) packing for the
+// ILI9488 18 bpp SPI stream.
+//
+// Three kernels share one signature: the scalar reference (the original
+// per-pixel shifts), a portable unrolled version, and NEON when the compiler
+// targets it. SelectRgb565To666() picks one at startup (ILI9488_PIXEL_KERNEL=
+// auto|neon|generic|scalar) and checks it bit-for-bit against the reference
+// over all 65536 inputs before handing it out.
+using PixelConvertFn = void (*)(const uint16_t* src, uint8_t* dst, size_t pixels);
+
+void Rgb565To666Scalar(const uint16_t* src, uint8_t* dst, size_t pixels);
+void Rgb565To666Generic(const uint16_t* src, uint8_t* dst, size_t pixels);
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXEL_CONVERT_HAVE_NEON 1
+void Rgb565To666Neon(const uint16_t* src, uint8_t* dst, size_t pixels);
+#endif
+
+// True if fn matches Rgb565To666Scalar for every RGB565 value and for
+// unaligned heads/tails.
+bool VerifyRgb565To666(PixelConvertFn fn);
+
+// name receives the chosen kernel ("neon", "generic" or "scalar").
+PixelConvertFn SelectRgb565To666(const char** name = nullptr);
+
+// Pixel stream format on the wire (ILI9488_PIXEL_FORMAT=rgb666|rgb565).
+// RGB666 is the only 4-wire SPI format of the common modules. Boards with
+// a 16-bit front end take RGB565 (COLMOD 0x55): with 16-bit SPI words the
+// frame buffer goes out as is, otherwise byte-swapped into 8-bit words.
+enum class PixelFormat : uint8_t { RGB666, RGB565 };
+
+PixelFormat SelectPixelFormat();
+inline size_t PixelFormatBytes(PixelFormat f) { return f == PixelFormat::RGB565 ? 2 : 3; }
+inline uint8_t PixelFormatColmod(PixelFormat f) { return f == PixelFormat::RGB565 ? 0x55 : 0x66; }
+inline const char* PixelFormatName(PixelFormat f) { return f == PixelFormat::RGB565 ? "rgb565" : "rgb666"; }
+
+// RGB565 for 16-bit SPI words (native order) and for 8-bit words (high byte first)
+void Rgb565Copy(const uint16_t* src, uint8_t* dst, size_t pixels);
+void Rgb565ToBigEndian(const uint16_t* src, uint8_t* dst, size_t pixels);
+
+#endif // PIXEL_CONVERT_H
@@ -2,12 +2,18 @@
 #include "utils.h"
 #include "json.hpp"
 #include "stb_image.h"
+#include "WebSocketClient.h"
 #include <curl/curl.h>
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <unistd.h>
 
 using json = nlohmann::json;
 
@@ -18,14 +24,6 @@ static size_t write_string_cb(void* contents, size_t size, size_t nmemb, void* u
     return total;
 }
 
-static size_t write_bin_cb(void* contents, size_t size, size_t nmemb, void* userp) {
-    size_t total = size * nmemb;
-    auto* vec = static_cast<std::vector<unsigned char>*>(userp);
-    auto* c = static_cast<unsigned char*>(contents);
-    vec->insert(vec->end(), c, c + total);
-    return total;
-}
-
 static double steady_seconds() {
     auto now = std::chrono::steady_clock::now().time_since_epoch();
     return std::chrono::duration_cast<std::chrono::duration<double>>(now).count();
@@ -64,6 +62,8 @@ static std::string url_encode_path(const std::string& s) {
 PrinterClient::PrinterClient(const std::string& base_url)
     : base_url_(base_url) {
     poll_ms_ = getenv_int("LCD_PRINTER_POLL_MS", 5000);
+    use_ws_ = getenv_string("LCD_PRINTER_MODE", "ws") != "poll";
+    debug_ = getenv_bool("LCD_DEBUG", false);
     curl_global_init(CURL_GLOBAL_DEFAULT);
 }
 
@@ -84,132 +84,320 @@ void PrinterClient::Stop() {
     if (worker_.joinable()) worker_.join();
 }
 
-PrinterMetrics PrinterClient::GetSnapshot() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return metrics_;
+void PrinterClient::wake() const {
+    if (wake_fd_ < 0) return;
+    uint64_t one = 1;
+    ssize_t r = write(wake_fd_, &one, sizeof(one));
+    (void)r;
+}
+
+void PrinterClient::publish() {
+    snapshot_.Back() = metrics_;
+    snapshot_.Publish();
+    wake();
+}
+
+const PrinterMetrics& PrinterClient::Snapshot() {
+    snapshot_.Update();
+    return snapshot_.Front();
+}
+
+namespace {
+// Fields of print_stats / virtual_sdcard in a query result or a
+// notify_status_update diff; absent fields keep their previous value
+void merge_status(const json& status, PrinterClient::JobStatus& job) {
+    if (!status.is_object()) return;
+    auto ps = status.find("print_stats");
+    if (ps != status.end() && ps->is_object()) {
+        if (ps->contains("state") && (*ps)["state"].is_string()) job.state = (*ps)["state"].get<std::string>();
+        if (ps->contains("filename") && (*ps)["filename"].is_string()) job.filename = (*ps)["filename"].get<std::string>();
+        if (ps->contains("print_duration") && (*ps)["print_duration"].is_number()) job.elapsed = (*ps)["print_duration"].get<double>();
+    }
+    auto vsd = status.find("virtual_sdcard");
+    if (vsd != status.end() && vsd->is_object()) {
+        if (vsd->contains("progress") && (*vsd)["progress"].is_number()) job.progress = (*vsd)["progress"].get<double>();
+    }
+}
+
+// "http://host[:port][/...]" -> host, port. https is not supported for the websocket.
+bool parse_http_url(const std::string& url, std::string& host, int& port) {
+    const std::string scheme = "http://";
+    if (url.compare(0, scheme.size(), scheme) != 0) return false;
+    std::string rest = url.substr(scheme.size());
+    rest = rest.substr(0, rest.find('/'));
+    size_t colon = rest.rfind(':');
+    port = 80;
+    if (colon != std::string::npos) {
+        port = std::atoi(rest.c_str() + colon + 1);
+        rest.resize(colon);
+    }
+    host = rest;
+    return !host.empty() && port > 0;
+}
+
+struct ResponseHeaders {
+    std::string etag;
+    std::string last_modified;
+};
+
+size_t header_cb(char* buffer, size_t size, size_t nitems, void* userp) {
+    size_t total = size * nitems;
+    auto* h = static_cast<ResponseHeaders*>(userp);
+    std::string line(buffer, total);
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) line.pop_back();
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        *h = ResponseHeaders{}; // new response (redirect): forget the previous one's headers
+        return total;
+    }
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) return total;
+    std::string name = line.substr(0, colon);
+    for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    size_t v = line.find_first_not_of(' ', colon + 1);
+    std::string value = (v == std::string::npos) ? std::string() : line.substr(v);
+    if (name == "etag") h->etag = value;
+    else if (name == "last-modified") h->last_modified = value;
+    return total;
+}
+
+constexpr int SUBSCRIBE_ID = 4210;
+const char* SUBSCRIBE_REQUEST =
+    "{\"jsonrpc\":\"2.0\",\"method\":\"printer.objects.subscribe\",\"id\":4210,"
+    "\"params\":{\"objects\":{\"print_stats\":[\"state\",\"filename\",\"print_duration\"],"
+    "\"virtual_sdcard\":[\"progress\"]}}}";
 }
 
-bool PrinterClient::httpGet(const std::string& url, std::string& out) const {
-    CURL* curl = curl_easy_init();
-    if (!curl) return false;
+PrinterClient::Fetch PrinterClient::httpGet(const std::string& url, std::string& out, long timeout_s,
+                                            HttpCache* cache) {
     out.clear();
+    if (!curl_) curl_ = curl_easy_init();
+    CURL* curl = static_cast<CURL*>(curl_);
+    if (!curl) return Fetch::FAILED;
+    // Reset drops the options but keeps the connection cache, so the TCP
+    // connection to Moonraker is reused between requests
+    curl_easy_reset(curl);
+    ResponseHeaders headers;
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_string_cb);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &out);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_cb);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headers);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_s);
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 3L);
     curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    curl_slist* req_headers = nullptr;
+    if (cache && cache->url == url) {
+        if (!cache->etag.empty()) {
+            req_headers = curl_slist_append(req_headers, ("If-None-Match: " + cache->etag).c_str());
+        }
+        if (!cache->last_modified.empty()) {
+            req_headers = curl_slist_append(req_headers, ("If-Modified-Since: " + cache->last_modified).c_str());
+        }
+        if (req_headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req_headers);
+    }
     CURLcode res = curl_easy_perform(curl);
     long code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
-    curl_easy_cleanup(curl);
-    return (res == CURLE_OK && code == 200);
+    if (req_headers) curl_slist_free_all(req_headers);
+
+    if (res == CURLE_OK && code == 304 && cache && cache->url == url) {
+        out = cache->body;
+        return Fetch::NOT_MODIFIED;
+    }
+    if (res != CURLE_OK || code != 200 || out.empty()) return Fetch::FAILED;
+    if (cache) {
+        cache->url = url;
+        cache->etag = headers.etag;
+        cache->last_modified = headers.last_modified;
+        if (cache->keep_body) cache->body = out;
+    }
+    return Fetch::OK;
 }
 
-bool PrinterClient::httpGetBinary(const std::string& url, std::vector<unsigned char>& out) const {
-    CURL* curl = curl_easy_init();
-    if (!curl) return false;
-    out.clear();
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_bin_cb);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &out);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 8L);
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 3L);
-    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-    CURLcode res = curl_easy_perform(curl);
-    long code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
-    curl_easy_cleanup(curl);
-    return (res == CURLE_OK && code == 200 && !out.empty());
+void PrinterClient::SetThumbBox(int w, int h) {
+    const uint32_t box = static_cast<uint32_t>(std::clamp(w, 0, 0xffff)) << 16 |
+                         static_cast<uint32_t>(std::clamp(h, 0, 0xffff));
+    if (thumb_box_.exchange(box) != box) thumb_box_changed_ = true;
 }
 
-void PrinterClient::worker() {
+void PrinterClient::checkThumbBox() {
+    if (thumb_box_changed_.exchange(false) && !last_filename_.empty()) refreshThumbnail();
+}
+
+void PrinterClient::sleepMs(int ms) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (running_ && !thumb_box_changed_ && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+void PrinterClient::applyJob() {
+    PrinterState state = printer_state_from(job_.state);
+    bool active = (state == PrinterState::PRINTING || state == PrinterState::PAUSED);
+    bool started = active && !metrics_.active;
+    double now = steady_seconds();
+
+    int eta = -1;
+    if (job_.progress > 0.03 && job_.elapsed > 5.0) {
+        double total = job_.elapsed / job_.progress;
+        double rem = total - job_.elapsed;
+        if (rem > 0) eta = static_cast<int>(rem);
+    }
+
+    metrics_.state = state;
+    metrics_.filename = job_.filename;
+    metrics_.progress01 = static_cast<float>(job_.progress);
+    metrics_.elapsed_sec = static_cast<int>(job_.elapsed);
+    metrics_.eta_sec = eta;
+    metrics_.active = active;
+    if (active) {
+        metrics_.had_job = true;
+        metrics_.last_active_ts = now;
+    }
+    publish();
+
+    // A re-uploaded file keeps its name: re-validate on every job start too
+    if (!job_.filename.empty() && (job_.filename != last_filename_ || started)) {
+        last_filename_ = job_.filename;
+        refreshThumbnail();
+    }
+}
+
+void PrinterClient::refreshThumbnail() {
+    const uint32_t box = thumb_box_.load();
+    const int box_w = static_cast<int>(box >> 16);
+    const int box_h = static_cast<int>(box & 0xffff);
+    if (box_w <= 0 || box_h <= 0) return; // no panel shows it
+    // A thumbnail fitted to an older layout counts as missing
+    const bool held = metrics_.thumb && thumb_scaled_ == box;
+
+    std::string meta_body;
+    std::string meta_url = base_url_ + "/server/files/metadata?filename=" + url_encode_query(last_filename_);
+    Fetch meta = httpGet(meta_url, meta_body, 5L, &meta_cache_);
+    if (meta == Fetch::FAILED) return;
+    if (meta == Fetch::NOT_MODIFIED && held) return;
+
+    auto jm = json::parse(meta_body, nullptr, false);
+    if (jm.is_discarded()) return;
+    auto thumbs = jm["result"]["thumbnails"];
+    int best_area = -1;
+    std::string best_rel;
+    for (auto& th : thumbs) {
+        int w = th.value("width", 0);
+        int h = th.value("height", 0);
+        int area = w * h;
+        if (area > best_area) {
+            best_area = area;
+            best_rel = th.value("relative_path", "");
+        }
+    }
+    if (best_rel.empty()) {
+        if (metrics_.thumb) {
+            metrics_.thumb.reset();
+            metrics_.thumb_relpath.clear();
+            thumb_cache_ = HttpCache{};
+            publish();
+        }
+        return;
+    }
+
+    std::string thumb_url = base_url_ + "/server/files/gcodes/" + url_encode_path(best_rel);
+    std::string png;
+    Fetch fetch = httpGet(thumb_url, png, 8L, &thumb_cache_);
+    if (fetch == Fetch::NOT_MODIFIED) {
+        if (held && metrics_.thumb_relpath == best_rel) return;
+        // The validators are of a preview no longer held (e.g. the job went
+        // back to an earlier file): the body is not kept, so fetch it whole
+        thumb_cache_ = HttpCache{};
+        fetch = httpGet(thumb_url, png, 8L, &thumb_cache_);
+    }
+    if (fetch != Fetch::OK) return;
+    int w = 0, h = 0, ch = 0;
+    unsigned char* img = stbi_load_from_memory(reinterpret_cast<const unsigned char*>(png.data()),
+                                               static_cast<int>(png.size()), &w, &h, &ch, 4);
+    if (img && w > 0 && h > 0) {
+        // Only the converted preview is kept, not the decoded RGBA
+        metrics_.thumb = Thumbnail565::FromRGBA(img, w, h, box_w, box_h);
+        metrics_.thumb_relpath = best_rel;
+        thumb_scaled_ = box;
+        publish();
+    } else {
+        thumb_cache_ = HttpCache{}; // a 304 must not pin an image that failed to decode
+    }
+    if (img) stbi_image_free(img);
+}
+
+bool PrinterClient::pollOnce() {
+    std::string body;
+    std::string url = base_url_ + "/printer/objects/query?print_stats&virtual_sdcard";
+    if (httpGet(url, body, 5L) != Fetch::OK) return false;
+    auto j = json::parse(body, nullptr, false);
+    if (j.is_discarded()) return false;
+    merge_status(j["result"]["status"], job_);
+    applyJob();
+    return true;
+}
+
+bool PrinterClient::runWebSocket() {
+    std::string host;
+    int port = 0;
+    if (!parse_http_url(base_url_, host, port)) return false;
+    WebSocketClient ws;
+    if (!ws.Connect(host, port, "/websocket", 3000) || !ws.SendText(SUBSCRIBE_REQUEST)) return false;
+
+    bool subscribed = false;
+    std::string msg;
     while (running_) {
-        std::string body;
-        std::string url = base_url_ + "/printer/objects/query?print_stats&virtual_sdcard";
-        if (httpGet(url, body)) {
-            auto j = json::parse(body, nullptr, false);
-            if (!j.is_discarded()) {
-                auto status = j["result"]["status"];
-                auto ps = status["print_stats"];
-                auto vsd = status["virtual_sdcard"];
-
-                std::string state = ps.value("state", "");
-                std::string filename = ps.value("filename", "");
-                double elapsed = ps.value("print_duration", 0.0);
-                double progress = vsd.value("progress", 0.0);
-
-                bool active = (state == "printing" || state == "paused");
-                double now = steady_seconds();
-
-                int eta = -1;
-                if (progress > 0.03 && elapsed > 5.0) {
-                    double total = elapsed / progress;
-                    double rem = total - elapsed;
-                    if (rem > 0) eta = static_cast<int>(rem);
-                }
-
-                {
-                    std::lock_guard<std::mutex> lock(mutex_);
-                    metrics_.state = state;
-                    metrics_.filename = filename;
-                    metrics_.progress01 = static_cast<float>(progress);
-                    metrics_.elapsed_sec = static_cast<int>(elapsed);
-                    metrics_.eta_sec = eta;
-                    metrics_.active = active;
-                    if (active) {
-                        metrics_.had_job = true;
-                        metrics_.last_active_ts = now;
-                    }
-                }
-
-                if (!filename.empty() && filename != last_filename_) {
-                    last_filename_ = filename;
-                    std::string meta_body;
-                    std::string meta_url = base_url_ + "/server/files/metadata?filename=" + url_encode_query(filename);
-                    if (httpGet(meta_url, meta_body)) {
-                        auto jm = json::parse(meta_body, nullptr, false);
-                        if (!jm.is_discarded()) {
-                            auto thumbs = jm["result"]["thumbnails"];
-                            int best_area = -1;
-                            std::string best_rel;
-                            for (auto& th : thumbs) {
-                                int w = th.value("width", 0);
-                                int h = th.value("height", 0);
-                                int area = w * h;
-                                if (area > best_area) {
-                                    best_area = area;
-                                    best_rel = th.value("relative_path", "");
-                                }
-                            }
-                            if (!best_rel.empty() && best_rel != last_thumb_relpath_) {
-                                last_thumb_relpath_ = best_rel;
-                                std::string thumb_url = base_url_ + "/server/files/gcodes/" + url_encode_path(best_rel);
-                                std::vector<unsigned char> png;
-                                if (httpGetBinary(thumb_url, png)) {
-                                    int w = 0, h = 0, ch = 0;
-                                    unsigned char* img = stbi_load_from_memory(png.data(), static_cast<int>(png.size()), &w, &h, &ch, 4);
-                                    if (img && w > 0 && h > 0) {
-                                        auto image = std::make_shared<ImageRGBA>();
-                                        image->w = w;
-                                        image->h = h;
-                                        image->data.assign(img, img + (w * h * 4));
-                                        stbi_image_free(img);
-                                        std::lock_guard<std::mutex> lock(mutex_);
-                                        metrics_.thumb_rgba = image;
-                                        metrics_.thumb_relpath = best_rel;
-                                    } else if (img) {
-                                        stbi_image_free(img);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+        int r = ws.Recv(msg, 500);
+        if (r < 0) break;
+        checkThumbBox();
+        if (r == 0) continue;
+        auto j = json::parse(msg, nullptr, false);
+        if (j.is_discarded() || !j.is_object()) continue;
+
+        if (j.value("id", 0) == SUBSCRIBE_ID) {
+            // Full state of the subscribed fields; an error means Klippy is not ready
+            if (!j.contains("result")) break;
+            merge_status(j["result"]["status"], job_);
+            applyJob();
+            if (!subscribed && debug_) std::cerr << "Printer: subscribed via websocket" << std::endl;
+            subscribed = true;
+            continue;
+        }
+        std::string method = j.value("method", "");
+        if (method == "notify_status_update") {
+            auto params = j["params"];
+            if (params.is_array() && !params.empty()) {
+                merge_status(params[0], job_);
+                applyJob();
             }
+        } else if (method == "notify_klippy_ready") {
+            // Klippy restarted: subscriptions do not survive it
+            if (!ws.SendText(SUBSCRIBE_REQUEST)) break;
+        } else if (method == "notify_klippy_shutdown" || method == "notify_klippy_disconnected") {
+            job_.state.clear();
+            applyJob();
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(poll_ms_));
+    }
+    return subscribed;
+}
+
+void PrinterClient::worker() {
+    while (running_) {
+        // Pushed updates while the websocket is up; polling while it cannot be established
+        if (use_ws_ && runWebSocket()) {
+            sleepMs(1000);
+            continue;
+        }
+        pollOnce();
+        checkThumbBox();
+        sleepMs(poll_ms_);
+    }
+    if (curl_) {
+        curl_easy_cleanup(static_cast<CURL*>(curl_));
+        curl_ = nullptr;
     }
 }
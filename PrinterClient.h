@@ -2,18 +2,40 @@
 #include <string>
 #include <vector>
 #include <memory>
-#include <mutex>
 #include <thread>
 #include <atomic>
+#include <cstdint>
+#include "Snapshot.h"
+#include "Thumbnail565.h"
 
-struct ImageRGBA {
-    int w = 0;
-    int h = 0;
-    std::vector<unsigned char> data; // RGBA
-};
+// Moonraker print_stats.state
+enum class PrinterState : uint8_t { NONE, STANDBY, PRINTING, PAUSED, COMPLETE, CANCELLED, ERROR };
+
+inline PrinterState printer_state_from(const std::string& s) {
+    if (s == "standby") return PrinterState::STANDBY;
+    if (s == "printing") return PrinterState::PRINTING;
+    if (s == "paused") return PrinterState::PAUSED;
+    if (s == "complete") return PrinterState::COMPLETE;
+    if (s == "cancelled") return PrinterState::CANCELLED;
+    if (s == "error") return PrinterState::ERROR;
+    return PrinterState::NONE;
+}
+
+// Upper-case label for the screen, "IDLE" when there is no state
+inline const char* printer_state_label(PrinterState s) {
+    switch (s) {
+        case PrinterState::STANDBY: return "STANDBY";
+        case PrinterState::PRINTING: return "PRINTING";
+        case PrinterState::PAUSED: return "PAUSED";
+        case PrinterState::COMPLETE: return "COMPLETE";
+        case PrinterState::CANCELLED: return "CANCELLED";
+        case PrinterState::ERROR: return "ERROR";
+        default: return "IDLE";
+    }
+}
 
 struct PrinterMetrics {
-    std::string state;
+    PrinterState state = PrinterState::NONE;
     std::string filename;
     float progress01 = 0.0f;
     int elapsed_sec = 0;
@@ -22,7 +44,7 @@ struct PrinterMetrics {
     bool had_job = false;
     double last_active_ts = 0.0;
     std::string thumb_relpath;
-    std::shared_ptr<ImageRGBA> thumb_rgba;
+    std::shared_ptr<const Thumbnail565> thumb; // scaled to the SetThumbBox() size
 };
 
 class PrinterClient {
@@ -33,22 +55,67 @@ public:
     void Start();
     void Stop();
 
-    PrinterMetrics GetSnapshot() const;
+    // Render thread only: newest published state, no locking or copying.
+    // The reference stays valid until the next call.
+    const PrinterMetrics& Snapshot();
+
+    // eventfd written after every snapshot change (render loop wake-up); -1 = none
+    void SetWakeFd(int fd) { wake_fd_ = fd; }
+
+    // Any thread: the box thumbnails are pre-scaled to (the layout's preview
+    // image). A new size re-scales the current thumbnail.
+    void SetThumbBox(int w, int h);
+
+    // Raw job fields as Moonraker reports them; websocket diffs update them in place
+    struct JobStatus {
+        std::string state;
+        std::string filename;
+        double elapsed = 0.0;
+        double progress = 0.0;
+    };
 
 private:
+    // Validators of the last 200 response for url, sent back as
+    // If-None-Match / If-Modified-Since on the next request for it
+    struct HttpCache {
+        std::string url;
+        std::string etag;
+        std::string last_modified;
+        bool keep_body = false; // body is handed back on 304
+        std::string body;
+    };
+    enum class Fetch { OK, NOT_MODIFIED, FAILED };
+
     void worker();
-    bool httpGet(const std::string& url, std::string& out) const;
-    bool httpGetBinary(const std::string& url, std::vector<unsigned char>& out) const;
+    void wake() const;
+    void publish();
+    void sleepMs(int ms);
+    Fetch httpGet(const std::string& url, std::string& out, long timeout_s, HttpCache* cache = nullptr);
+    bool pollOnce();
+    bool runWebSocket(); // false if no subscription was established
+    void applyJob();
+    void refreshThumbnail();
+    void checkThumbBox();
 
     std::string base_url_;
     int poll_ms_ = 5000;
+    bool use_ws_ = true;
+    bool debug_ = false;
+    int wake_fd_ = -1;
+    void* curl_ = nullptr; // CURL*, worker thread only; reused across requests
 
-    mutable std::mutex mutex_;
-    PrinterMetrics metrics_;
+    PrinterMetrics metrics_; // worker thread's working copy
+    TripleBuffer<PrinterMetrics> snapshot_;
 
     std::thread worker_;
     std::atomic<bool> running_{false};
 
+    JobStatus job_;
     std::string last_filename_;
-    std::string last_thumb_relpath_;
+    HttpCache meta_cache_{"", "", "", true, ""};
+    HttpCache thumb_cache_;
+    // w << 16 | h, so the pair is read whole; thumb_scaled_ is what metrics_.thumb was fitted to
+    std::atomic<uint32_t> thumb_box_{0};
+    std::atomic<bool> thumb_box_changed_{false};
+    uint32_t thumb_scaled_ = 0;
 };
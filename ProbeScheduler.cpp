@@ -0,0 +1,104 @@
+#include "ProbeScheduler.h"
+#include "Profiler.h"
+#include <iostream>
+#include <algorithm>
+
+ProbeScheduler::ProbeScheduler(const std::string& name, bool debug)
+    : name_(name), debug_(debug) {}
+
+ProbeScheduler::~ProbeScheduler() {
+    Stop();
+}
+
+void ProbeScheduler::AddProbe(const std::string& name, int period_ms, int deadline_ms, ProbeFn fn) {
+    Probe p;
+    p.name = name;
+    p.period = std::chrono::milliseconds(std::max(1, period_ms));
+    p.deadline = std::chrono::milliseconds(deadline_ms > 0 ? deadline_ms : std::max(1, period_ms));
+    p.next_due = std::chrono::steady_clock::now();
+    p.fn = std::move(fn);
+    p.profile_id = Profiler::Register("probe." + name);
+    probes_.push_back(std::move(p));
+}
+
+void ProbeScheduler::SetRoundCallback(RoundFn fn) {
+    on_round_ = std::move(fn);
+}
+
+void ProbeScheduler::Start() {
+    if (running_ || probes_.empty()) return;
+    running_ = true;
+    auto now = std::chrono::steady_clock::now();
+    for (auto& p : probes_) {
+        p.next_due = now;
+    }
+    worker_ = std::thread(&ProbeScheduler::worker, this);
+}
+
+void ProbeScheduler::Stop() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        running_ = false;
+    }
+    wake_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void ProbeScheduler::worker() {
+    while (running_) {
+        bool ran = false;
+        for (auto& p : probes_) {
+            auto start = std::chrono::steady_clock::now();
+            if (start < p.next_due) continue;
+
+            try {
+                p.fn();
+            } catch (const std::exception& e) {
+                if (debug_) {
+                    std::cerr << "[" << name_ << "] probe " << p.name << " error: " << e.what() << std::endl;
+                }
+            } catch (...) {
+                if (debug_) {
+                    std::cerr << "[" << name_ << "] probe " << p.name << " error: unknown exception" << std::endl;
+                }
+            }
+            ran = true;
+
+            auto end = std::chrono::steady_clock::now();
+            auto took = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            if (Profiler::Enabled()) {
+                Profiler::Record(p.profile_id, static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+            }
+            if (took > p.deadline) {
+                p.overruns++;
+                if (debug_) {
+                    std::cerr << "[" << name_ << "] probe " << p.name << " overran deadline: "
+                              << took.count() << "ms > " << p.deadline.count() << "ms"
+                              << " (overruns=" << p.overruns << ")" << std::endl;
+                }
+            }
+
+            // Keep the cadence fixed while on time, but never try to catch up
+            // after an overrun.
+            p.next_due += p.period;
+            if (p.next_due < end) {
+                p.next_due = end + p.period;
+            }
+        }
+
+        if (ran && on_round_) {
+            on_round_();
+        }
+
+        auto next = std::chrono::steady_clock::time_point::max();
+        for (const auto& p : probes_) {
+            next = std::min(next, p.next_due);
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait_until(lock, next, [this] { return !running_; });
+    }
+}
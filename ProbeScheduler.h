@@ -0,0 +1,58 @@
+#ifndef PROBE_SCHEDULER_H
+#define PROBE_SCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Runs a set of metric probes on one worker thread, each with its own period.
+// Probes that run longer than their deadline are reported (LCD_DEBUG) and
+// rescheduled from the moment they finished, so a stalled probe never causes
+// a burst of catch-up runs.
+class ProbeScheduler {
+public:
+    using ProbeFn = std::function<void()>;
+    using RoundFn = std::function<void()>;
+
+    explicit ProbeScheduler(const std::string& name, bool debug = false);
+    ~ProbeScheduler();
+
+    // Register a probe before Start(). deadline_ms <= 0 means "same as period".
+    void AddProbe(const std::string& name, int period_ms, int deadline_ms, ProbeFn fn);
+
+    // Called after every pass in which at least one probe ran.
+    void SetRoundCallback(RoundFn fn);
+
+    void Start();
+    void Stop();
+
+private:
+    struct Probe {
+        std::string name;
+        std::chrono::milliseconds period;
+        std::chrono::milliseconds deadline;
+        std::chrono::steady_clock::time_point next_due;
+        ProbeFn fn;
+        int overruns = 0;
+        int profile_id = -1;
+    };
+
+    void worker();
+
+    std::string name_;
+    bool debug_ = false;
+    std::vector<Probe> probes_;
+    RoundFn on_round_;
+
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+};
+
+#endif // PROBE_SCHEDULER_H
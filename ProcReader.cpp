@@ -0,0 +1,198 @@
+#include "ProcReader.h"
+#include <cstdio>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+constexpr int THERMAL_ZONES_MAX = 5;
+}
+
+// --- ProcFile ---
+
+ProcFile::~ProcFile() {
+    Close();
+}
+
+bool ProcFile::Open(const char* path) {
+    Close();
+    fd_ = open(path, O_RDONLY | O_CLOEXEC);
+    return fd_ >= 0;
+}
+
+void ProcFile::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    len_ = 0;
+    buf_[0] = '\0';
+}
+
+ssize_t ProcFile::Read() {
+    if (fd_ < 0) return -1;
+    ssize_t r = pread(fd_, buf_, BUF_SIZE - 1, 0);
+    if (r < 0) {
+        len_ = 0;
+        buf_[0] = '\0';
+        return -1;
+    }
+    len_ = static_cast<size_t>(r);
+    buf_[len_] = '\0';
+    return r;
+}
+
+// --- ProcScanner ---
+
+void ProcScanner::skipSpaces() {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+}
+
+void ProcScanner::skipLine() {
+    while (p < end && *p != '\n') ++p;
+    if (p < end) ++p;
+}
+
+bool ProcScanner::match(const char* lit) {
+    const char* q = p;
+    while (*lit) {
+        if (q >= end || *q != *lit) return false;
+        ++q;
+        ++lit;
+    }
+    p = q;
+    return true;
+}
+
+bool ProcScanner::readU64(uint64_t& out) {
+    skipSpaces();
+    if (p >= end || *p < '0' || *p > '9') return false;
+    uint64_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + static_cast<uint64_t>(*p - '0');
+        ++p;
+    }
+    out = v;
+    return true;
+}
+
+// --- ProcReader ---
+
+ProcReader::ProcReader() {
+    stat_.Open("/proc/stat");
+    meminfo_.Open("/proc/meminfo");
+    uptime_.Open("/proc/uptime");
+}
+
+double ProcReader::usageFrom(const CpuTimes& prev, const CpuTimes& cur) {
+    if (prev.total == 0 || cur.total <= prev.total) return 0.0;
+    double total_delta = static_cast<double>(cur.total - prev.total);
+    double idle_delta = static_cast<double>(cur.idle - prev.idle);
+    double usage = 100.0 * (1.0 - idle_delta / total_delta);
+    if (usage < 0.0) usage = 0.0;
+    if (usage > 100.0) usage = 100.0;
+    return usage;
+}
+
+double ProcReader::CpuUsage() {
+    if (stat_.Read() <= 0) return 0.0;
+    ProcScanner sc(stat_.data(), stat_.size());
+
+    double total_usage = 0.0;
+    int cores = 0;
+    while (!sc.atEnd() && sc.match("cpu")) {
+        int core = -1;
+        if (*sc.p >= '0' && *sc.p <= '9') {
+            uint64_t idx = 0;
+            sc.readU64(idx);
+            core = static_cast<int>(idx);
+        }
+
+        // user nice system idle iowait irq softirq steal
+        uint64_t f[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        for (int i = 0; i < 8; ++i) {
+            if (!sc.readU64(f[i])) break;
+        }
+        CpuTimes cur;
+        cur.idle = f[3] + f[4];
+        cur.total = f[0] + f[1] + f[2] + cur.idle + f[5] + f[6] + f[7];
+
+        if (core < 0) {
+            total_usage = usageFrom(prev_total_, cur);
+            prev_total_ = cur;
+        } else if (core < MAX_CPU_CORES) {
+            core_usage_[core] = usageFrom(prev_cores_[core], cur);
+            prev_cores_[core] = cur;
+            cores = std::max(cores, core + 1);
+        }
+        sc.skipLine();
+    }
+    core_count_ = cores;
+    return total_usage;
+}
+
+bool ProcReader::Memory(double& percent, int& used_mb) {
+    if (meminfo_.Read() <= 0) return false;
+    ProcScanner sc(meminfo_.data(), meminfo_.size());
+    uint64_t mem_total = 0, mem_available = 0;
+    bool have_total = false, have_avail = false;
+    while (!sc.atEnd() && !(have_total && have_avail)) {
+        if (sc.match("MemTotal:")) {
+            have_total = sc.readU64(mem_total);
+        } else if (sc.match("MemAvailable:")) {
+            have_avail = sc.readU64(mem_available);
+        }
+        sc.skipLine();
+    }
+    if (mem_total == 0) return false;
+    uint64_t mem_used = mem_total - std::min(mem_total, mem_available);
+    percent = (static_cast<double>(mem_used) / mem_total) * 100.0;
+    used_mb = static_cast<int>(mem_used / 1024);
+    return true;
+}
+
+bool ProcReader::probeThermal() {
+    char path[64];
+    for (int i = 0; i < THERMAL_ZONES_MAX; ++i) {
+        std::snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/temp", i);
+        if (!thermal_.Open(path)) continue;
+        if (thermal_.Read() > 0) {
+            ProcScanner sc(thermal_.data(), thermal_.size());
+            uint64_t milli = 0;
+            if (sc.readU64(milli)) {
+                double c = static_cast<double>(milli) / 1000.0;
+                if (c > 20 && c < 120) {
+                    thermal_zone_ = i;
+                    return true;
+                }
+            }
+        }
+    }
+    thermal_.Close();
+    thermal_zone_ = -1;
+    return false;
+}
+
+double ProcReader::CpuTemp() {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (thermal_zone_ < 0 && !probeThermal()) return 0.0;
+        if (thermal_.Read() > 0) {
+            ProcScanner sc(thermal_.data(), thermal_.size());
+            uint64_t milli = 0;
+            if (sc.readU64(milli)) {
+                double c = static_cast<double>(milli) / 1000.0;
+                if (c > 20 && c < 120) return c;
+            }
+        }
+        thermal_zone_ = -1;
+    }
+    return 0.0;
+}
+
+int ProcReader::Uptime() {
+    if (uptime_.Read() <= 0) return 0;
+    ProcScanner sc(uptime_.data(), uptime_.size());
+    uint64_t secs = 0;
+    sc.readU64(secs);
+    return static_cast<int>(secs);
+}
@@ -0,0 +1,93 @@
+#ifndef PROC_READER_H
+#define PROC_READER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+constexpr int MAX_CPU_CORES = 16;
+
+// A /proc or /sys file opened once and re-read with pread(fd, buf, 0).
+// The contents land in a fixed buffer and are NUL-terminated; files larger
+// than the buffer are truncated (only the head of /proc/stat is needed).
+class ProcFile {
+public:
+    static constexpr size_t BUF_SIZE = 4096;
+
+    ProcFile() = default;
+    ~ProcFile();
+
+    ProcFile(const ProcFile&) = delete;
+    ProcFile& operator=(const ProcFile&) = delete;
+
+    bool Open(const char* path);
+    void Close();
+    bool IsOpen() const { return fd_ >= 0; }
+
+    // Returns the number of bytes read, or -1 on error.
+    ssize_t Read();
+    const char* data() const { return buf_; }
+    size_t size() const { return len_; }
+
+private:
+    int fd_ = -1;
+    size_t len_ = 0;
+    char buf_[BUF_SIZE];
+};
+
+// Minimal non-allocating scanner over a NUL-terminated buffer.
+struct ProcScanner {
+    const char* p;
+    const char* end;
+
+    ProcScanner(const char* data, size_t len) : p(data), end(data + len) {}
+
+    bool atEnd() const { return p >= end; }
+    void skipSpaces();
+    void skipLine();
+    // Matches a literal at the cursor and advances past it.
+    bool match(const char* lit);
+    // Parses an unsigned decimal; returns false if no digit was found.
+    bool readU64(uint64_t& out);
+};
+
+// Cached readers for the per-tick /proc and /sys values.
+class ProcReader {
+public:
+    ProcReader();
+
+    // Aggregate CPU usage since the previous call, in percent. Per-core
+    // figures for the same interval are left in core_usage().
+    double CpuUsage();
+    const std::array<double, MAX_CPU_CORES>& core_usage() const { return core_usage_; }
+    int core_count() const { return core_count_; }
+
+    bool Memory(double& percent, int& used_mb);
+    // Remembers the first thermal zone with a plausible value and re-probes
+    // only when it stops reporting one.
+    double CpuTemp();
+    int Uptime();
+
+private:
+    struct CpuTimes {
+        uint64_t total = 0;
+        uint64_t idle = 0;
+    };
+
+    static double usageFrom(const CpuTimes& prev, const CpuTimes& cur);
+    bool probeThermal();
+
+    ProcFile stat_;
+    ProcFile meminfo_;
+    ProcFile uptime_;
+    ProcFile thermal_;
+    int thermal_zone_ = -1;
+
+    CpuTimes prev_total_;
+    std::array<CpuTimes, MAX_CPU_CORES> prev_cores_{};
+    std::array<double, MAX_CPU_CORES> core_usage_{};
+    int core_count_ = 0;
+};
+
+#endif // PROC_READER_H
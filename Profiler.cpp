@@ -0,0 +1,256 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+struct Stage {
+    std::string name;
+    std::atomic<uint32_t> buckets[Profiler::BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> max_ns;
+};
+
+Stage g_stages[Profiler::MAX_STAGES];
+std::atomic<int> g_stage_count{0};
+std::mutex g_register_mutex;
+
+// Log-linear: exact below 8 ns, then 8 buckets per power of two (~12% wide)
+int bucket_of(uint64_t ns) {
+    if (ns < 8) return static_cast<int>(ns);
+    int msb = 63 - __builtin_clzll(ns);
+    int idx = (msb - 2) * 8 + static_cast<int>((ns >> (msb - 3)) & 7);
+    return std::min(idx, Profiler::BUCKETS - 1);
+}
+
+double bucket_mid(int idx) {
+    if (idx < 8) return idx;
+    int msb = idx / 8 + 2;
+    double width = std::ldexp(1.0, msb - 3);
+    return (8 + idx % 8) * width + width * 0.5;
+}
+
+void append_seconds(std::string& out, double ns) {
+    char buf[32];
+    if (std::isnan(ns)) {
+        std::snprintf(buf, sizeof(buf), "NaN");
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.9g", ns * 1e-9);
+    }
+    out += buf;
+}
+}
+
+std::atomic<bool> Profiler::enabled_{false};
+
+int Profiler::Register(const std::string& name) {
+    std::lock_guard<std::mutex> lock(g_register_mutex);
+    int n = g_stage_count.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        if (g_stages[i].name == name) return i;
+    }
+    if (n >= MAX_STAGES) return -1;
+    g_stages[n].name = name;
+    g_stage_count.store(n + 1, std::memory_order_release);
+    return n;
+}
+
+void Profiler::Record(int id, uint64_t ns) {
+    if (id < 0 || id >= MAX_STAGES) return;
+    Stage& s = g_stages[id];
+    s.buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t prev = s.max_ns.load(std::memory_order_relaxed);
+    while (ns > prev && !s.max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+    }
+}
+
+int Profiler::StageCount() {
+    return g_stage_count.load(std::memory_order_acquire);
+}
+
+bool Profiler::Take(int id, Snapshot& out) {
+    if (id < 0 || id >= StageCount()) return false;
+    Stage& s = g_stages[id];
+    out.name = s.name;
+    out.count = s.count.load(std::memory_order_relaxed);
+    out.sum_ns = s.sum_ns.load(std::memory_order_relaxed);
+    out.max_ns = s.max_ns.exchange(0, std::memory_order_relaxed);
+    out.buckets.resize(BUCKETS);
+    for (int i = 0; i < BUCKETS; ++i) {
+        out.buckets[i] = s.buckets[i].load(std::memory_order_relaxed);
+    }
+    return true;
+}
+
+double Profiler::Quantile(const std::vector<uint32_t>& buckets, uint64_t total, double q) {
+    if (total == 0) return NAN;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total)));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return bucket_mid(static_cast<int>(i));
+    }
+    return bucket_mid(static_cast<int>(buckets.size()) - 1);
+}
+
+// --- StatsServer ---
+
+StatsServer::StatsServer(const std::string& socket_path, bool debug)
+    : path_(socket_path), debug_(debug) {}
+
+StatsServer::~StatsServer() {
+    Stop();
+}
+
+bool StatsServer::Start() {
+    if (running_ || path_.empty()) return false;
+    sockaddr_un addr{};
+    if (path_.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Stats socket path too long: " << path_ << std::endl;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) return false;
+    unlink(path_.c_str()); // stale socket from a previous run
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, 4) != 0) {
+        std::cerr << "Stats socket " << path_ << ": " << std::strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    running_ = true;
+    worker_ = std::thread(&StatsServer::worker, this);
+    if (debug_) {
+        std::cerr << "Stats socket listening on " << path_ << std::endl;
+    }
+    return true;
+}
+
+void StatsServer::Stop() {
+    if (!running_) return;
+    running_ = false;
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t r = write(wake_fd_, &one, sizeof(one));
+        (void)r;
+    }
+    if (worker_.joinable()) worker_.join();
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(path_.c_str());
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+void StatsServer::worker() {
+    while (running_) {
+        pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+        int n = poll(fds, wake_fd_ >= 0 ? 2 : 1, wake_fd_ >= 0 ? -1 : 500);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (!running_) break;
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                serve(fd);
+                close(fd);
+            }
+        }
+    }
+}
+
+void StatsServer::serve(int fd) {
+    timeval rcv{0, 100000};
+    timeval snd{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &rcv, sizeof(rcv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &snd, sizeof(snd));
+
+    // HTTP clients get a status line; a bare connect just gets the text
+    char req[512];
+    ssize_t r = recv(fd, req, sizeof(req), 0);
+    bool http = r >= 4 && std::memcmp(req, "GET ", 4) == 0;
+
+    std::string body = Render();
+    std::string out;
+    if (http) {
+        out = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+              std::to_string(body.size()) + "\r\n\r\n";
+    }
+    out += body;
+
+    size_t off = 0;
+    while (off < out.size()) {
+        ssize_t w = send(fd, out.data() + off, out.size() - off, MSG_NOSIGNAL);
+        if (w <= 0) break;
+        off += static_cast<size_t>(w);
+    }
+}
+
+std::string StatsServer::Render() {
+    int stages = Profiler::StageCount();
+    last_buckets_.resize(static_cast<size_t>(stages));
+
+    std::string quant;
+    std::string maxes;
+    Profiler::Snapshot snap;
+    std::vector<uint32_t> delta(Profiler::BUCKETS);
+    for (int id = 0; id < stages; ++id) {
+        if (!Profiler::Take(id, snap)) continue;
+        auto& last = last_buckets_[static_cast<size_t>(id)];
+        last.resize(Profiler::BUCKETS, 0);
+        uint64_t window = 0;
+        for (int i = 0; i < Profiler::BUCKETS; ++i) {
+            delta[i] = snap.buckets[i] - last[i];
+            window += delta[i];
+        }
+        last.swap(snap.buckets);
+
+        const std::string label = "{stage=\"" + snap.name + "\"";
+        for (double q : {0.5, 0.95}) {
+            char qs[16];
+            std::snprintf(qs, sizeof(qs), "%g", q);
+            quant += "lcd_stage_seconds" + label + ",quantile=\"" + qs + "\"} ";
+            append_seconds(quant, Profiler::Quantile(delta, window, q));
+            quant += '\n';
+        }
+        quant += "lcd_stage_seconds_sum" + label + "} ";
+        append_seconds(quant, static_cast<double>(snap.sum_ns));
+        quant += "\nlcd_stage_seconds_count" + label + "} " + std::to_string(snap.count) + "\n";
+
+        maxes += "lcd_stage_max_seconds" + label + "} ";
+        append_seconds(maxes, window ? static_cast<double>(snap.max_ns) : NAN);
+        maxes += '\n';
+    }
+
+    std::string out;
+    out += "# HELP lcd_stage_seconds Stage durations; quantiles cover the last scrape interval.\n";
+    out += "# TYPE lcd_stage_seconds summary\n";
+    out += quant;
+    out += "# HELP lcd_stage_max_seconds Longest stage run in the last scrape interval.\n";
+    out += "# TYPE lcd_stage_max_seconds gauge\n";
+    out += maxes;
+    return out;
+}
@@ -0,0 +1,109 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Duration histograms for named stages (render panels and effects, metric
+// probes, SPI transfers).
+//
+// Storage is a fixed table of MAX_STAGES log-linear histograms (8 buckets
+// per power of two, 1 ns .. ~17 s), about 1 KiB per stage, allocated once.
+// Recording is a few relaxed atomic increments and never locks; each stage
+// is normally written by the one thread that runs it. Registration takes a
+// mutex and is meant for init time or a function-local static.
+// Everything is a no-op until SetEnabled(true) (LCD_PROFILE).
+class Profiler {
+public:
+    static constexpr int MAX_STAGES = 64;
+    static constexpr int BUCKETS = 264;
+
+    struct Snapshot {
+        std::string name;
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t max_ns = 0; // since the previous Snapshot() of this stage
+        std::vector<uint32_t> buckets;
+    };
+
+    static void SetEnabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+    static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Returns the id for name (the same id when registered twice), -1 if
+    // the table is full.
+    static int Register(const std::string& name);
+    static void Record(int id, uint64_t ns);
+
+    static int StageCount();
+    static bool Take(int id, Snapshot& out); // resets max_ns
+
+    // Value at quantile q (0..1) from bucket counts, in ns (bucket midpoint).
+    static double Quantile(const std::vector<uint32_t>& buckets, uint64_t total, double q);
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// Times the enclosing scope into a stage.
+class ProfileScope {
+public:
+    explicit ProfileScope(int id) : id_(Profiler::Enabled() ? id : -1) {
+        if (id_ >= 0) start_ = std::chrono::steady_clock::now();
+    }
+    ~ProfileScope() {
+        if (id_ < 0) return;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        Profiler::Record(id_, static_cast<uint64_t>(ns));
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    int id_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// PROFILE_SCOPE("render.header"): registers once per call site, then times the scope.
+#define PROFILE_SCOPE(name)                                                          \
+    static const int PROFILE_CONCAT(profile_id_, __LINE__) = Profiler::Register(name); \
+    ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_id_, __LINE__))
+
+// Serves the stage table in Prometheus text format on a Unix socket, one
+// response per connection (`curl --unix-socket PATH http://localhost/metrics`
+// or `socat - UNIX-CONNECT:PATH`). Quantiles and max cover the interval
+// since the previous scrape; _sum and _count are cumulative.
+class StatsServer {
+public:
+    explicit StatsServer(const std::string& socket_path, bool debug = false);
+    ~StatsServer();
+
+    StatsServer(const StatsServer&) = delete;
+    StatsServer& operator=(const StatsServer&) = delete;
+
+    bool Start();
+    void Stop();
+
+    std::string Render(); // exposition text; advances the scrape window
+
+private:
+    void worker();
+    void serve(int fd);
+
+    std::string path_;
+    bool debug_ = false;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::vector<std::vector<uint32_t>> last_buckets_; // per stage, at the previous scrape
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,109 @@
+#include "ProgressiveUpdate.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+constexpr uint32_t MAX_AGE = 64;
+
+// Luma on a 0..63 scale straight from RGB565 (0.3/0.55/0.15 in sixteenths)
+inline int luma6(uint16_t p) {
+    const int r = (p >> 11) << 1;
+    const int g = (p >> 5) & 0x3F;
+    const int b = (p & 0x1F) << 1;
+    return (r * 5 + g * 9 + b * 2) >> 4;
+}
+}
+
+ProgressiveUpdate::ProgressiveUpdate(int width, int height, int band_rows, size_t budget_px, int max_rects)
+    : width_(width), height_(height), band_rows_(std::max(1, band_rows)), budget_px_(budget_px),
+      max_rects_(static_cast<size_t>(std::max(1, max_rects))) {
+    age_.assign(static_cast<size_t>((height_ + band_rows_ - 1) / band_rows_), 0);
+    bands_.reserve(age_.size() * max_rects_);
+    deferred_.reserve(age_.size() * max_rects_);
+}
+
+uint32_t ProgressiveUpdate::meanDelta(const uint16_t* cur, const uint16_t* prev, const Rect& r) const {
+    uint64_t sum = 0;
+    for (int y = r.y; y < r.y + r.h; ++y) {
+        const size_t off = static_cast<size_t>(y) * width_ + r.x;
+        const uint16_t* a = cur + off;
+        const uint16_t* b = prev + off;
+        for (int x = 0; x < r.w; ++x) {
+            if (a[x] != b[x]) sum += static_cast<uint64_t>(std::abs(luma6(a[x]) - luma6(b[x])) + 1);
+        }
+    }
+    // 4 fractional bits; any changed pixel keeps the band above zero
+    if (sum == 0) return 0;
+    const uint64_t area = static_cast<uint64_t>(r.w) * r.h;
+    return static_cast<uint32_t>(std::max<uint64_t>(1, (sum << 4) / area));
+}
+
+void ProgressiveUpdate::TakeDeferred(std::vector<Rect>& out) {
+    out.insert(out.end(), deferred_.begin(), deferred_.end());
+    deferred_.clear();
+}
+
+bool ProgressiveUpdate::Limit(const uint16_t* cur, const uint16_t* prev, std::vector<Rect>& rects) {
+    deferred_.clear();
+    if (budget_px_ == 0) return false;
+
+    size_t total = 0;
+    for (const auto& r : rects) total += static_cast<size_t>(r.w) * r.h;
+    if (total <= budget_px_) {
+        std::fill(age_.begin(), age_.end(), 0);
+        return false;
+    }
+
+    // Screen-aligned bands, so a band row keeps its age from frame to frame
+    bands_.clear();
+    for (const auto& r : rects) {
+        int y = r.y;
+        const int y_end = std::min(r.y + r.h, height_);
+        while (y < y_end) {
+            const int next = std::min(y_end, (y / band_rows_ + 1) * band_rows_);
+            Band b{{r.x, y, r.w, next - y}, 0};
+            const uint32_t delta = meanDelta(cur, prev, b.r);
+            if (delta > 0) { // identical to the panel: nothing to send or keep
+                b.score = delta * (1 + age_[static_cast<size_t>(y / band_rows_)]);
+                bands_.push_back(b);
+            }
+            y = next;
+        }
+    }
+    // Ties go top to bottom. Not stable_sort: that takes a heap buffer per call
+    std::sort(bands_.begin(), bands_.end(), [](const Band& a, const Band& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.r.y != b.r.y ? a.r.y < b.r.y : a.r.x < b.r.x;
+    });
+
+    // The top band always goes out, even over budget, so the panel converges
+    rects.clear();
+    size_t used = 0;
+    for (const auto& b : bands_) {
+        const size_t area = static_cast<size_t>(b.r.w) * b.r.h;
+        bool take = used == 0 || used + area <= budget_px_;
+        if (take) {
+            // Join a vertically adjacent band of the same span to save rect setup
+            auto joined = std::find_if(rects.begin(), rects.end(), [&](const Rect& o) {
+                return o.x == b.r.x && o.w == b.r.w && (o.y + o.h == b.r.y || b.r.y + b.r.h == o.y);
+            });
+            if (joined != rects.end()) {
+                joined->h += b.r.h;
+                joined->y = std::min(joined->y, b.r.y);
+            } else if (rects.size() < max_rects_) {
+                rects.push_back(b.r);
+            } else {
+                take = false;
+            }
+        }
+        uint32_t& age = age_[static_cast<size_t>(b.r.y / band_rows_)];
+        if (take) {
+            used += area;
+            age = 0;
+        } else {
+            deferred_.push_back(b.r);
+            age = std::min(MAX_AGE, age + 1);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef PROGRESSIVE_UPDATE_H
+#define PROGRESSIVE_UPDATE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "DirtyRect.h"
+
+// Per-frame SPI budget for busy frames (LCD_SPI_BUDGET_KB).
+//
+// When the planned update exceeds the budget, the dirty rects are cut into
+// screen-aligned bands of band_rows rows and ranked by how visible their
+// change is: the mean luma delta against what the panel shows. New text and
+// values (few pixels, large deltas) go out before a dimming or fading
+// background (every pixel, small deltas). Bands are taken in that order until
+// the budget is spent; a band kept waiting gains weight every frame, so a
+// busy value cannot starve the rest of the screen.
+//
+// Whatever is held back stays dirty: the caller updates prev only for the
+// rects it sent and feeds TakeDeferred() into the next diff, so the panel
+// converges over the following frames instead of stalling on a whole one.
+class ProgressiveUpdate {
+public:
+    // budget_px 0 disables the limit. max_rects caps the rects sent per frame.
+    ProgressiveUpdate(int width, int height, int band_rows, size_t budget_px, int max_rects);
+
+    bool Enabled() const { return budget_px_ > 0; }
+
+    // rects in: the planned update. Returns true when it was over budget and
+    // rects now hold the part to send this frame (the rest is held back).
+    bool Limit(const uint16_t* cur, const uint16_t* prev, std::vector<Rect>& rects);
+
+    // Regions held back by the last Limit() and not yet taken
+    bool Pending() const { return !deferred_.empty(); }
+    // Appends the held-back regions to out (the next diff's limit) and forgets them
+    void TakeDeferred(std::vector<Rect>& out);
+
+private:
+    struct Band {
+        Rect r;
+        uint32_t score; // mean luma delta x band age
+    };
+
+    uint32_t meanDelta(const uint16_t* cur, const uint16_t* prev, const Rect& r) const;
+
+    int width_;
+    int height_;
+    int band_rows_;
+    size_t budget_px_;
+    size_t max_rects_;
+    std::vector<uint32_t> age_; // frames each band row has been held back
+    std::vector<Band> bands_;
+    std::vector<Rect> deferred_;
+};
+
+#endif // PROGRESSIVE_UPDATE_H
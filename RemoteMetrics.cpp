@@ -0,0 +1,329 @@
+#include "RemoteMetrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint8_t MAGIC[4] = {'L', 'C', 'D', 'm'};
+constexpr uint8_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 56; // everything before the per-core bytes
+constexpr int64_t RESOLVE_RETRY_MS = 5000;
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool resolve(const std::string& host, const std::string& port, sockaddr_storage& addr, socklen_t& len) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res) return false;
+    std::memcpy(&addr, res->ai_addr, res->ai_addrlen);
+    len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return true;
+}
+
+template <typename T>
+T clamp_to(double v, double lo, double hi) {
+    if (!(v >= lo)) v = lo; // NaN too
+    if (v > hi) v = hi;
+    return static_cast<T>(std::lround(v));
+}
+
+void put16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+void put32(uint8_t* p, uint32_t v) {
+    put16(p, static_cast<uint16_t>(v));
+    put16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+uint16_t get16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t get32(const uint8_t* p) { return get16(p) | (static_cast<uint32_t>(get16(p + 2)) << 16); }
+
+// -1 means unknown for the counters, so they are clamped to [-1, max]
+void put_count16(uint8_t* p, int v) { put16(p, static_cast<uint16_t>(static_cast<int16_t>(std::clamp(v, -1, 32767)))); }
+int get_count16(const uint8_t* p) { return static_cast<int16_t>(get16(p)); }
+
+void wake_all(const std::vector<int>& fds) {
+    for (int fd : fds) {
+        uint64_t one = 1;
+        ssize_t r = write(fd, &one, sizeof(one));
+        (void)r;
+    }
+}
+}
+
+size_t EncodeMetrics(const MetricsSnapshot& m, const std::string& host, uint16_t seq, uint8_t* out) {
+    const int cores = std::clamp(m.cpu_core_count, 0, MAX_CPU_CORES);
+    std::memset(out, 0, HEADER_SIZE);
+    std::memcpy(out, MAGIC, sizeof(MAGIC));
+    out[4] = VERSION;
+    out[5] = static_cast<uint8_t>(cores);
+    put16(out + 6, seq);
+    std::memcpy(out + 8, host.data(), std::min(host.size(), METRICS_HOST_LEN - 1));
+    put16(out + 24, clamp_to<uint16_t>(m.cpu_usage * 100.0, 0.0, 10000.0));
+    put16(out + 26, clamp_to<uint16_t>(m.mem_percent * 100.0, 0.0, 10000.0));
+    put32(out + 28, static_cast<uint32_t>(std::max(0, m.mem_used_mb)));
+    put16(out + 32, static_cast<uint16_t>(clamp_to<int16_t>(m.temp * 100.0, -32768.0, 32767.0)));
+    put32(out + 34, clamp_to<uint32_t>(m.net1_mbps * 1000.0, 0.0, 4294967295.0));
+    put32(out + 38, clamp_to<uint32_t>(m.net2_mbps * 1000.0, 0.0, 4294967295.0));
+    put32(out + 42, static_cast<uint32_t>(std::max(0, m.uptime_seconds)));
+    out[46] = static_cast<uint8_t>(m.wan_state);
+    out[47] = static_cast<uint8_t>(static_cast<int8_t>(std::clamp(m.disk_percent, -1, 100)));
+    put_count16(out + 48, m.docker_running);
+    put_count16(out + 50, m.wg_active_peers);
+    put_count16(out + 52, m.mc_online);
+    put_count16(out + 54, m.mc_max);
+    for (int i = 0; i < cores; ++i) {
+        out[HEADER_SIZE + i] = clamp_to<uint8_t>(m.cpu_core_usage[i] * 2.0, 0.0, 200.0);
+    }
+    return HEADER_SIZE + static_cast<size_t>(cores);
+}
+
+bool DecodeMetrics(const uint8_t* data, size_t size, MetricsSnapshot& m, std::string& host, uint16_t& seq) {
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || data[4] != VERSION) return false;
+    const int cores = data[5];
+    if (cores > MAX_CPU_CORES || size < HEADER_SIZE + cores) return false;
+    if (data[46] > static_cast<uint8_t>(WanState::DOWN)) return false;
+    seq = get16(data + 6);
+    const char* name = reinterpret_cast<const char*>(data + 8);
+    host.assign(name, strnlen(name, METRICS_HOST_LEN - 1));
+
+    m = MetricsSnapshot{};
+    m.cpu_usage = get16(data + 24) / 100.0;
+    m.mem_percent = get16(data + 26) / 100.0;
+    m.mem_used_mb = static_cast<int>(std::min<uint32_t>(get32(data + 28), 0x7fffffff));
+    m.temp = static_cast<int16_t>(get16(data + 32)) / 100.0;
+    m.net1_mbps = get32(data + 34) / 1000.0;
+    m.net2_mbps = get32(data + 38) / 1000.0;
+    m.uptime_seconds = static_cast<int>(std::min<uint32_t>(get32(data + 42), 0x7fffffff));
+    m.wan_state = static_cast<WanState>(data[46]);
+    m.disk_percent = static_cast<int8_t>(data[47]);
+    m.docker_running = get_count16(data + 48);
+    m.wg_active_peers = get_count16(data + 50);
+    m.mc_online = get_count16(data + 52);
+    m.mc_max = get_count16(data + 54);
+    m.cpu_core_count = cores;
+    for (int i = 0; i < cores; ++i) m.cpu_core_usage[i] = data[HEADER_SIZE + i] / 2.0;
+    return true;
+}
+
+// --- MetricsSender ---
+
+MetricsSender::MetricsSender(const std::string& targets, const std::string& host_name)
+    : host_name_(host_name.substr(0, METRICS_HOST_LEN - 1)) {
+    size_t start = 0;
+    while (start <= targets.size()) {
+        size_t end = targets.find(',', start);
+        if (end == std::string::npos) end = targets.size();
+        const std::string t = targets.substr(start, end - start);
+        start = end + 1;
+        if (t.empty()) continue;
+        // host:port, [v6]:port
+        const size_t colon = t.rfind(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 == t.size()) {
+            std::cerr << "Metrics push: ignoring \"" << t << "\" (want host:port)" << std::endl;
+            continue;
+        }
+        Target target;
+        target.host = t.substr(0, colon);
+        if (target.host.size() > 2 && target.host.front() == '[' && target.host.back() == ']') {
+            target.host = target.host.substr(1, target.host.size() - 2);
+        }
+        target.port = t.substr(colon + 1);
+        targets_.push_back(target);
+    }
+    if (targets_.empty()) return;
+    fd4_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    fd6_ = socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    // getaddrinfo() can stall for seconds while DNS is down, so it stays off
+    // the thread that calls Send()
+    resolver_ = std::thread(&MetricsSender::resolver, this);
+}
+
+MetricsSender::~MetricsSender() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    stop_cv_.notify_all();
+    if (resolver_.joinable()) resolver_.join();
+    if (fd4_ >= 0) close(fd4_);
+    if (fd6_ >= 0) close(fd6_);
+}
+
+void MetricsSender::resolver() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        bool pending = false;
+        for (auto& t : targets_) {
+            if (t.addr_len != 0) continue;
+            sockaddr_storage addr{};
+            socklen_t len = 0;
+            lock.unlock(); // Send() keeps going meanwhile
+            const bool ok = resolve(t.host, t.port, addr, len);
+            lock.lock();
+            if (ok) {
+                t.addr = addr;
+                t.addr_len = len;
+            } else {
+                pending = true;
+            }
+        }
+        if (!pending) return;
+        stop_cv_.wait_for(lock, std::chrono::milliseconds(RESOLVE_RETRY_MS), [this] { return stop_; });
+    }
+}
+
+void MetricsSender::Send(const MetricsSnapshot& m) {
+    if (targets_.empty()) return;
+    uint8_t buf[METRICS_PACKET_MAX];
+    const size_t n = EncodeMetrics(m, host_name_, seq_++, buf);
+    std::lock_guard<std::mutex> lock(mutex_); // only held by the resolver to store an address
+    for (const auto& t : targets_) {
+        if (t.addr_len == 0) continue;
+        const int fd = t.addr.ss_family == AF_INET6 ? fd6_ : fd4_;
+        if (fd < 0) continue;
+        ssize_t r = sendto(fd, buf, n, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&t.addr), t.addr_len);
+        (void)r; // best effort: the next snapshot follows shortly
+    }
+}
+
+// --- MetricsListener ---
+
+MetricsListener::MetricsListener(int port, bool debug) : port_(port), debug_(debug) {}
+
+MetricsListener::~MetricsListener() {
+    Stop();
+}
+
+bool MetricsListener::Start() {
+    if (running_) return true;
+    // One dual-stack socket takes both IPv4 and IPv6 senders; IPv4 only
+    // when the kernel has no IPv6
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+    fd_ = socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ >= 0) {
+        int off = 0;
+        setsockopt(fd_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        auto* a6 = reinterpret_cast<sockaddr_in6*>(&addr);
+        a6->sin6_family = AF_INET6;
+        a6->sin6_addr = in6addr_any;
+        a6->sin6_port = htons(static_cast<uint16_t>(port_));
+        addr_len = sizeof(sockaddr_in6);
+    } else {
+        fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) return false;
+        auto* a4 = reinterpret_cast<sockaddr_in*>(&addr);
+        a4->sin_family = AF_INET;
+        a4->sin_addr.s_addr = htonl(INADDR_ANY);
+        a4->sin_port = htons(static_cast<uint16_t>(port_));
+        addr_len = sizeof(sockaddr_in);
+    }
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), addr_len) != 0) {
+        std::cerr << "Metrics listener on UDP " << port_ << ": " << std::strerror(errno) << std::endl;
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    stop_fd_ = eventfd(0, EFD_CLOEXEC);
+    running_ = true;
+    worker_ = std::thread(&MetricsListener::worker, this);
+    std::cout << "Metrics listener on UDP " << port_ << std::endl;
+    return true;
+}
+
+void MetricsListener::Stop() {
+    if (!running_) return;
+    running_ = false;
+    wake_all({stop_fd_});
+    if (worker_.joinable()) worker_.join();
+    close(fd_);
+    fd_ = -1;
+    if (stop_fd_ >= 0) {
+        close(stop_fd_);
+        stop_fd_ = -1;
+    }
+}
+
+void MetricsListener::worker() {
+    while (running_) {
+        pollfd fds[2] = {{fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+        int n = poll(fds, stop_fd_ >= 0 ? 2 : 1, stop_fd_ >= 0 ? -1 : 500);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (!running_) break;
+        if (fds[0].revents & POLLIN) receive();
+    }
+}
+
+void MetricsListener::receive() {
+    uint8_t buf[512];
+    ssize_t r;
+    while ((r = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        MetricsSnapshot m;
+        std::string name;
+        uint16_t seq = 0;
+        if (!DecodeMetrics(buf, static_cast<size_t>(r), m, name, seq)) {
+            if (debug_) std::cerr << "Metrics listener: dropped a " << r << " byte datagram" << std::endl;
+            continue;
+        }
+        Host* host = const_cast<Host*>(find(name));
+        if (!host) {
+            const int count = count_.load(std::memory_order_relaxed);
+            if (count == MAX_HOSTS) {
+                if (debug_) std::cerr << "Metrics listener: no slot for " << name << std::endl;
+                continue;
+            }
+            host = &hosts_[static_cast<size_t>(count)];
+            std::memcpy(host->name, name.data(), name.size());
+            host->seq = static_cast<uint16_t>(seq - 1);
+            count_.store(count + 1, std::memory_order_release);
+            std::cout << "Metrics listener: receiving from " << name << std::endl;
+        }
+        // Behind by up to 64: reordered or duplicated. Further back: the sender restarted.
+        const int16_t ahead = static_cast<int16_t>(seq - host->seq);
+        if (ahead <= 0 && ahead > -64) continue;
+        host->seq = seq;
+        host->snapshot.Store(m);
+        host->last_ms.store(now_ms(), std::memory_order_relaxed);
+        wake_all(wake_fds_);
+    }
+}
+
+const MetricsListener::Host* MetricsListener::find(const std::string& name) const {
+    const int count = count_.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+        const Host& h = hosts_[static_cast<size_t>(i)];
+        if (name.size() < METRICS_HOST_LEN && std::strncmp(h.name, name.c_str(), METRICS_HOST_LEN) == 0) return &h;
+    }
+    return nullptr;
+}
+
+bool MetricsListener::Poll(const std::string& host, MetricsSnapshot& view, uint64_t& seen) const {
+    const Host* h = find(host);
+    if (!h || h->snapshot.Version() == seen) return false;
+    seen = h->snapshot.Load(view);
+    return true;
+}
+
+int64_t MetricsListener::AgeMs(const std::string& host) const {
+    const Host* h = find(host);
+    if (!h || h->snapshot.Version() == 0) return -1;
+    return now_ms() - h->last_ms.load(std::memory_order_relaxed);
+}
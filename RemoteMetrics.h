@@ -0,0 +1,121 @@
+#ifndef REMOTE_METRICS_H
+#define REMOTE_METRICS_H
+
+#include "SystemMetrics.h"
+#include "Snapshot.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+
+// Metrics pushed between hosts: one compact UDP datagram per snapshot.
+//
+// A box without a panel (or with one) pushes its own metrics with
+// LCD_METRICS_PUSH=host:port[,host:port]; the box driving the panels
+// listens on LCD_METRICS_PORT and shows a pushed host on any panel whose
+// LCD_PANEL<N>_SOURCE names it. Datagrams are little-endian, fixed layout
+// (version 1):
+//
+//   0  u32 magic "LCDm"       24 u16 cpu, 0.01 %     42 u32 uptime, s
+//   4  u8  version            26 u16 mem, 0.01 %     46 u8  WanState
+//   5  u8  core count         28 u32 mem used, MB    47 i8  disk %
+//   6  u16 sequence           32 i16 temp, 0.01 C    48 i16 docker, wg,
+//   8  16 host name, NUL-pad  34 u32 net1, kbit/s        mc online, mc max
+//                             38 u32 net2, kbit/s    56 u8  per core, 0.5 %
+//
+// Unknown values (-1) survive the trip. A lost datagram costs one tick;
+// the sequence number drops reordered and duplicated ones.
+constexpr size_t METRICS_HOST_LEN = 16;
+constexpr size_t METRICS_PACKET_MAX = 56 + MAX_CPU_CORES;
+
+// Returns the datagram size (at most METRICS_PACKET_MAX)
+size_t EncodeMetrics(const MetricsSnapshot& m, const std::string& host, uint16_t seq, uint8_t* out);
+// false if it is not a version 1 metrics datagram. host gets the sender's name.
+bool DecodeMetrics(const uint8_t* data, size_t size, MetricsSnapshot& m, std::string& host, uint16_t& seq);
+
+class MetricsSender {
+public:
+    // targets: "host:port[,host:port]"; host_name: the name sent (at most 15 chars).
+    // Names are resolved on a thread of the sender's own, retried every few
+    // seconds until they resolve (the network may come up after us).
+    MetricsSender(const std::string& targets, const std::string& host_name);
+    ~MetricsSender();
+
+    MetricsSender(const MetricsSender&) = delete;
+    MetricsSender& operator=(const MetricsSender&) = delete;
+
+    bool Enabled() const { return !targets_.empty(); }
+    // One datagram per resolved target; never blocks
+    void Send(const MetricsSnapshot& m);
+
+private:
+    struct Target {
+        std::string host;
+        std::string port;
+        sockaddr_storage addr{};
+        socklen_t addr_len = 0;
+    };
+    void resolver();
+
+    std::vector<Target> targets_; // addr filled in by the resolver, under mutex_
+    std::string host_name_;
+    int fd4_ = -1;
+    int fd6_ = -1;
+    uint16_t seq_ = 0;
+    std::thread resolver_;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_ = false;
+};
+
+class MetricsListener {
+public:
+    static constexpr int MAX_HOSTS = 8;
+
+    explicit MetricsListener(int port, bool debug = false);
+    ~MetricsListener();
+
+    MetricsListener(const MetricsListener&) = delete;
+    MetricsListener& operator=(const MetricsListener&) = delete;
+
+    // eventfd written for every accepted datagram (render loop wake-up); before Start()
+    void AddWakeFd(int fd) { wake_fds_.push_back(fd); }
+
+    bool Start();
+    void Stop();
+
+    // Any thread: copies host's snapshot into view if newer than seen
+    bool Poll(const std::string& host, MetricsSnapshot& view, uint64_t& seen) const;
+    // Milliseconds since host was last heard from; -1 if never
+    int64_t AgeMs(const std::string& host) const;
+
+private:
+    struct Host {
+        char name[METRICS_HOST_LEN] = {};
+        SeqLock<MetricsSnapshot> snapshot;
+        std::atomic<int64_t> last_ms{0};
+        uint16_t seq = 0; // listener thread only
+    };
+    const Host* find(const std::string& name) const;
+    void worker();
+    void receive();
+
+    int port_;
+    bool debug_;
+    int fd_ = -1;
+    int stop_fd_ = -1;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::vector<int> wake_fds_;
+    // Slots are claimed by the listener thread and published through count_
+    std::array<Host, MAX_HOSTS> hosts_;
+    std::atomic<int> count_{0};
+};
+
+#endif // REMOTE_METRICS_H
@@ -1,8 +1,11 @@
 #include "Renderer.h"
-#include "ILI9488.h"
+#include "DisplayConfig.h"
 #include "Theme.h"
 #include "PrinterClient.h"
 #include "utils.h"
+#include "Profiler.h"
+#include "SeriesRing.h"
+#include "HistoryStore.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -11,11 +14,31 @@
 #include <cstdlib>
 #include <ctime>
 #include <cctype>
-#include <iomanip>
 #include <unistd.h>
 
 #include "stb_truetype.h"
 
+namespace {
+// FNV-1a over the inputs of a layer. Doubles are quantized first so an
+// animation that has visually settled stops invalidating its panel.
+struct LayerSig {
+    uint64_t h = 1469598103934665603ULL;
+    void bytes(const void* p, size_t n) {
+        const auto* b = static_cast<const uint8_t*>(p);
+        for (size_t i = 0; i < n; ++i) {
+            h ^= b[i];
+            h *= 1099511628211ULL;
+        }
+    }
+    void i64(int64_t v) { bytes(&v, sizeof(v)); }
+    void q(double v, double step) { i64(static_cast<int64_t>(std::llround(v / step))); }
+    void str(std::string_view s) {
+        i64(static_cast<int64_t>(s.size()));
+        bytes(s.data(), s.size());
+    }
+};
+}
+
 // --- Sparkline Visual Zoom Parameters ---
 namespace SparklineZoom {
     // NET (Mbps): zoom active at low traffic
@@ -38,6 +61,20 @@ namespace SparklineZoom {
     constexpr double MIN_RANGE_CPU = 0.5;
     constexpr double MIN_RANGE_TEMP = 0.2;
     constexpr double MIN_RANGE_NET = 1.0;
+
+    struct Params {
+        double start;
+        double end;
+        double min_range;
+    };
+
+    // Indexed by MetricType
+    constexpr Params BY_METRIC[] = {
+        {CPU_ZOOM_START, CPU_ZOOM_END, MIN_RANGE_CPU},
+        {TEMP_ZOOM_START, TEMP_ZOOM_END, MIN_RANGE_TEMP},
+        {NET_ZOOM_START, NET_ZOOM_END, MIN_RANGE_NET},
+        {NET_ZOOM_START, NET_ZOOM_END, MIN_RANGE_NET},
+    };
 }
 
 // --- Fill parameters ---
@@ -47,40 +84,98 @@ constexpr double FILL_DECAY_SERIES     = 1.4;    // decay speed series
 constexpr double FILL_ALPHA_SPARK      = 0.70;   // base alpha for sparkline
 constexpr double FILL_DECAY_SPARK      = 1.5;    // decay speed sparkline
 
-// --- Exponential decay lookup table for gradient fills ---
-// Pre-computed exp() values to avoid expensive calculations in hot loops
-constexpr int EXP_LUT_SIZE = 512;
-constexpr double EXP_LUT_MAX = 8.0;  // Max decay value we'll encounter
-static float exp_lut[EXP_LUT_SIZE];
-static bool exp_lut_initialized = false;
-
-// Fast exp lookup with linear interpolation
-inline float fast_exp(double x) {
-    if (x <= 0.0) return 1.0f;
-    if (x >= EXP_LUT_MAX) return 0.0f;
-    double idx_f = (x / EXP_LUT_MAX) * (EXP_LUT_SIZE - 1);
-    int idx = static_cast<int>(idx_f);
-    if (idx >= EXP_LUT_SIZE - 1) return exp_lut[EXP_LUT_SIZE - 1];
-    float t = static_cast<float>(idx_f - idx);
-    return exp_lut[idx] * (1.0f - t) + exp_lut[idx + 1] * t;
+// --- Compile-time math for the lookup tables ---
+// std::exp/std::sin are not constexpr; these series are only evaluated by the
+// compiler when the tables below are built
+namespace cx {
+constexpr double PI = 3.141592653589793;
+
+// e^-x for x >= 0: the series on x/16 converges in a few terms, then square 4 times
+constexpr double exp_neg(double x) {
+    double y = x / 16.0;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 20; ++n) {
+        term *= -y / n;
+        sum += term;
+    }
+    for (int i = 0; i < 4; ++i) sum *= sum;
+    return sum;
 }
 
-// Initialize lookup table
-inline void init_exp_lut() {
-    if (exp_lut_initialized) return;
-    for (int i = 0; i < EXP_LUT_SIZE; ++i) {
-        double x = (static_cast<double>(i) / (EXP_LUT_SIZE - 1)) * EXP_LUT_MAX;
-        exp_lut[i] = static_cast<float>(std::exp(-x));
+constexpr double sin(double a) {
+    while (a > PI) a -= 2.0 * PI;
+    while (a < -PI) a += 2.0 * PI;
+    double term = a;
+    double sum = a;
+    for (int n = 1; n < 14; ++n) {
+        term *= -a * a / ((2 * n) * (2 * n + 1));
+        sum += term;
     }
-    exp_lut_initialized = true;
+    return sum;
+}
+}
+
+// --- Fill gradient ramps ---
+// Alpha (0..32) of the fill as a function of the normalized distance below
+// the line, sampled at FILL_RAMP_SIZE points over [0, 1]. A fill column walks
+// the ramp with a fixed-point step instead of evaluating exp() per pixel.
+constexpr int FILL_RAMP_SIZE = 256;
+
+struct FillRamp {
+    uint8_t a[FILL_RAMP_SIZE];
+};
+
+// peak * e^-(decay * n), or with a two-stage head: a linear drop over
+// [0, head) followed by tail * the exponential fade from there
+constexpr FillRamp make_fill_ramp(double peak, double decay, double head, double head_slope, double tail) {
+    FillRamp r{};
+    for (int i = 0; i < FILL_RAMP_SIZE; ++i) {
+        double n = static_cast<double>(i) / (FILL_RAMP_SIZE - 1);
+        double alpha = 0.0;
+        if (head > 0.0) {
+            alpha = (n < head) ? peak * (1.0 - n * head_slope) : peak * tail * cx::exp_neg(decay * (n - head));
+        } else {
+            alpha = peak * cx::exp_neg(decay * n);
+        }
+        int q = static_cast<int>(alpha * 32.0 + 0.5);
+        r.a[i] = static_cast<uint8_t>(q < 0 ? 0 : (q > 32 ? 32 : q));
+    }
+    return r;
+}
+
+static constexpr FillRamp SPARK_RAMP = make_fill_ramp(FILL_ALPHA_SPARK, FILL_DECAY_SPARK, 0.0, 0.0, 1.0);
+static constexpr FillRamp SPARK_RAMP_ENHANCED = make_fill_ramp(FILL_ALPHA_SPARK, FILL_DECAY_SPARK, 0.2, 2.0, 0.6);
+static constexpr FillRamp SERIES_RAMP = make_fill_ramp(FILL_INTENSITY_SERIES, FILL_DECAY_SERIES, 0.0, 0.0, 1.0);
+static constexpr FillRamp SERIES_RAMP_ENHANCED = make_fill_ramp(FILL_INTENSITY_SERIES, FILL_DECAY_SERIES, 0.15, 3.0, 0.7);
+
+// 16.16 ramp position -> table index
+static inline int ramp_index(int32_t pos) {
+    if (pos <= 0) return 0;
+    int i = pos >> 16;
+    return i < FILL_RAMP_SIZE - 1 ? i : FILL_RAMP_SIZE - 1;
 }
 
 // --- Trigonometric lookup table for arc drawing ---
-// Pre-computed sin/cos values to avoid expensive trig calls in arc rendering
+// Built at compile time; linear interpolation between entries
 constexpr int TRIG_LUT_SIZE = 1024;  // 1024 entries for 360 degrees (0.35° precision)
-static float sin_lut[TRIG_LUT_SIZE];
-static float cos_lut[TRIG_LUT_SIZE];
-static bool trig_lut_initialized = false;
+
+struct TrigLut {
+    float sin[TRIG_LUT_SIZE];
+    float cos[TRIG_LUT_SIZE];
+};
+
+constexpr TrigLut make_trig_lut() {
+    TrigLut t{};
+    for (int i = 0; i < TRIG_LUT_SIZE; ++i) {
+        double angle = (static_cast<double>(i) / (TRIG_LUT_SIZE - 1)) * 2.0 * cx::PI;
+        t.sin[i] = static_cast<float>(cx::sin(angle));
+        t.cos[i] = static_cast<float>(cx::sin(angle + cx::PI / 2.0));
+    }
+    return t;
+}
+
+static constexpr TrigLut TRIG_LUT = make_trig_lut();
 
 // Fast sin lookup with linear interpolation
 inline float fast_sin(double angle) {
@@ -91,10 +186,10 @@ inline float fast_sin(double angle) {
 
     double idx_f = (normalized / kTwoPi) * (TRIG_LUT_SIZE - 1);
     int idx = static_cast<int>(idx_f);
-    if (idx >= TRIG_LUT_SIZE - 1) return sin_lut[0];  // Wrap around
+    if (idx >= TRIG_LUT_SIZE - 1) return TRIG_LUT.sin[0];  // Wrap around
 
     float t = static_cast<float>(idx_f - idx);
-    return sin_lut[idx] * (1.0f - t) + sin_lut[idx + 1] * t;
+    return TRIG_LUT.sin[idx] * (1.0f - t) + TRIG_LUT.sin[idx + 1] * t;
 }
 
 // Fast cos lookup with linear interpolation
@@ -105,33 +200,14 @@ inline float fast_cos(double angle) {
 
     double idx_f = (normalized / kTwoPi) * (TRIG_LUT_SIZE - 1);
     int idx = static_cast<int>(idx_f);
-    if (idx >= TRIG_LUT_SIZE - 1) return cos_lut[0];
+    if (idx >= TRIG_LUT_SIZE - 1) return TRIG_LUT.cos[0];
 
     float t = static_cast<float>(idx_f - idx);
-    return cos_lut[idx] * (1.0f - t) + cos_lut[idx + 1] * t;
+    return TRIG_LUT.cos[idx] * (1.0f - t) + TRIG_LUT.cos[idx + 1] * t;
 }
 
-// Initialize trig lookup tables
-inline void init_trig_lut() {
-    if (trig_lut_initialized) return;
-    constexpr double kTwoPi = 6.283185307179586;
-    for (int i = 0; i < TRIG_LUT_SIZE; ++i) {
-        double angle = (static_cast<double>(i) / (TRIG_LUT_SIZE - 1)) * kTwoPi;
-        sin_lut[i] = static_cast<float>(std::sin(angle));
-        cos_lut[i] = static_cast<float>(std::cos(angle));
-    }
-    trig_lut_initialized = true;
-}
-
-namespace Layout {
-    constexpr int HEADER_HEIGHT = 42;
-    constexpr int FOOTER_HEIGHT = 0;
-    constexpr int MARGIN = 12;
-    constexpr int GAP = 10;
-    // Narrower right panel (~1.5x) to give sparklines more width
-    constexpr int LEFT_PANEL_WIDTH = 355;
-    constexpr int VITALS_PANEL_HEIGHT = 160;
-}
+const char* const NET_SUBTITLE_120S = "last 120s | independent auto-scale";
+const char* const NET_SUBTITLE_24H = "last 24h | independent auto-scale";
 
 // --- Helper Functions ---
 
@@ -165,6 +241,43 @@ static inline color_t rgb888_to_rgb565(uint8_t r, uint8_t g, uint8_t b) {
     return static_cast<color_t>((rr << 11) | (gg << 5) | bb);
 }
 
+// Packed RGB565 arithmetic: green is moved to the high half-word so red, green
+// and blue sit in one word with guard bits between them (0x07E0F81F), and all
+// three channels are processed with one multiply or add.
+static inline uint32_t spread565(color_t c) {
+    return (c | (static_cast<uint32_t>(c) << 16)) & 0x07E0F81Fu;
+}
+
+static inline color_t pack565(uint32_t s) {
+    return static_cast<color_t>(s | (s >> 16));
+}
+
+// a = 0..32
+static inline color_t mix565(color_t dst, color_t src, uint32_t a) {
+    uint32_t d = spread565(dst);
+    uint32_t s = spread565(src);
+    return pack565(((((s - d) * a) >> 5) + d) & 0x07E0F81Fu);
+}
+
+// a = coverage 0..255
+static inline color_t blend565(color_t dst, color_t src, uint32_t a) {
+    return mix565(dst, src, (a + 4) >> 3);
+}
+
+// src * a / 32 per channel, rounded; a = 0..32
+static inline uint32_t scale_spread(uint32_t s, uint32_t a) {
+    return ((s * a + 0x02008010u) >> 5) & 0x07E0F81Fu;
+}
+
+// Per-channel saturating add: a carry lands in the guard bit above its field
+// and is turned into an all-ones field
+static inline uint32_t add_sat_spread(uint32_t d, uint32_t s) {
+    uint32_t sum = d + s;
+    uint32_t ov_rb = sum & 0x00010020u;
+    uint32_t ov_g = sum & 0x08000000u;
+    return (sum | (ov_rb - (ov_rb >> 5)) | (ov_g - (ov_g >> 6))) & 0x07E0F81Fu;
+}
+
 static double clamp(double v, double lo, double hi) {
     if (v < lo) return lo;
     if (v > hi) return hi;
@@ -181,14 +294,49 @@ static color_t scale_color(color_t c, float factor) {
     return (r << 11) | (g << 5) | b;
 }
 
+// c with each channel multiplied by its factor (saturating)
+static color_t tint565(color_t c, double fr, double fg, double fb) {
+    uint8_t r, g, b;
+    rgb565_to_rgb888(c, r, g, b);
+    return rgb888_to_rgb565(static_cast<uint8_t>(std::min(255.0, r * fr)),
+                            static_cast<uint8_t>(std::min(255.0, g * fg)),
+                            static_cast<uint8_t>(std::min(255.0, b * fb)));
+}
+
+// EFFECT 9 colour zone of segment i: 0 = low, 1 = neutral, 2 = high
+static int fill_zone(bool enabled, const std::vector<double>& values, size_t i) {
+    if (!enabled || i >= values.size()) return 1;
+    if (values[i] < 0.33) return 0;
+    if (values[i] > 0.66) return 2;
+    return 1;
+}
+
+// One column of a fill gradient: visible rows [py0, py1] and the 16.16
+// position of py0 on the ramp, advancing by step per row
+struct FillColumn {
+    int py0 = 0;
+    int py1 = -1;
+    int32_t pos = 0;
+    int32_t step = 0;
+};
+
+// The ramp spans from the line (top_f, clamped to [clip_top, bottom_y]) down
+// to bottom_y. False if no row is on screen.
+static bool fill_column(double top_f, int clip_top, int bottom_y, FillColumn& col) {
+    int top = static_cast<int>(std::round(top_f));
+    if (top < clip_top) top = clip_top;
+    if (top > bottom_y) top = bottom_y;
+    double scale = (FILL_RAMP_SIZE - 1) / std::max(1.0, static_cast<double>(bottom_y - top)) * 65536.0;
+    col.py0 = std::max(top, 0);
+    col.py1 = std::min(bottom_y, DISPLAY_HEIGHT - 1);
+    col.pos = static_cast<int32_t>(std::lround((col.py0 - top_f) * scale));
+    col.step = static_cast<int32_t>(std::lround(scale));
+    return col.py0 <= col.py1;
+}
+
 // --- Renderer Implementation ---
 
 Renderer::Renderer() {
-    // Initialize exponential decay lookup table for gradient fills
-    init_exp_lut();
-    // Initialize trigonometric lookup tables for arc drawing
-    init_trig_lut();
-
     idle_t_ = 0.0f;
     net1_scale_max_ = 0.0;
     net2_scale_max_ = 0.0;
@@ -203,14 +351,16 @@ Renderer::Renderer() {
     grid_enabled_ = getenv_bool("LCD_GRID", false);
     band_enabled_ = getenv_bool("LCD_BAND", false);
 
+    text_aa_ = getenv_bool("LCD_TEXT_AA", text_aa_);
     loadFont(getenv_string("LCD_FONT", "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf"), 16.0f);
 
     history_size_ = (DISPLAY_WIDTH >= 400 ? 120 : 60);
 
-    history_cpu_.clear();
-    history_temp_.clear();
-    history_net1_.clear();
-    history_net2_.clear();
+    history_cpu_.Reset(history_size_);
+    history_temp_.Reset(history_size_);
+    history_net1_.Reset(history_size_);
+    history_net2_.Reset(history_size_);
+    net_range_day_ = getenv_string("LCD_NET_GRAPH_RANGE", "live") == "24h";
 
     ticker_text_ = "";
     ticker_offset_px_ = 0.0f;
@@ -232,6 +382,7 @@ Renderer::Renderer() {
 
     // Sparkline visual enhancements
     sparkline_pulse_ = getenv_bool("LCD_SPARKLINE_PULSE", sparkline_pulse_);
+    retained_ = getenv_bool("LCD_RENDER_RETAINED", retained_);
     sparkline_peak_highlight_ = getenv_bool("LCD_SPARKLINE_PEAK_HIGHLIGHT", sparkline_peak_highlight_);
     sparkline_gradient_line_ = getenv_bool("LCD_SPARKLINE_GRADIENT_LINE", sparkline_gradient_line_);
     sparkline_particles_ = getenv_bool("LCD_SPARKLINE_PARTICLES", sparkline_particles_);
@@ -241,9 +392,41 @@ Renderer::Renderer() {
     sparkline_shadow_ = getenv_bool("LCD_SPARKLINE_SHADOW", sparkline_shadow_);
     sparkline_color_zones_ = getenv_bool("LCD_SPARKLINE_COLOR_ZONES", sparkline_color_zones_);
     sparkline_smooth_transitions_ = getenv_bool("LCD_SPARKLINE_SMOOTH_TRANSITIONS", sparkline_smooth_transitions_);
+    trace_fx_ = traceEffects();
+    chrome_steps_ = std::clamp(getenv_int("LCD_CHROME_IDLE_STEPS", chrome_steps_), 1, 64);
+    compileLayout(DefaultScreenLayout());
+    ReloadLayout();
+}
+
+bool Renderer::ReloadLayout() {
+    const std::string path = getenv_string("LCD_LAYOUT_FILE", "");
+    if (path.empty()) return true; // built-in layout, nothing to reload
+    ScreenLayout layout;
+    std::string error;
+    if (!LoadScreenLayout(path, layout, error)) {
+        std::cerr << "Layout " << path << ": " << error << " (keeping the current layout)" << std::endl;
+        return false;
+    }
+    compileLayout(layout);
+    std::cout << "Layout " << path << ": " << widgets_.size() << " widgets" << std::endl;
+    return true;
+}
+
+void Renderer::compileLayout(const ScreenLayout& layout) {
+    widgets_.clear();
+    widgets_.reserve(layout.main.size());
+    for (const auto& spec : layout.main) {
+        widgets_.push_back(Widget{spec.kind, spec.rect, spec.title, spec.value_size, spec.color_a, spec.color_b,
+                                  {}, {}});
+    }
+    print_preview_ = layout.print_preview;
+    print_status_ = layout.print_status;
+    print_layer_ = Layer{};
+    ++layout_version_; // new chrome, so the next frame repaints everything
 }
 
 Renderer::~Renderer() {
+    glyphs_.reset();
     if (font_info_) {
         delete static_cast<stbtt_fontinfo*>(font_info_);
     }
@@ -251,6 +434,7 @@ Renderer::~Renderer() {
 
 void Renderer::loadFont(const std::string& font_path, float /*size*/) {
     // Освободить предыдущий шрифт если был
+    glyphs_.reset();
     if (font_info_) {
         delete static_cast<stbtt_fontinfo*>(font_info_);
         font_info_ = nullptr;
@@ -274,26 +458,19 @@ void Renderer::loadFont(const std::string& font_path, float /*size*/) {
         std::cerr << "Failed to initialize font" << std::endl;
         delete static_cast<stbtt_fontinfo*>(font_info_);
         font_info_ = nullptr;
+        return;
     }
+    glyphs_.reset(new GlyphCache(static_cast<stbtt_fontinfo*>(font_info_)));
 }
 
-int Renderer::measureTextWidth(const std::string& text, float size) {
-    if (!font_info_) return 0;
-    auto* info = static_cast<stbtt_fontinfo*>(font_info_);
-    float scale = stbtt_ScaleForPixelHeight(info, size);
-    int width = 0;
-    for (char c : text) {
-        int advance, lsb;
-        stbtt_GetCodepointHMetrics(info, c, &advance, &lsb);
-        width += static_cast<int>(advance * scale);
-    }
-    return width;
+int Renderer::measureTextWidth(std::string_view text, float size) {
+    if (!glyphs_) return 0;
+    return glyphs_->measure(glyphs_->face(size), text.data(), text.size());
 }
 
-void Renderer::UpdateHistories(const SystemMetrics& metrics) {
-    auto push = [&](std::deque<double>& dq, double v) {
-        if (dq.size() >= history_size_) dq.pop_front();
-        dq.push_back(v);
+void Renderer::UpdateHistories(const MetricsSnapshot& metrics) {
+    auto push = [](SeriesRing& ring, double v) {
+        ring.Push(static_cast<float>(v));
     };
     push(history_cpu_, metrics.cpu_usage);
     push(history_temp_, metrics.temp);
@@ -325,15 +502,100 @@ void Renderer::UpdateHistories(const SystemMetrics& metrics) {
 
     push(history_net1_, net1_value);
     push(history_net2_, net2_value);
+    ++history_version_;
+
+    if (store_) {
+        const int64_t now = HistoryStore::NowMs();
+        store_->Push(HistoryStore::CPU, static_cast<float>(metrics.cpu_usage), now);
+        store_->Push(HistoryStore::TEMP, static_cast<float>(metrics.temp), now);
+        store_->Push(HistoryStore::NET1, static_cast<float>(net1_value), now);
+        store_->Push(HistoryStore::NET2, static_cast<float>(net2_value), now);
+    }
+}
+
+void Renderer::AttachHistory(HistoryStore* store) {
+    store_ = (store && store->IsOpen()) ? store : nullptr;
+    if (!store_) return;
+
+    constexpr int64_t MAX_RESTORE_AGE_MS = 3600 * 1000;
+    const int64_t now = HistoryStore::NowMs();
+    std::vector<HistoryStore::Bucket> raw;
+    auto restore = [&](HistoryStore::Series s, SeriesRing& ring) -> bool {
+        int64_t last = store_->LastTime(s, HistoryStore::RAW);
+        if (last <= 0 || now - last > MAX_RESTORE_AGE_MS) return false;
+        if (store_->Read(s, HistoryStore::RAW, raw) == 0) return false;
+        ring.Clear();
+        for (const auto& b : raw) ring.Push(b.avg);
+        return true;
+    };
+    restore(HistoryStore::CPU, history_cpu_);
+    restore(HistoryStore::TEMP, history_temp_);
+    // Continue the EMA from the last persisted value instead of restarting it
+    if (restore(HistoryStore::NET1, history_net1_)) {
+        net1_smooth_ = history_net1_.back();
+        net1_initialized_ = true;
+    }
+    if (restore(HistoryStore::NET2, history_net2_)) {
+        net2_smooth_ = history_net2_.back();
+        net2_initialized_ = true;
+    }
+    ++history_version_;
+    day_version_ = ~0ull;
 }
 
-void Renderer::UpdateTickerText(const SystemMetrics& metrics) {
-    std::string wan = "WAN " + metrics.get_wan_status();
+bool Renderer::LastKnown(MetricsSnapshot& metrics) const {
+    if (!store_) return false;
+    bool any = false;
+    auto take = [&any](const SeriesRing& ring, double& out) {
+        if (ring.empty()) return;
+        out = ring.back();
+        any = true;
+    };
+    take(history_cpu_, metrics.cpu_usage);
+    take(history_temp_, metrics.temp);
+    take(history_net1_, metrics.net1_mbps);
+    take(history_net2_, metrics.net2_mbps);
+    return any;
+}
+
+void Renderer::refreshDayHistory() {
+    if (!store_ || store_->Version(HistoryStore::MIN) == day_version_) return;
+    day_version_ = store_->Version(HistoryStore::MIN);
+
+    // 1440 one-minute buckets averaged down to at most 240 points (6 min each),
+    // grouped from the newest end so the last point is always whole
+    constexpr size_t MAX_POINTS = 240;
+    std::vector<HistoryStore::Bucket> buckets;
+    auto build = [&](HistoryStore::Series s, SeriesRing& ring) {
+        size_t n = store_->Read(s, HistoryStore::MIN, buckets);
+        size_t group = std::max<size_t>(1, (n + MAX_POINTS - 1) / MAX_POINTS);
+        size_t points = (n + group - 1) / group;
+        if (ring.capacity() != MAX_POINTS) ring.Reset(MAX_POINTS);
+        ring.Clear();
+        for (size_t p = 0; p < points; ++p) {
+            size_t end = n - (points - 1 - p) * group;
+            size_t begin = end >= group ? end - group : 0;
+            double sum = 0.0;
+            uint64_t count = 0;
+            for (size_t i = begin; i < end; ++i) {
+                sum += static_cast<double>(buckets[i].avg) * buckets[i].count;
+                count += buckets[i].count;
+            }
+            // Minutes with no samples (service down) read as zero throughput
+            ring.Push(count ? static_cast<float>(sum / count) : 0.0f);
+        }
+    };
+    build(HistoryStore::NET1, day_net1_);
+    build(HistoryStore::NET2, day_net2_);
+}
+
+void Renderer::UpdateTickerText(const MetricsSnapshot& metrics) {
+    std::string wan = std::string("WAN ") + metrics.get_wan_status();
     std::string wg = (metrics.wg_active_peers >= 0)
                          ? "WG " + std::to_string(metrics.wg_active_peers)
                          : "WG -";
-    std::string n1 = "NET1 " + formatNet(metrics.net1_mbps);
-    std::string n2 = "NET2 " + formatNet(metrics.net2_mbps);
+    std::string n1 = "NET1 " + std::string(formatNet(metrics.net1_mbps).view());
+    std::string n2 = "NET2 " + std::string(formatNet(metrics.net2_mbps).view());
     std::string docker = (metrics.docker_running >= 0)
                              ? "Docker " + std::to_string(metrics.docker_running)
                              : "Docker -";
@@ -358,62 +620,72 @@ color_t Renderer::dimColor(color_t c) const {
     return interpolate_color(c, scale_color(c, 0.6f), idle_t_);
 }
 
-std::string Renderer::formatNet(double mbps) const {
-    if (mbps >= 1000.0) {
-        double gb = mbps / 1000.0;
-        char buf[16];
-        std::snprintf(buf, sizeof(buf), "%.1fG", gb);
-        return std::string(buf);
-    }
-    if (mbps >= 1.0) {
-        char buf[16];
-        std::snprintf(buf, sizeof(buf), "%.0fM", mbps);
-        return std::string(buf);
-    }
-    char buf[16];
-    std::snprintf(buf, sizeof(buf), "%.1fM", mbps);
-    return std::string(buf);
+// A throughput as formatNet() shows it: 0.1G steps, whole M, 0.1M below 1M
+namespace {
+struct NetLabel {
+    long long scaled;
+    int decimals;
+    char unit;
+    // Distinct for every distinct text, for LabelMemo
+    int64_t key() const { return scaled * 3 + (unit == 'G' ? 2 : decimals); }
+};
+
+NetLabel net_label(double mbps) {
+    if (mbps >= 1000.0) return {quantize(mbps / 1000.0, 1), 1, 'G'};
+    if (mbps >= 1.0) return {quantize(mbps, 0), 0, 'M'};
+    return {quantize(mbps, 1), 1, 'M'};
 }
 
-std::string Renderer::formatScaleValue(double value) const {
-    char buf[16];
+template <size_t N>
+void append_net(SmallString<N>& s, const NetLabel& l) {
+    s.appendFixed(l.scaled, l.decimals).append(l.unit);
+}
+}
+
+SmallString<16> Renderer::formatNet(double mbps) const {
+    SmallString<16> s;
+    append_net(s, net_label(mbps));
+    return s;
+}
+
+SmallString<16> Renderer::formatScaleValue(double value) const {
+    SmallString<16> s;
     if (value >= 1000.0) {
-        std::snprintf(buf, sizeof(buf), "%.1fk", value / 1000.0);
-    } else if (value >= 100.0) {
-        std::snprintf(buf, sizeof(buf), "%.0f", value);
+        s.appendFixed(quantize(value / 1000.0, 1), 1).append('k');
     } else if (value >= 10.0) {
-        std::snprintf(buf, sizeof(buf), "%.0f", value);
-    } else if (value >= 1.0) {
-        std::snprintf(buf, sizeof(buf), "%.1f", value);
+        s.appendFixed(quantize(value, 0), 0);
     } else if (value > 0.0) {
-        std::snprintf(buf, sizeof(buf), "%.1f", value);
+        s.appendFixed(quantize(value, 1), 1);
     } else {
-        std::snprintf(buf, sizeof(buf), "0");
+        s.append('0');
     }
-    return std::string(buf);
+    return s;
+}
+
+// The uptime as formatUptime() shows it, at its precision (a LabelMemo key)
+static int64_t uptime_key(int seconds) {
+    if (seconds < 60) return seconds;
+    if (seconds < 24 * 3600) return seconds / 60 * 60;
+    return seconds / 3600 * 3600;
 }
 
-std::string Renderer::formatUptime(int seconds) const {
-    if (seconds < 60) return std::to_string(seconds) + "s";
+SmallString<16> Renderer::formatUptime(int seconds) const {
+    SmallString<16> s;
+    if (seconds < 60) return s.appendInt(seconds).append('s');
     int minutes = seconds / 60;
-    if (minutes < 60) return std::to_string(minutes) + "m";
+    if (minutes < 60) return s.appendInt(minutes).append('m');
     int hours = minutes / 60;
     int rem = minutes % 60;
-    if (hours < 24) return std::to_string(hours) + "h " + std::to_string(rem) + "m";
+    if (hours < 24) return s.appendInt(hours).append("h ").appendInt(rem).append('m');
     int days = hours / 24;
     int remh = hours % 24;
-    return std::to_string(days) + "d " + std::to_string(remh) + "h";
+    return s.appendInt(days).append("d ").appendInt(remh).append('h');
 }
 
-double Renderer::computeNetScale(const std::deque<double>& history, double& smooth_max) {
+double Renderer::computeNetScale(const SeriesRing& history, double& smooth_max) {
     if (history.empty()) return net_autoscale_max_;
-    scratch_values_.clear();
-    scratch_values_.insert(scratch_values_.end(), history.begin(), history.end());
-    std::sort(scratch_values_.begin(), scratch_values_.end());
-    double p = clamp(net_autoscale_pctl_, 0.0, 100.0) / 100.0;
-    size_t idx = static_cast<size_t>(std::round(p * (scratch_values_.size() - 1)));
-    if (idx >= scratch_values_.size()) idx = scratch_values_.size() - 1;
-    double raw = scratch_values_[idx];
+    // The ring keeps its samples sorted, so the percentile is a lookup
+    double raw = history.Percentile(clamp(net_autoscale_pctl_, 0.0, 100.0) / 100.0);
     raw = std::max(raw, net_autoscale_min_);
     raw = std::min(raw, net_autoscale_max_);
     if (smooth_max <= 0.0) {
@@ -426,64 +698,50 @@ double Renderer::computeNetScale(const std::deque<double>& history, double& smoo
     return smooth_max;
 }
 
-void Renderer::Render(const SystemMetrics& metrics,
+void Renderer::bindAnimator(AnimationEngine& animator) {
+    if (anim_.owner == &animator) return;
+    anim_.owner = &animator;
+    anim_.cpu = animator.add("cpu");
+    anim_.temp = animator.add("temp");
+    anim_.net1 = animator.add("net1");
+    anim_.net2 = animator.add("net2");
+    anim_.gamma[static_cast<int>(MetricType::CPU)] = animator.add("cpu_gamma");
+    anim_.gamma[static_cast<int>(MetricType::TEMP)] = animator.add("temp_gamma");
+    anim_.gamma[static_cast<int>(MetricType::NET1)] = animator.add("net1_gamma");
+    anim_.gamma[static_cast<int>(MetricType::NET2)] = animator.add("net2_gamma");
+}
+
+void Renderer::Render(const MetricsSnapshot& metrics,
                       const PrinterMetrics& printer,
                       AnimationEngine& animator,
                       const IdleModeController& idle_controller,
                       double time_sec,
-                      std::vector<uint16_t>& buffer) {
+                      std::vector<uint16_t>& buffer,
+                      std::vector<Rect>* invalidated) {
     target_buffer_ = &buffer;
+    scene_animated_ = false;
+    if (invalidated) invalidated->clear();
     idle_t_ = static_cast<float>(idle_controller.get_transition_progress());
     double idle_t = idle_t_;
-    color_t bg_top = interpolate_color(current_theme_.bg_top_active, current_theme_.bg_top_idle, idle_t);
 
-    // Static background (no gradient)
+    bool full = !retained_;
     if (buffer.size() != DISPLAY_WIDTH * DISPLAY_HEIGHT) {
-        buffer.assign(DISPLAY_WIDTH * DISPLAY_HEIGHT, bg_top);
-    } else {
-        std::fill(buffer.begin(), buffer.end(), bg_top);
-    }
-
-    int header_h = Layout::HEADER_HEIGHT;
-    int footer_h = Layout::FOOTER_HEIGHT;
-    int margin = Layout::MARGIN;
-    int gap = Layout::GAP;
-    int left_w = Layout::LEFT_PANEL_WIDTH;
-    int right_w = DISPLAY_WIDTH - 2 * margin - gap - left_w;
-
-    int content_y0 = header_h + 10;
-    int content_y1 = DISPLAY_HEIGHT - footer_h - 8;
-    int graph_h = (content_y1 - content_y0 - gap) / 2;
-
-    int g1_x = margin;
-    int g1_y = content_y0;
-    int g1_w = left_w;
-    int g1_h = graph_h;
-
-    int g2_x = margin;
-    int g2_y = g1_y + g1_h + gap;
-    int g2_w = left_w;
-    int g2_h = graph_h;
-
-    int r1_x = g1_x + g1_w + gap;
-    int r1_y = content_y0;
-    int r1_w = right_w;
-    int r1_h = content_y1 - content_y0;
-
-    double cpu = animator.get("cpu", metrics.cpu_usage);
-    double temp = animator.get("temp", metrics.temp);
-    double net1 = animator.get("net1", metrics.net1_mbps);
-    double net2 = animator.get("net2", metrics.net2_mbps);
-
-    // Fixed palette for series (do not depend on state)
-    color_t series_net1 = dimColor(RGB(0, 210, 255));    // vivid cyan/blue
-    color_t series_net2 = dimColor(RGB(255, 220, 0));    // vivid yellow
-    color_t series_cpu  = dimColor(RGB(0, 255, 80));     // vivid green
-    color_t series_temp = dimColor(RGB(255, 140, 80));   // warm orange
+        buffer.assign(DISPLAY_WIDTH * DISPLAY_HEIGHT, 0);
+        full = true;
+    }
+    if (buffer.data() != scene_data_) {
+        full = true;
+    }
+
+    bindAnimator(animator);
+    double cpu = animator.get(anim_.cpu, metrics.cpu_usage);
+    double temp = animator.get(anim_.temp, metrics.temp);
+    double net1 = animator.get(anim_.net1, metrics.net1_mbps);
+    double net2 = animator.get(anim_.net2, metrics.net2_mbps);
 
     // Determine Print Screen eligibility and toggle MAIN/PRINT with asymmetric durations
     double now = time_sec;
-    bool print_active = (printer.state == "printing" || printer.state == "paused");
+    bool print_active = (printer.state == PrinterState::PRINTING || printer.state == PrinterState::PAUSED);
     bool print_eligible = false;
     if (print_active) {
         print_eligible = true;
@@ -512,93 +770,329 @@ void Renderer::Render(const SystemMetrics& metrics,
     }
     last_print_eligible_ = print_eligible;
 
-    if (print_eligible && screen_mode_ == ScreenMode::PRINT) {
-        drawPrintScreen(printer, animator, time_sec);
+    ScreenMode shown = (print_eligible && screen_mode_ == ScreenMode::PRINT) ? ScreenMode::PRINT : ScreenMode::MAIN;
+    const int chrome_step = static_cast<int>(std::lround(idle_t * chrome_steps_));
+    const std::vector<uint16_t>& chrome = chromeFrame(shown, chrome_step);
+    chrome_cur_ = &chrome;
+    if (shown != scene_mode_ || chrome_step != scene_step_) full = true;
+
+    if (full) {
+        std::copy(chrome.begin(), chrome.end(), buffer.begin());
+        for (auto& w : widgets_) w.layer.valid = false;
+        print_layer_.valid = false;
+        scene_data_ = buffer.data();
+        scene_step_ = chrome_step;
+        scene_mode_ = shown;
+        if (invalidated) invalidated->push_back({0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT});
+    }
+    // Panel contents dim with the exact idle_t, not the chrome step
+    // (the endpoints are signed separately, so the last sub-step of a
+    // crossfade still repaints to the exact final look)
+    auto sign_idle = [idle_t](LayerSig& sig) {
+        sig.q(idle_t, 1.0 / 512.0);
+        sig.i64(idle_t <= 0.0 ? 0 : (idle_t >= 1.0 ? 2 : 1));
+    };
+
+    if (shown == ScreenMode::PRINT) {
+        LayerSig sig;
+        sig.i64(static_cast<int64_t>(printer.state));
+        sig.str(printer.filename);
+        sig.q(printer.progress01, 1e-4);
+        sig.i64(printer.elapsed_sec);
+        sig.i64(printer.eta_sec);
+        sig.i64(static_cast<int64_t>(reinterpret_cast<uintptr_t>(printer.thumb.get())));
+        sign_idle(sig);
+        if (beginLayer(print_layer_, {0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT}, sig.h, false, invalidated)) {
+            PROFILE_SCOPE("render.print");
+            drawPrintScreen(printer, animator, time_sec);
+        }
         return;
     }
 
-    drawHeader(0, 0, DISPLAY_WIDTH, header_h, metrics);
-
+    const bool net_day = net_range_day_ && store_;
+    if (net_day) refreshDayHistory();
+    const SeriesRing& net1_hist = net_day ? day_net1_ : history_net1_;
+    const SeriesRing& net2_hist = net_day ? day_net2_ : history_net2_;
     double net1_hist_max = 2500.0;
     double net2_hist_max = 2500.0;
     if (net_autoscale_) {
-        net1_hist_max = computeNetScale(history_net1_, net1_scale_max_);
-        net2_hist_max = computeNetScale(history_net2_, net2_scale_max_);
-    }
-    std::string net_values = "N1 " + formatNet(net1) + "  N2 " + formatNet(net2);
-    drawGraphPanel(g1_x, g1_y, g1_w, g1_h,
-                   "Network Throughput", net_values,
-                   "last 120s | independent auto-scale",
-                   "NET1 Mbps", "NET2 Mbps",
-                   history_net1_, history_net2_,
-                   0.0, net1_hist_max,
-                   0.0, net2_hist_max,
-                   series_net1, series_net2,
-                   MetricType::NET1, MetricType::NET2, animator, time_sec);
-
-    std::string cpu_values = "CPU " + std::to_string(static_cast<int>(cpu)) + "%  TEMP " +
-                             std::to_string(static_cast<int>(temp)) + "C";
-    drawGraphPanel(g2_x, g2_y, g2_w, g2_h,
-                   "CPU & TEMP", cpu_values,
-                   "last 120s | 0-100",
-                   "CPU %", "TEMP C",
-                   history_cpu_, history_temp_,
-                   0.0, 100.0,
-                   0.0, 100.0,
-                   series_cpu, series_temp,
-                   MetricType::CPU, MetricType::TEMP, animator, time_sec);
+        net1_hist_max = computeNetScale(net1_hist, net1_scale_max_);
+        net2_hist_max = computeNetScale(net2_hist, net2_scale_max_);
+    }
+    // Value labels live in their widgets and are re-formatted only when a
+    // shown digit changes
+    const NetLabel n1 = net_label(net1);
+    const NetLabel n2 = net_label(net2);
+    const int cpu_shown = static_cast<int>(cpu);
+    const int temp_shown = static_cast<int>(temp);
+    // The endpoint pulse follows time_sec, so graphs repaint every frame while it is on
+    const bool graphs_animated = sparkline_pulse_;
 
     double mem = metrics.mem_percent;
     color_t mem_color = pickStateColor(mem, "ram");
-    std::string wan_status = metrics.get_wan_status();
-    drawVitalsPanel(r1_x, r1_y, r1_w, r1_h, cpu, temp, mem, net1, wan_status,
-                    pickStateColor(cpu, "cpu"), pickStateColor(temp, "temp"), mem_color,
-                    pickStateColor(net1, "net"));
-    // No Services panel and no Footer ticker in simplified layout
+    WanState wan_state = metrics.wan_state;
+    color_t cpu_color = pickStateColor(cpu, "cpu");
+    color_t temp_color = pickStateColor(temp, "temp");
+    color_t net_color = pickStateColor(net1, "net");
+
+    for (Widget& wd : widgets_) {
+        const Rect& r = wd.rect;
+        LayerSig sig;
+        switch (wd.kind) {
+        case WidgetKind::HEADER:
+            sig.i64(static_cast<int64_t>(metrics.wan_state));
+            sig.i64(metrics.wg_active_peers);
+            sig.i64(metrics.mc_online);
+            sig.i64(metrics.mc_max);
+            if (uptime_label_.Update(uptime_key(metrics.uptime_seconds))) {
+                uptime_label_.text = formatUptime(metrics.uptime_seconds);
+            }
+            sig.str(uptime_label_.text);
+            sign_idle(sig);
+            if (beginLayer(wd.layer, r, sig.h, false, invalidated)) {
+                PROFILE_SCOPE("render.header");
+                drawHeader(r.x, r.y, r.w, r.h, metrics, uptime_label_.text);
+            }
+            break;
+        case WidgetKind::NET_GRAPH:
+            if (wd.values.Update(n1.key() * (int64_t(1) << 32) + n2.key())) {
+                wd.values.text.append("N1 ");
+                append_net(wd.values.text, n1);
+                wd.values.text.append("  N2 ");
+                append_net(wd.values.text, n2);
+            }
+            sig.i64(static_cast<int64_t>(net_day ? day_version_ : history_version_));
+            sig.str(wd.values.text);
+            sig.q(net1_hist_max, 0.01);
+            sig.q(net2_hist_max, 0.01);
+            sign_idle(sig);
+            if (beginLayer(wd.layer, r, sig.h, graphs_animated, invalidated)) {
+                PROFILE_SCOPE("render.net");
+                drawGraphPanel(r.x, r.y, r.w, r.h, wd.values.text, wd.value_size,
+                               net1_hist, net2_hist,
+                               0.0, net1_hist_max,
+                               0.0, net2_hist_max,
+                               dimColor(wd.color_a), dimColor(wd.color_b),
+                               MetricType::NET1, MetricType::NET2, animator, time_sec);
+            }
+            break;
+        case WidgetKind::CPU_GRAPH:
+            if (wd.values.Update(int64_t(cpu_shown) * (int64_t(1) << 32) + temp_shown)) {
+                wd.values.text.append("CPU ").appendInt(cpu_shown).append("%  TEMP ").appendInt(temp_shown).append('C');
+            }
+            sig.i64(static_cast<int64_t>(history_version_));
+            sig.str(wd.values.text);
+            sign_idle(sig);
+            if (beginLayer(wd.layer, r, sig.h, graphs_animated, invalidated)) {
+                PROFILE_SCOPE("render.cpu");
+                drawGraphPanel(r.x, r.y, r.w, r.h, wd.values.text, wd.value_size,
+                               history_cpu_, history_temp_,
+                               0.0, 100.0,
+                               0.0, 100.0,
+                               dimColor(wd.color_a), dimColor(wd.color_b),
+                               MetricType::CPU, MetricType::TEMP, animator, time_sec);
+            }
+            break;
+        case WidgetKind::VITALS:
+            sig.q(cpu, 0.05);
+            sig.q(temp, 0.05);
+            sig.q(mem, 0.05);
+            sig.q(net1, 0.01);
+            sig.i64(static_cast<int64_t>(wan_state));
+            sig.i64(cpu_color);
+            sig.i64(temp_color);
+            sig.i64(mem_color);
+            sig.i64(net_color);
+            sign_idle(sig);
+            if (beginLayer(wd.layer, r, sig.h, false, invalidated)) {
+                PROFILE_SCOPE("render.vitals");
+                drawVitalsPanel(r.x, r.y, r.w, r.h, cpu, temp, mem, net1, wan_state,
+                                cpu_color, temp_color, mem_color, net_color);
+            }
+            break;
+        case WidgetKind::SERVICES:
+            sig.i64(metrics.docker_running);
+            sig.i64(metrics.disk_percent);
+            sig.i64(metrics.wg_active_peers);
+            sig.i64(static_cast<int64_t>(wan_state));
+            sign_idle(sig);
+            if (beginLayer(wd.layer, r, sig.h, false, invalidated)) {
+                PROFILE_SCOPE("render.services");
+                drawServicesPanel(r.x, r.y, r.w, r.h, metrics);
+            }
+            break;
+        case WidgetKind::TICKER:
+            // Scrolls a pixel step every frame it is drawn
+            if (beginLayer(wd.layer, r, 0, !ticker_text_.empty(), invalidated)) {
+                PROFILE_SCOPE("render.ticker");
+                drawFooter(r.x, r.y, r.w, r.h, metrics, idle_controller);
+            }
+            break;
+        }
+    }
+}
+
+bool Renderer::beginLayer(Layer& layer, const Rect& rect, uint64_t signature, bool animated,
+                          std::vector<Rect>* invalidated) {
+    bool moved = layer.rect.x != rect.x || layer.rect.y != rect.y ||
+                 layer.rect.w != rect.w || layer.rect.h != rect.h;
+    if (layer.valid && !moved && !animated && layer.signature == signature) {
+        return false;
+    }
+    // After a full repaint the whole screen is already restored and reported
+    if (layer.valid) {
+        int x0 = std::max(rect.x, 0);
+        int x1 = std::min(rect.x + rect.w, static_cast<int>(DISPLAY_WIDTH));
+        int y0 = std::max(rect.y, 0);
+        int y1 = std::min(rect.y + rect.h, static_cast<int>(DISPLAY_HEIGHT));
+        for (int row = y0; row < y1 && x0 < x1; ++row) {
+            size_t off = static_cast<size_t>(row) * DISPLAY_WIDTH + x0;
+            std::copy_n(chrome_cur_->data() + off, x1 - x0, target_buffer_->data() + off);
+        }
+        if (invalidated) invalidated->push_back(rect);
+    }
+    layer.rect = rect;
+    layer.signature = signature;
+    layer.valid = true;
+    if (animated) scene_animated_ = true;
+    return true;
+}
+
+const std::vector<uint16_t>& Renderer::chromeFrame(ScreenMode mode, int step) {
+    LayerSig key;
+    key.bytes(&current_theme_, sizeof(current_theme_));
+    key.str(theme_name_);
+    key.i64(net_range_day_ && store_); // graph subtitle
+    key.i64(chrome_steps_);
+    key.i64(static_cast<int64_t>(layout_version_));
+    if (key.h != chrome_key_) {
+        chrome_.clear();
+        chrome_key_ = key.h;
+        scene_step_ = -1;
+    }
+    for (const auto& f : chrome_) {
+        if (f.mode == mode && f.step == step) return f.pixels;
+    }
+    // A finished crossfade does not need its intermediate steps until the next one
+    if (step == 0 || step == chrome_steps_) {
+        chrome_.erase(std::remove_if(chrome_.begin(), chrome_.end(), [&](const ChromeFrame& f) {
+            return f.mode == mode && f.step != 0 && f.step != chrome_steps_;
+        }), chrome_.end());
+    }
+
+    PROFILE_SCOPE("render.chrome");
+    ChromeFrame frame;
+    frame.mode = mode;
+    frame.step = step;
+    frame.pixels.resize(DISPLAY_WIDTH * DISPLAY_HEIGHT);
+    std::vector<uint16_t>* target = target_buffer_;
+    float idle_t = idle_t_;
+    target_buffer_ = &frame.pixels;
+    idle_t_ = static_cast<float>(step) / static_cast<float>(chrome_steps_);
+    drawChrome(mode);
+    target_buffer_ = target;
+    idle_t_ = idle_t;
+    chrome_.push_back(std::move(frame));
+    return chrome_.back().pixels;
 }
 
-void Renderer::drawText(const std::string& text, int x, int y, color_t color, float size) {
+void Renderer::drawChrome(ScreenMode mode) {
+    // Static background (no gradient)
+    color_t bg_top = interpolate_color(current_theme_.bg_top_active, current_theme_.bg_top_idle, idle_t_);
+    std::fill(target_buffer_->begin(), target_buffer_->end(), bg_top);
+
+    if (mode == ScreenMode::PRINT) {
+        const Rect& l = print_preview_;
+        const Rect& r = print_status_;
+        drawPanelFrame(l.x, l.y, l.w, l.h, "Preview", "");
+        drawPanelFrame(r.x, r.y, r.w, r.h, "Print", "");
+        // Remove divider line under the header for the Print panel
+        color_t panel_bg = scale_color(current_theme_.bar_bg, 0.80f);
+        drawRect(r.x + 10, r.y + 32, r.w - 21, 1, panel_bg);
+        return;
+    }
+
+    const bool net_day = net_range_day_ && store_;
+    for (const Widget& wd : widgets_) {
+        const Rect& r = wd.rect;
+        switch (wd.kind) {
+        case WidgetKind::HEADER:
+            drawRect(r.x, r.y, r.w, r.h, scale_color(current_theme_.bar_bg, 0.75f));
+            drawLine(r.x, r.y + r.h - 1, r.x + r.w - 1, r.y + r.h - 1, current_theme_.bar_border);
+            break;
+        case WidgetKind::NET_GRAPH:
+            drawGraphChrome(r.x, r.y, r.w, r.h, wd.title,
+                            net_day ? NET_SUBTITLE_24H : NET_SUBTITLE_120S,
+                            "NET1 Mbps", "NET2 Mbps", dimColor(wd.color_a), dimColor(wd.color_b));
+            break;
+        case WidgetKind::CPU_GRAPH:
+            drawGraphChrome(r.x, r.y, r.w, r.h, wd.title, "last 120s | 0-100",
+                            "CPU %", "TEMP C", dimColor(wd.color_a), dimColor(wd.color_b));
+            break;
+        case WidgetKind::VITALS:
+            drawPanelFrame(r.x, r.y, r.w, r.h, wd.title, "");
+            break;
+        case WidgetKind::SERVICES: // draw their own frame and bar
+        case WidgetKind::TICKER:
+            break;
+        }
+    }
+}
+
+void Renderer::drawText(std::string_view text, int x, int y, color_t color, float size) {
     drawTextClipped(text, x, y, color, size, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
 }
 
-void Renderer::drawTextClipped(const std::string& text, int x, int y, color_t color, float size,
+void Renderer::drawTextClipped(std::string_view text, int x, int y, color_t color, float size,
                                int clip_x, int clip_y, int clip_w, int clip_h) {
     if (!target_buffer_) return;
-    if (!font_info_) return;
-    auto* info = static_cast<stbtt_fontinfo*>(font_info_);
-    float scale = stbtt_ScaleForPixelHeight(info, size);
-    int ascent, descent, lineGap;
-    stbtt_GetFontVMetrics(info, &ascent, &descent, &lineGap);
-    y += static_cast<int>(ascent * scale);
-
-    for (char c : text) {
-        int advance, lsb;
-        stbtt_GetCodepointHMetrics(info, c, &advance, &lsb);
-        int c_x1, c_y1, c_x2, c_y2;
-        stbtt_GetCodepointBitmapBox(info, c, scale, scale, &c_x1, &c_y1, &c_x2, &c_y2);
-
-        int w = c_x2 - c_x1;
-        int h = c_y2 - c_y1;
-        if (w > 0 && h > 0) {
-            thread_local std::vector<uint8_t> bitmap;
-            bitmap.resize(static_cast<size_t>(w * h));
-            stbtt_MakeCodepointBitmap(info, bitmap.data(), w, h, w, scale, scale, c);
-            for (int j = 0; j < h; ++j) {
-                for (int i = 0; i < w; ++i) {
-                    uint8_t alpha = bitmap[j * w + i];
-                    if (alpha > 0) {
-                        int px = x + c_x1 + i;
-                        int py = y + c_y1 + j;
-                        if (px >= clip_x && px < (clip_x + clip_w) &&
-                            py >= clip_y && py < (clip_y + clip_h) &&
-                            px >= 0 && px < DISPLAY_WIDTH && py >= 0 && py < DISPLAY_HEIGHT) {
-                            (*target_buffer_)[py * DISPLAY_WIDTH + px] = color;
-                        }
+    if (!glyphs_) return;
+    const int cx0 = std::max(clip_x, 0);
+    const int cy0 = std::max(clip_y, 0);
+    const int cx1 = std::min(clip_x + clip_w, static_cast<int>(DISPLAY_WIDTH));
+    const int cy1 = std::min(clip_y + clip_h, static_cast<int>(DISPLAY_HEIGHT));
+    if (cx0 >= cx1 || cy0 >= cy1) return;
+
+    GlyphCache::Face& face = glyphs_->face(size);
+    y += face.ascent();
+    uint16_t* fb = target_buffer_->data();
+
+    int prev = 0;
+    for (size_t n = 0; n < text.size(); ++n) {
+        int c = text[n];
+        if (n > 0) x += glyphs_->kern(face, prev, c);
+        prev = c;
+        const GlyphCache::Glyph& g = glyphs_->glyph(face, c);
+        const int gx = x + g.x0;
+        const int gy = y + g.y0;
+        x += g.advance;
+
+        // Clip the glyph box once, then walk whole rows
+        const int i0 = std::max(0, cx0 - gx);
+        const int i1 = std::min(static_cast<int>(g.w), cx1 - gx);
+        const int j0 = std::max(0, cy0 - gy);
+        const int j1 = std::min(static_cast<int>(g.h), cy1 - gy);
+        if (i0 >= i1 || j0 >= j1) continue;
+
+        const uint8_t* mask = glyphs_->mask(g);
+        for (int j = j0; j < j1; ++j) {
+            const uint8_t* src = mask + j * g.w;
+            uint16_t* dst = fb + (gy + j) * DISPLAY_WIDTH + gx;
+            if (text_aa_) {
+                for (int i = i0; i < i1; ++i) {
+                    uint8_t alpha = src[i];
+                    if (alpha == 255) {
+                        dst[i] = color;
+                    } else if (alpha > 0) {
+                        dst[i] = blend565(dst[i], color, alpha);
                     }
                 }
+            } else {
+                for (int i = i0; i < i1; ++i) {
+                    if (src[i] > 0) dst[i] = color;
+                }
             }
         }
-        x += static_cast<int>(advance * scale);
     }
 }
 
@@ -783,155 +1277,215 @@ void Renderer::drawIcon(const std::string& name, int x, int y, int size, color_t
     }
 }
 
-void Renderer::drawSparkline(int x, int y, int w, int h,
-                             const std::vector<double>& data,
-                             double min_val, double max_val,
-                             color_t color, color_t bg_color, int line_width,
-                             MetricType metric_type,
-                             AnimationEngine& animator) {
-    if (data.size() < 2) return;
-
-    // Draw background
-    drawRect(x, y, w, h, bg_color);
-
-    // Select parameters based on metric type
-    double zoom_start = SparklineZoom::NET_ZOOM_START;
-    double zoom_end = SparklineZoom::NET_ZOOM_END;
-    double min_range = SparklineZoom::MIN_RANGE_NET;
-    std::string anim_key = "net1_gamma";
-    std::string pulse_key = "net1_pulse";
-
-    switch (metric_type) {
-        case MetricType::CPU:
-            zoom_start = SparklineZoom::CPU_ZOOM_START;
-            zoom_end = SparklineZoom::CPU_ZOOM_END;
-            min_range = SparklineZoom::MIN_RANGE_CPU;
-            anim_key = "cpu_gamma";
-            pulse_key = "cpu_pulse";
-            break;
-        case MetricType::TEMP:
-            zoom_start = SparklineZoom::TEMP_ZOOM_START;
-            zoom_end = SparklineZoom::TEMP_ZOOM_END;
-            min_range = SparklineZoom::MIN_RANGE_TEMP;
-            anim_key = "temp_gamma";
-            pulse_key = "temp_pulse";
-            break;
-        case MetricType::NET1:
-            zoom_start = SparklineZoom::NET_ZOOM_START;
-            zoom_end = SparklineZoom::NET_ZOOM_END;
-            min_range = SparklineZoom::MIN_RANGE_NET;
-            anim_key = "net1_gamma";
-            pulse_key = "net1_pulse";
-            break;
-        case MetricType::NET2:
-            zoom_start = SparklineZoom::NET_ZOOM_START;
-            zoom_end = SparklineZoom::NET_ZOOM_END;
-            min_range = SparklineZoom::MIN_RANGE_NET;
-            anim_key = "net2_gamma";
-            pulse_key = "net2_pulse";
-            break;
-        default:
-            break;
-    }
-
-    // Calculate actual data range for flat detection
-    double data_min = *std::min_element(data.begin(), data.end());
-    double data_max = *std::max_element(data.begin(), data.end());
-    double data_range = data_max - data_min;
-    double scale_range = max_val - min_val;
-    double relative_threshold = 0.03 * scale_range;
-    bool is_flat = (data_range < std::max(relative_threshold, min_range * 0.2));
-
-    // Calculate zoom factor using blended reference
-    double ref = 0.7 * max_val + 0.3 * data.back();
-    double t = clamp((ref - zoom_start) / (zoom_end - zoom_start + 1e-9), 0.0, 1.0);
+// --- Sparkline effect pipeline ---
+// drawSparkline (metric cards) and drawSeriesLine (graph panels) only differ
+// in how they place the points and in a handful of constants (TraceStyle);
+// the effect stages are shared by drawTrace<Kind, FX>. FX is the set of
+// enabled effects: the default (all on) and the bare trace are instantiated
+// with constant masks, so disabled stages and their per-pixel checks compile
+// away. Any other LCD_SPARKLINE_* combination runs the FX_DYNAMIC instance,
+// which reads trace_fx_ instead.
+enum TraceFx : unsigned {
+    FX_SHADOW = 1u << 0,         // EFFECT 8
+    FX_ENHANCED_FILL = 1u << 1,  // EFFECT 5
+    FX_COLOR_ZONES = 1u << 2,    // EFFECT 9
+    FX_GRADIENT_LINE = 1u << 3,  // EFFECT 3
+    FX_DYNAMIC_WIDTH = 1u << 4,  // EFFECT 6
+    FX_PEAKS = 1u << 5,          // EFFECT 2
+    FX_PARTICLES = 1u << 6,      // EFFECT 4
+    FX_SHIMMER = 1u << 7,        // EFFECT 7
+    FX_PULSE = 1u << 8,          // EFFECT 1
+    FX_ALL = (1u << 9) - 1,
+    FX_DYNAMIC = 1u << 31,
+};
+
+struct TraceStyle {
+    // EFFECT 8: sparklines blend the +2 px shadow over the background,
+    // series draw it as a dimmed polyline
+    bool blended_shadow;
+    // EFFECT 5 / 9: sparklines blend the fill over the flat background,
+    // series add it onto the grid
+    bool additive_fill;
+    const FillRamp* ramp;
+    const FillRamp* ramp_enhanced;
+    double cool[3];
+    double warm[3];
+    // EFFECT 3 / 6: sparklines colour the line per column, series per segment
+    bool per_column_line;
+    float cool_line_scale;
+    color_t hot_color;
+    float hot_mix;
+    // EFFECT 4
+    double particle_threshold;
+    int particle_count;
+    int particle_spacing;
+    float particle_alpha;
+    float particle_fade;
+    int particle_half_width;
+    // EFFECT 7: sparklines only
+    bool baseline;
+    // EFFECT 1
+    double pulse_radius;
+    double pulse_amp;
+    double pulse_freq_gain;
+    int glow_extra;
+    float glow_outer;
+    float glow_mid;
+    float center_mix;
+    bool filled_endpoint;
+};
+
+static constexpr TraceStyle SPARKLINE_STYLE = {
+    true,
+    false, &SPARK_RAMP, &SPARK_RAMP_ENHANCED, {0.85, 1.0, 1.15}, {1.15, 0.95, 0.85},
+    true, 0.7f, RGB(255, 200, 100), 0.4f,
+    0.15, 3, 3, 0.6f, 0.25f, 0,
+    true,
+    2.5, 0.4, 1.5, 2, 0.25f, 0.5f, 0.6f, false,
+};
+
+static constexpr TraceStyle SERIES_STYLE = {
+    false,
+    true, &SERIES_RAMP, &SERIES_RAMP_ENHANCED, {0.9, 1.0, 1.1}, {1.1, 0.97, 0.9},
+    false, 0.75f, RGB(255, 200, 120), 0.35f,
+    0.12, 4, 4, 0.5f, 0.2f, 1,
+    false,
+    3.0, 0.35, 1.2, 3, 0.2f, 0.4f, 0.5f, true,
+};
+
+// Layout of one trace, filled in by drawSparkline / drawSeriesLine
+struct Renderer::TracePlot {
+    const SeriesRing* data = nullptr;
+    int x = 0, y = 0, w = 0, h = 0;
+    color_t color = 0;
+    color_t bg_color = 0;     // sparkline background under the fill
+    color_t shadow_color = 0; // series: plain shadow line when EFFECT 8 is off
+    int line_width = 1;
+    int baseline_y = 0;
+    double pulse_phase = 0.0; // EFFECT 1 phase before the activity factor
+    bool allow_peaks = true;  // false for a flat sparkline
+    std::vector<std::pair<int, int>> points;
+    std::vector<double> values; // normalized 0..1, one per point
+};
 
-    // Smooth gamma transition via AnimationEngine
-    double target_gamma = SparklineZoom::GAMMA_MIN + t * (SparklineZoom::GAMMA_MAX - SparklineZoom::GAMMA_MIN);
-    animator.set_target(anim_key, target_gamma);
-    double gamma = animator.get(anim_key, 1.0);
+template <unsigned FX>
+static inline bool fx_on(unsigned bit, unsigned runtime) {
+    if (FX & FX_DYNAMIC) return (runtime & bit) != 0;
+    return (FX & bit) != 0;
+}
 
-    // Adaptive baseline
-    double baseline_frac = 0.85 - t * 0.10;
-    int baseline_y_pos = y + static_cast<int>(h * baseline_frac);
+unsigned Renderer::traceEffects() const {
+    unsigned fx = 0;
+    if (sparkline_shadow_) fx |= FX_SHADOW;
+    if (sparkline_enhanced_fill_) fx |= FX_ENHANCED_FILL;
+    if (sparkline_color_zones_) fx |= FX_COLOR_ZONES;
+    if (sparkline_gradient_line_) fx |= FX_GRADIENT_LINE;
+    if (sparkline_dynamic_width_) fx |= FX_DYNAMIC_WIDTH;
+    if (sparkline_peak_highlight_) fx |= FX_PEAKS;
+    if (sparkline_particles_) fx |= FX_PARTICLES;
+    if (sparkline_baseline_shimmer_) fx |= FX_SHIMMER;
+    if (sparkline_pulse_) fx |= FX_PULSE;
+    return fx;
+}
 
-    // Build points with normalized values
-    std::vector<std::pair<int, int>> points;
-    std::vector<double> normalized_values;
-    points.reserve(data.size());
-    normalized_values.reserve(data.size());
+void Renderer::lendTraceBuffers(TracePlot& plot) {
+    plot.points.swap(trace_points_);
+    plot.values.swap(trace_values_);
+    plot.points.clear();
+    plot.values.clear();
+}
 
-    double flat_v = 0.5;
-    if (is_flat) {
-        double v0 = clamp((data.back() - min_val) / (max_val - min_val + 1e-9), 0.0, 1.0);
-        flat_v = 0.15 + 0.7 * v0;
-    }
+void Renderer::reclaimTraceBuffers(TracePlot& plot) {
+    trace_points_.swap(plot.points);
+    trace_values_.swap(plot.values);
+}
 
-    for (size_t i = 0; i < data.size(); ++i) {
-        double v;
-        if (is_flat) {
-            v = flat_v;
-        } else {
-            v = clamp((data[i] - min_val) / (max_val - min_val + 1e-9), 0.0, 1.0);
-            v = std::pow(v, gamma);
-        }
-        normalized_values.push_back(v);
-        int px = x + 1 + static_cast<int>((static_cast<double>(i) / (data.size() - 1)) * (w - 2));
-        int py = y + h - 1 - static_cast<int>(v * (h - 2));
-        points.emplace_back(px, py);
+template <Renderer::TraceKind Kind>
+void Renderer::dispatchTrace(const TracePlot& plot) {
+    switch (trace_fx_) {
+        case FX_ALL: drawTrace<Kind, FX_ALL>(plot); break;
+        case 0: drawTrace<Kind, 0>(plot); break;
+        default: drawTrace<Kind, FX_DYNAMIC>(plot); break;
     }
+}
 
-    // Find local peaks for highlighting
-    std::vector<size_t> peak_indices;
-    if (sparkline_peak_highlight_ && !is_flat && data.size() >= 5) {
-        for (size_t i = 2; i < data.size() - 2; ++i) {
-            if (data[i] > data[i-1] && data[i] > data[i-2] &&
-                data[i] > data[i+1] && data[i] > data[i+2] &&
-                normalized_values[i] > 0.6) {
+template <Renderer::TraceKind Kind, unsigned FX>
+void Renderer::drawTrace(const TracePlot& plot) {
+    constexpr const TraceStyle& st = (Kind == TraceKind::SPARKLINE) ? SPARKLINE_STYLE : SERIES_STYLE;
+    const unsigned fx = trace_fx_;
+    const auto& points = plot.points;
+    const auto& values = plot.values;
+    const color_t color = plot.color;
+    const int x = plot.x, y = plot.y, w = plot.w, h = plot.h;
+
+    // Find local peaks for highlighting (the ring flags them as samples arrive)
+    std::vector<size_t>& peak_indices = trace_peaks_;
+    peak_indices.clear();
+    peak_indices.reserve(plot.data->capacity());
+    if (fx_on<FX>(FX_PEAKS, fx) && plot.allow_peaks && plot.data->size() >= 5) {
+        for (size_t i = 2; i < plot.data->size() - 2; ++i) {
+            if (values[i] > 0.6 && plot.data->IsPeak(i)) {
                 peak_indices.push_back(i);
             }
         }
     }
 
     // ===== EFFECT 8: Shadow/Depth =====
-    if (sparkline_shadow_ && target_buffer_) {
-        color_t shadow_color = scale_color(color, 0.25f);
-        uint8_t sr, sg, sb;
-        rgb565_to_rgb888(shadow_color, sr, sg, sb);
-        uint8_t br, bg, bb;
-        rgb565_to_rgb888(bg_color, br, bg, bb);
-
-        for (size_t i = 1; i < points.size(); ++i) {
-            int x0 = points[i - 1].first;
-            int y0 = points[i - 1].second + 2; // Shadow offset
-            int x1 = points[i].first;
-            int y1 = points[i].second + 2;
-            if (x0 > x1) {
-                std::swap(x0, x1);
-                std::swap(y0, y1);
-            }
-            int dx = std::max(1, x1 - x0);
-            for (int xi = x0; xi <= x1; ++xi) {
-                double tseg = static_cast<double>(xi - x0) / dx;
-                int yi = static_cast<int>(std::round(y0 + (y1 - y0) * tseg));
-                if (xi >= 0 && xi < DISPLAY_WIDTH && yi >= 0 && yi < DISPLAY_HEIGHT) {
-                    size_t idx = static_cast<size_t>(yi) * DISPLAY_WIDTH + static_cast<size_t>(xi);
-                    double alpha = 0.3;
-                    uint8_t r = static_cast<uint8_t>(sr * alpha + br * (1.0 - alpha));
-                    uint8_t g = static_cast<uint8_t>(sg * alpha + bg * (1.0 - alpha));
-                    uint8_t b = static_cast<uint8_t>(sb * alpha + bb * (1.0 - alpha));
-                    (*target_buffer_)[idx] = rgb888_to_rgb565(r, g, b);
+    if (fx_on<FX>(FX_SHADOW, fx) && target_buffer_) {
+        PROFILE_SCOPE("sparkline.shadow");
+        if (st.blended_shadow) {
+            // 30% shadow over the panel background: one colour for the whole trace
+            const color_t shade = mix565(plot.bg_color, scale_color(color, 0.25f), 10);
+            color_t* buf = target_buffer_->data();
+            for (size_t i = 1; i < points.size(); ++i) {
+                int x0 = points[i - 1].first;
+                int y0 = points[i - 1].second + 2; // Shadow offset
+                int x1 = points[i].first;
+                int y1 = points[i].second + 2;
+                if (x0 > x1) {
+                    std::swap(x0, x1);
+                    std::swap(y0, y1);
+                }
+                int dx = std::max(1, x1 - x0);
+                for (int xi = x0; xi <= x1; ++xi) {
+                    double tseg = static_cast<double>(xi - x0) / dx;
+                    int yi = static_cast<int>(std::round(y0 + (y1 - y0) * tseg));
+                    if (xi >= 0 && xi < DISPLAY_WIDTH && yi >= 0 && yi < DISPLAY_HEIGHT) {
+                        buf[static_cast<size_t>(yi) * DISPLAY_WIDTH + static_cast<size_t>(xi)] = shade;
+                    }
                 }
             }
+        } else {
+            color_t shadow_col = scale_color(color, 0.3f);
+            for (size_t i = 1; i < points.size(); ++i) {
+                drawLine(points[i - 1].first, points[i - 1].second + 2,
+                         points[i].first, points[i].second + 2, shadow_col);
+            }
         }
     }
 
-    // ===== EFFECT 5: Enhanced Fill Gradient (two-stage) =====
+    // ===== EFFECT 5: Enhanced Fill Gradient (two-stage) + EFFECT 9: Color zones =====
     if (target_buffer_) {
-        uint8_t fr, fg, fb;
-        uint8_t br, bg, bb;
-        rgb565_to_rgb888(color, fr, fg, fb);
-        rgb565_to_rgb888(bg_color, br, bg, bb);
+        PROFILE_SCOPE("sparkline.fill");
+        const FillRamp& ramp = fx_on<FX>(FX_ENHANCED_FILL, fx) ? *st.ramp_enhanced : *st.ramp;
+        const bool zoned = fx_on<FX>(FX_COLOR_ZONES, fx);
+        const color_t zones[3] = {
+            tint565(color, st.cool[0], st.cool[1], st.cool[2]), // low zone: cooler tones
+            color,
+            tint565(color, st.warm[0], st.warm[1], st.warm[2]), // high zone: warmer tones
+        };
+        // Over the flat background every output is one of 33 alpha levels per
+        // zone; the additive blend needs the zone colour pre-scaled per level
+        color_t palette[3][33];
+        uint32_t addend[3][33];
+        for (int z = 0; z < 3; ++z) {
+            uint32_t sz = spread565(zones[z]);
+            for (uint32_t al = 0; al <= 32; ++al) {
+                if (st.additive_fill) addend[z][al] = scale_spread(sz, al);
+                else palette[z][al] = mix565(plot.bg_color, zones[z], al);
+            }
+        }
+        color_t* buf = target_buffer_->data();
         int bottom_y = y + h - 1;
 
         for (size_t i = 0; i + 1 < points.size(); ++i) {
@@ -941,199 +1495,243 @@ void Renderer::drawSparkline(int x, int y, int w, int h,
                 std::swap(x0, x1);
                 std::swap(y0, y1);
             }
+            const int zone = fill_zone(zoned, values, i);
             int dx = std::max(1, x1 - x0);
-            for (int xi = x0; xi <= x1; ++xi) {
+            for (int xi = std::max(x0, 0); xi <= std::min(x1, DISPLAY_WIDTH - 1); ++xi) {
                 double tseg = static_cast<double>(xi - x0) / dx;
-                double top_f = y0 + (y1 - y0) * tseg;
-                int top = static_cast<int>(std::round(top_f));
-                if (top < y) top = y;
-                if (top > bottom_y) top = bottom_y;
-                double denom = std::max(1.0, static_cast<double>(bottom_y - top));
-
-                for (int py = top; py <= bottom_y; ++py) {
-                    double norm = (py - top_f) / denom;
-                    double alpha;
-
-                    if (sparkline_enhanced_fill_) {
-                        // Two-stage gradient: bright near line, then exponential fade
-                        if (norm < 0.2) {
-                            alpha = FILL_ALPHA_SPARK * (1.0 - norm * 2.0);
-                        } else {
-                            alpha = FILL_ALPHA_SPARK * 0.6 * fast_exp(FILL_DECAY_SPARK * (norm - 0.2));
-                        }
-                    } else {
-                        alpha = FILL_ALPHA_SPARK * fast_exp(FILL_DECAY_SPARK * norm);
+                FillColumn col;
+                if (!fill_column(y0 + (y1 - y0) * tseg, y, bottom_y, col)) continue;
+                color_t* out = buf + static_cast<size_t>(col.py0) * DISPLAY_WIDTH + static_cast<size_t>(xi);
+                int32_t pos = col.pos;
+                if (st.additive_fill) {
+                    const uint32_t* add = addend[zone];
+                    for (int py = col.py0; py <= col.py1; ++py, out += DISPLAY_WIDTH, pos += col.step) {
+                        uint8_t al = ramp.a[ramp_index(pos)];
+                        if (al) *out = pack565(add_sat_spread(spread565(*out), add[al]));
                     }
-
-                    if (alpha < 0.001) continue;
-                    if (xi < 0 || xi >= DISPLAY_WIDTH || py < 0 || py >= DISPLAY_HEIGHT) continue;
-
-                    size_t idx = static_cast<size_t>(py) * DISPLAY_WIDTH + static_cast<size_t>(xi);
-
-                    // EFFECT 9: Color zones - slightly shift hue based on value
-                    uint8_t fill_r = fr, fill_g = fg, fill_b = fb;
-                    if (sparkline_color_zones_ && i < normalized_values.size()) {
-                        double val = normalized_values[i];
-                        if (val < 0.33) {
-                            // Low zone: cooler tones
-                            fill_r = static_cast<uint8_t>(fr * 0.85);
-                            fill_g = static_cast<uint8_t>(fg * 1.0);
-                            fill_b = static_cast<uint8_t>(fb * 1.15);
-                        } else if (val > 0.66) {
-                            // High zone: warmer tones
-                            fill_r = static_cast<uint8_t>(std::min(255, static_cast<int>(fr * 1.15)));
-                            fill_g = static_cast<uint8_t>(fg * 0.95);
-                            fill_b = static_cast<uint8_t>(fb * 0.85);
-                        }
+                } else {
+                    const color_t* pal = palette[zone];
+                    for (int py = col.py0; py <= col.py1; ++py, out += DISPLAY_WIDTH, pos += col.step) {
+                        uint8_t al = ramp.a[ramp_index(pos)];
+                        if (al) *out = pal[al];
                     }
-
-                    uint8_t r = static_cast<uint8_t>(fill_r * alpha + br * (1.0 - alpha));
-                    uint8_t g = static_cast<uint8_t>(fill_g * alpha + bg * (1.0 - alpha));
-                    uint8_t b = static_cast<uint8_t>(fill_b * alpha + bb * (1.0 - alpha));
-                    (*target_buffer_)[idx] = rgb888_to_rgb565(r, g, b);
                 }
             }
         }
     }
 
     // ===== EFFECT 3: Gradient Line + EFFECT 6: Dynamic Line Thickness =====
-    for (size_t i = 1; i < points.size(); ++i) {
-        int x0 = points[i - 1].first;
-        int y0 = points[i - 1].second;
-        int x1 = points[i].first;
-        int y1 = points[i].second;
-        if (x0 > x1) {
-            std::swap(x0, x1);
-            std::swap(y0, y1);
-        }
+    {
+        const color_t cool = scale_color(color, st.cool_line_scale);
+        const color_t hot = interpolate_color(color, st.hot_color, st.hot_mix);
+        auto line_color = [&](double v) -> color_t {
+            if (!fx_on<FX>(FX_GRADIENT_LINE, fx)) return color;
+            if (v < 0.33) return interpolate_color(cool, color, v * 3.0);
+            if (v > 0.66) return interpolate_color(color, hot, (v - 0.66) * 3.0);
+            return color;
+        };
+        auto line_width = [&](double v) {
+            return (fx_on<FX>(FX_DYNAMIC_WIDTH, fx) && v > 0.5) ? plot.line_width + 1 : plot.line_width;
+        };
 
-        double val_prev = normalized_values[i - 1];
-        double val_curr = (i < normalized_values.size()) ? normalized_values[i] : val_prev;
-
-        int dx = std::max(1, x1 - x0);
-        for (int xi = x0; xi <= x1; ++xi) {
-            double tseg = static_cast<double>(xi - x0) / dx;
-            int yi = static_cast<int>(std::round(y0 + (y1 - y0) * tseg));
-            double val_interp = val_prev + (val_curr - val_prev) * tseg;
-
-            // EFFECT 3: Gradient coloring based on value
-            color_t line_color = color;
-            if (sparkline_gradient_line_) {
-                if (val_interp < 0.33) {
-                    line_color = interpolate_color(scale_color(color, 0.7f), color, val_interp * 3.0);
-                } else if (val_interp > 0.66) {
-                    color_t hot = interpolate_color(color, RGB(255, 200, 100), 0.4);
-                    line_color = interpolate_color(color, hot, (val_interp - 0.66) * 3.0);
+        for (size_t i = 1; i < points.size(); ++i) {
+            if (st.per_column_line) {
+                int x0 = points[i - 1].first;
+                int y0 = points[i - 1].second;
+                int x1 = points[i].first;
+                int y1 = points[i].second;
+                if (x0 > x1) {
+                    std::swap(x0, x1);
+                    std::swap(y0, y1);
                 }
-            }
-
-            // EFFECT 6: Dynamic line thickness
-            int lw = line_width;
-            if (sparkline_dynamic_width_) {
-                lw = (val_interp > 0.5) ? std::max(2, line_width + 1) : line_width;
-            }
-
-            drawLine(xi, yi, xi, yi, line_color);
-            if (lw > 1) {
-                drawLine(xi, yi + 1, xi, yi + 1, line_color);
-            }
-            if (lw > 2) {
-                drawLine(xi, yi - 1, xi, yi - 1, line_color);
+                double val_prev = values[i - 1];
+                double val_curr = values[i];
+                int dx = std::max(1, x1 - x0);
+                for (int xi = x0; xi <= x1; ++xi) {
+                    double tseg = static_cast<double>(xi - x0) / dx;
+                    int yi = static_cast<int>(std::round(y0 + (y1 - y0) * tseg));
+                    double val_interp = val_prev + (val_curr - val_prev) * tseg;
+                    color_t lc = line_color(val_interp);
+                    int lw = line_width(val_interp);
+                    drawLine(xi, yi, xi, yi, lc);
+                    if (lw > 1) drawLine(xi, yi + 1, xi, yi + 1, lc);
+                    if (lw > 2) drawLine(xi, yi - 1, xi, yi - 1, lc);
+                }
+            } else {
+                auto [x0, y0] = points[i - 1];
+                auto [x1, y1] = points[i];
+                double val_avg = (values[i - 1] + values[i]) * 0.5;
+                color_t lc = line_color(val_avg);
+                int lw = line_width(val_avg);
+                if (plot.shadow_color != color && !fx_on<FX>(FX_SHADOW, fx)) {
+                    drawLine(x0, y0 + 1, x1, y1 + 1, plot.shadow_color);
+                }
+                drawLine(x0, y0, x1, y1, lc);
+                if (lw > 1) drawLine(x0, y0 + 1, x1, y1 + 1, lc);
+                if (lw > 2) drawLine(x0, y0 - 1, x1, y1 - 1, lc);
             }
         }
     }
 
     // ===== EFFECT 2: Peak Highlights with Bloom =====
-    if (sparkline_peak_highlight_) {
+    if (fx_on<FX>(FX_PEAKS, fx)) {
+        PROFILE_SCOPE("sparkline.peak_highlight");
+        // Subtle, delicate peak markers - barely visible glow
+        color_t glow = interpolate_color(color, RGB(255, 255, 255), 0.3);
+        color_t outer = scale_color(glow, 0.12f);
+        color_t center = scale_color(glow, 0.35f);
         for (size_t pi : peak_indices) {
             if (pi >= points.size()) continue;
-            int px = points[pi].first;
-            int py = points[pi].second;
-
-            // Subtle, delicate peak markers for sparklines
-            color_t glow = interpolate_color(color, RGB(255, 255, 255), 0.3);
-            drawFilledCircle(px, py, 2, scale_color(glow, 0.12f));  // very faint outer glow
-            drawFilledCircle(px, py, 1, scale_color(glow, 0.35f));  // small center dot
+            drawFilledCircle(points[pi].first, points[pi].second, 2, outer);
+            drawFilledCircle(points[pi].first, points[pi].second, 1, center);
         }
     }
 
     // ===== EFFECT 4: Particle Trails =====
-    if (sparkline_particles_ && data.size() >= 3) {
-        // Find rapid changes
-        for (size_t i = 2; i < data.size(); ++i) {
-            double change = std::abs(normalized_values[i] - normalized_values[i-1]);
-            if (change > 0.15) { // Significant change
-                int px = points[i].first;
-                int py = points[i].second;
-
-                // Draw small trailing particles
-                int dir = (normalized_values[i] > normalized_values[i-1]) ? -1 : 1;
-                for (int j = 1; j <= 3; ++j) {
-                    int trail_y = py + dir * j * 3;
-                    float trail_alpha = 0.6f * (1.0f - j * 0.25f);
-                    color_t trail_color = scale_color(color, trail_alpha);
-                    if (trail_y >= y && trail_y < y + h) {
-                        drawLine(px, trail_y, px, trail_y, trail_color);
-                    }
+    if (fx_on<FX>(FX_PARTICLES, fx) && values.size() >= 3) {
+        PROFILE_SCOPE("sparkline.particles");
+        for (size_t i = 2; i < values.size(); ++i) {
+            double change = std::abs(values[i] - values[i - 1]);
+            if (change <= st.particle_threshold) continue;
+            int px = points[i].first;
+            int py = points[i].second;
+            int dir = (values[i] > values[i - 1]) ? -1 : 1;
+            for (int j = 1; j <= st.particle_count; ++j) {
+                int trail_y = py + dir * j * st.particle_spacing;
+                color_t trail_color = scale_color(color, st.particle_alpha * (1.0f - j * st.particle_fade));
+                if (trail_y >= y && trail_y < y + h) {
+                    drawLine(px - st.particle_half_width, trail_y, px + st.particle_half_width, trail_y, trail_color);
                 }
             }
         }
     }
 
     // ===== EFFECT 7: Shimmer Effect on Baseline =====
-    if (sparkline_baseline_shimmer_) {
-        // Animated dashed line with shimmer
-        static double shimmer_phase = 0.0;
-        shimmer_phase += 0.15; // Increment for animation
-        if (shimmer_phase > 20.0) shimmer_phase = 0.0;
-
-        int dash_len = 4;
-        int gap_len = 3;
-        for (int xi = x + 1; xi < x + w - 1; ++xi) {
-            int phase_offset = static_cast<int>(shimmer_phase);
-            int pos = (xi - x + phase_offset) % (dash_len + gap_len);
-            if (pos < dash_len) {
-                // Shimmer intensity varies along the line
-                float shimmer = 0.7f + 0.3f * std::sin((xi - x) * 0.2 + shimmer_phase);
-                color_t shimmer_color = scale_color(current_theme_.bar_border, shimmer);
-                drawLine(xi, baseline_y_pos, xi, baseline_y_pos, shimmer_color);
+    if (st.baseline) {
+        if (fx_on<FX>(FX_SHIMMER, fx)) {
+            // Animated dashed line with shimmer
+            shimmer_phase_ += 0.15;
+            if (shimmer_phase_ > 20.0) shimmer_phase_ = 0.0;
+
+            int dash_len = 4;
+            int gap_len = 3;
+            int phase_offset = static_cast<int>(shimmer_phase_);
+            for (int xi = x + 1; xi < x + w - 1; ++xi) {
+                int pos = (xi - x + phase_offset) % (dash_len + gap_len);
+                if (pos < dash_len) {
+                    // Shimmer intensity varies along the line
+                    float shimmer = 0.7f + 0.3f * fast_sin((xi - x) * 0.2 + shimmer_phase_);
+                    color_t shimmer_color = scale_color(current_theme_.bar_border, shimmer);
+                    drawLine(xi, plot.baseline_y, xi, plot.baseline_y, shimmer_color);
+                }
             }
+        } else {
+            drawLine(x + 1, plot.baseline_y, x + w - 2, plot.baseline_y, current_theme_.bar_border);
         }
-    } else {
-        // Regular baseline
-        drawLine(x + 1, baseline_y_pos, x + w - 2, baseline_y_pos, current_theme_.bar_border);
     }
 
     // ===== EFFECT 1: Endpoint Pulse Animation with Glow =====
     auto [px, py] = points.back();
-    if (sparkline_pulse_) {
-        // Animate pulse size using AnimationEngine
-        static double pulse_time = 0.0;
-        pulse_time += 0.08;
-        if (pulse_time > 6.28) pulse_time = 0.0;
-
+    if (fx_on<FX>(FX_PULSE, fx)) {
+        PROFILE_SCOPE("sparkline.pulse");
         // Pulse frequency varies with activity (higher values pulse faster)
-        double activity = normalized_values.back();
-        double freq = 1.0 + activity * 1.5;
-        double pulse_scale = 1.0 + 0.4 * std::sin(pulse_time * freq);
-
-        int pulse_r = static_cast<int>(2.5 * pulse_scale);
-        int glow_r = pulse_r + 2;
-
-        // Outer glow
-        drawFilledCircle(px, py, glow_r, scale_color(color, 0.25f));
-        // Mid glow
-        drawFilledCircle(px, py, glow_r - 1, scale_color(color, 0.5f));
-        // Core pulse
+        double freq = 1.0 + values.back() * st.pulse_freq_gain;
+        double pulse_scale = 1.0 + st.pulse_amp * std::sin(plot.pulse_phase * freq);
+
+        int pulse_r = static_cast<int>(st.pulse_radius * pulse_scale);
+        int glow_r = pulse_r + st.glow_extra;
+
+        drawFilledCircle(px, py, glow_r, scale_color(color, st.glow_outer));
+        drawFilledCircle(px, py, glow_r - 1, scale_color(color, st.glow_mid));
         drawFilledCircle(px, py, pulse_r, color);
-        // Bright center
-        drawFilledCircle(px, py, std::max(1, pulse_r - 1), interpolate_color(color, RGB(255, 255, 255), 0.6));
+        drawFilledCircle(px, py, std::max(1, pulse_r - 1), interpolate_color(color, RGB(255, 255, 255), st.center_mix));
+    } else if (st.filled_endpoint) {
+        drawFilledCircle(px, py, 2, color);
     } else {
-        // Static endpoint
         drawCircle(px, py, 2, color);
     }
 }
 
+void Renderer::drawSparkline(int x, int y, int w, int h,
+                             const SeriesRing& data,
+                             double min_val, double max_val,
+                             color_t color, color_t bg_color, int line_width,
+                             MetricType metric_type,
+                             AnimationEngine& animator) {
+    if (data.size() < 2) return;
+
+    // Draw background
+    drawRect(x, y, w, h, bg_color);
+
+    const SparklineZoom::Params& zoom = SparklineZoom::BY_METRIC[static_cast<int>(metric_type)];
+
+    // Calculate actual data range for flat detection
+    double data_min = data.Min();
+    double data_max = data.Max();
+    double data_range = data_max - data_min;
+    double scale_range = max_val - min_val;
+    double relative_threshold = 0.03 * scale_range;
+    bool is_flat = (data_range < std::max(relative_threshold, zoom.min_range * 0.2));
+
+    // Calculate zoom factor using blended reference
+    double ref = 0.7 * max_val + 0.3 * data.back();
+    double t = clamp((ref - zoom.start) / (zoom.end - zoom.start + 1e-9), 0.0, 1.0);
+
+    // Smooth gamma transition via AnimationEngine
+    double target_gamma = SparklineZoom::GAMMA_MIN + t * (SparklineZoom::GAMMA_MAX - SparklineZoom::GAMMA_MIN);
+    AnimationEngine::Handle gamma_ch = anim_.gamma[static_cast<int>(metric_type)];
+    animator.set_target(gamma_ch, target_gamma);
+    double gamma = animator.get(gamma_ch, 1.0);
+
+    TracePlot plot;
+    lendTraceBuffers(plot);
+    plot.data = &data;
+    plot.x = x;
+    plot.y = y;
+    plot.w = w;
+    plot.h = h;
+    plot.color = color;
+    plot.bg_color = bg_color;
+    plot.shadow_color = color;
+    plot.line_width = line_width;
+    // Adaptive baseline
+    plot.baseline_y = y + static_cast<int>(h * (0.85 - t * 0.10));
+    plot.allow_peaks = !is_flat;
+    if (trace_fx_ & FX_PULSE) {
+        pulse_phase_ += 0.08;
+        if (pulse_phase_ > 6.28) pulse_phase_ = 0.0;
+    }
+    plot.pulse_phase = pulse_phase_;
+
+    // Build points with normalized values (room for a full ring, so the
+    // borrowed buffers stop growing once the history fills up)
+    plot.points.reserve(data.capacity());
+    plot.values.reserve(data.capacity());
+
+    double flat_v = 0.5;
+    if (is_flat) {
+        double v0 = clamp((data.back() - min_val) / (max_val - min_val + 1e-9), 0.0, 1.0);
+        flat_v = 0.15 + 0.7 * v0;
+    }
+
+    data.ForEach([&](size_t i, float sample) {
+        double v;
+        if (is_flat) {
+            v = flat_v;
+        } else {
+            v = clamp((sample - min_val) / (max_val - min_val + 1e-9), 0.0, 1.0);
+            v = std::pow(v, gamma);
+        }
+        plot.values.push_back(v);
+        int px = x + 1 + static_cast<int>((static_cast<double>(i) / (data.size() - 1)) * (w - 2));
+        int py = y + h - 1 - static_cast<int>(v * (h - 2));
+        plot.points.emplace_back(px, py);
+    });
+
+    dispatchTrace<TraceKind::SPARKLINE>(plot);
+    reclaimTraceBuffers(plot);
+}
+
 void Renderer::drawProgressBar(int x, int y, int w, int h, double value, color_t color, color_t bg) {
     int radius = std::max(1, h / 2);
     // Background rounded bar
@@ -1157,7 +1755,7 @@ void Renderer::drawCard(const std::string& icon,
                         const std::string& value,
                         double indicator_val,
                         double indicator_max,
-                        const std::vector<double>& history,
+                        const SeriesRing& history,
                         double hist_min,
                         double hist_max,
                         int x, int y, int w, int h,
@@ -1199,7 +1797,7 @@ void Renderer::drawCard(const std::string& icon,
     }
 }
 
-void Renderer::drawStatusBar(const SystemMetrics& metrics, const IdleModeController& idle_controller) {
+void Renderer::drawStatusBar(const MetricsSnapshot& metrics, const IdleModeController& idle_controller) {
     int bar_h = std::clamp(DISPLAY_HEIGHT / 12, 26, 34);
     int bar_y = DISPLAY_HEIGHT - bar_h;
     drawRect(0, bar_y, DISPLAY_WIDTH, bar_h, current_theme_.bar_bg);
@@ -1207,25 +1805,24 @@ void Renderer::drawStatusBar(const SystemMetrics& metrics, const IdleModeControl
 
     // WAN indicator
     color_t dot_color = current_theme_.state_low;
-    std::string wan = metrics.get_wan_status();
-    std::string wan_label = "OK";
-    if (wan == "DOWN") {
+    const char* wan_label = "OK";
+    if (metrics.wan_state == WanState::DOWN) {
         dot_color = current_theme_.state_high;
         wan_label = "DOWN";
-    } else if (wan == "DEGRADED") {
+    } else if (metrics.wan_state == WanState::DEGRADED) {
         dot_color = current_theme_.state_medium;
         wan_label = "SLOW";
-    } else if (wan == "CHECKING") {
+    } else if (metrics.wan_state == WanState::CHECKING) {
         wan_label = "...";
     }
 
     int dot_r = (bar_h >= 32 ? 5 : 4);
     float text_size = (bar_h >= 32 ? 12.5f : 11.0f);
     drawCircle(10, bar_y + bar_h / 2, dot_r, dot_color);
-    drawText("WAN:" + wan_label, 22, bar_y + (bar_h / 2 - 5), current_theme_.text_status, text_size);
+    drawText(std::string("WAN:") + wan_label, 22, bar_y + (bar_h / 2 - 5), current_theme_.text_status, text_size);
 
     // Uptime on right
-    std::string up = formatUptime(metrics.uptime_seconds);
+    SmallString<16> up = formatUptime(metrics.uptime_seconds);
     int up_w = measureTextWidth(up, text_size);
     drawText(up, DISPLAY_WIDTH - up_w - 6, bar_y + (bar_h / 2 - 5), current_theme_.text_status, text_size);
 
@@ -1264,227 +1861,42 @@ void Renderer::drawPanelFrame(int x, int y, int w, int h, const std::string& tit
     drawLine(x + 10, y + 32, x + w - 11, y + 32, panel_border);
 }
 
-void Renderer::drawSeriesLine(const std::deque<double>& data, int x, int y, int w, int h,
+void Renderer::drawSeriesLine(const SeriesRing& data, int x, int y, int w, int h,
                               double min_val, double max_val, color_t color,
                               color_t shadow_color, int width, MetricType metric_type,
                               AnimationEngine& animator, double time_sec) {
+    (void)metric_type;
     if (data.size() < 2 || !target_buffer_) return;
     const int inner_w = std::max(1, w - 2);
     const int inner_h = std::max(1, h - 2);
     double range = std::max(1e-6, max_val - min_val);
     size_t n = data.size();
 
-    // Get animation key based on metric type
-    std::string pulse_key = "series_pulse";
-    switch (metric_type) {
-        case MetricType::CPU: pulse_key = "series_cpu_pulse"; break;
-        case MetricType::TEMP: pulse_key = "series_temp_pulse"; break;
-        case MetricType::NET1: pulse_key = "series_net1_pulse"; break;
-        case MetricType::NET2: pulse_key = "series_net2_pulse"; break;
-        default: break;
-    }
+    TracePlot plot;
+    lendTraceBuffers(plot);
+    plot.data = &data;
+    plot.x = x;
+    plot.y = y;
+    plot.w = w;
+    plot.h = h;
+    plot.color = color;
+    plot.shadow_color = shadow_color;
+    plot.line_width = width;
+    plot.pulse_phase = time_sec * 3.14159;
 
     // Build points with normalized values
-    std::vector<std::pair<int, int>> points;
-    std::vector<double> normalized_values;
-    points.reserve(n);
-    normalized_values.reserve(n);
-
-    for (size_t i = 0; i < n; ++i) {
-        double v = clamp((data[i] - min_val) / range, 0.0, 1.0);
-        normalized_values.push_back(v);
+    plot.points.reserve(data.capacity());
+    plot.values.reserve(data.capacity());
+    data.ForEach([&](size_t i, float sample) {
+        double v = clamp((sample - min_val) / range, 0.0, 1.0);
+        plot.values.push_back(v);
         int px = x + 1 + static_cast<int>((static_cast<double>(i) / (n - 1)) * inner_w);
         int py = y + h - 1 - static_cast<int>(v * inner_h);
-        points.emplace_back(px, py);
-    }
-
-    // Find local peaks for highlighting
-    std::vector<size_t> peak_indices;
-    if (sparkline_peak_highlight_ && data.size() >= 5) {
-        for (size_t i = 2; i < data.size() - 2; ++i) {
-            if (data[i] > data[i-1] && data[i] > data[i-2] &&
-                data[i] > data[i+1] && data[i] > data[i+2] &&
-                normalized_values[i] > 0.6) {
-                peak_indices.push_back(i);
-            }
-        }
-    }
-
-    // ===== EFFECT 8: Shadow/Depth =====
-    if (sparkline_shadow_) {
-        color_t shadow_col = scale_color(color, 0.3f);
-        int prev_x = points.front().first;
-        int prev_y = points.front().second + 2;
-        for (size_t i = 1; i < points.size(); ++i) {
-            int px = points[i].first;
-            int py = points[i].second + 2;
-            drawLine(prev_x, prev_y, px, py, shadow_col);
-            prev_x = px;
-            prev_y = py;
-        }
-    }
+        plot.points.emplace_back(px, py);
+    });
 
-    // ===== EFFECT 5: Enhanced Fill with additive blending =====
-    uint8_t fr, fg, fb;
-    rgb565_to_rgb888(color, fr, fg, fb);
-    int bottom_y = y + h - 1;
-
-    for (size_t i = 0; i + 1 < points.size(); ++i) {
-        auto [x0, y0] = points[i];
-        auto [x1, y1] = points[i + 1];
-        if (x0 > x1) {
-            std::swap(x0, x1);
-            std::swap(y0, y1);
-        }
-        int dx = std::max(1, x1 - x0);
-        for (int xi = x0; xi <= x1; ++xi) {
-            double tseg = static_cast<double>(xi - x0) / dx;
-            double top_f = y0 + (y1 - y0) * tseg;
-            int top = static_cast<int>(std::round(top_f));
-            if (top < y) top = y;
-            if (top > bottom_y) top = bottom_y;
-            double denom = std::max(1.0, static_cast<double>(bottom_y - top));
-
-            for (int py = top; py <= bottom_y; ++py) {
-                if (xi < 0 || xi >= DISPLAY_WIDTH || py < 0 || py >= DISPLAY_HEIGHT) continue;
-                double norm = (py - top_f) / denom;
-                double intensity;
-
-                if (sparkline_enhanced_fill_) {
-                    // Two-stage gradient for series
-                    if (norm < 0.15) {
-                        intensity = FILL_INTENSITY_SERIES * (1.0 - norm * 3.0);
-                    } else {
-                        intensity = FILL_INTENSITY_SERIES * 0.7 * fast_exp(FILL_DECAY_SERIES * (norm - 0.15));
-                    }
-                } else {
-                    intensity = FILL_INTENSITY_SERIES * fast_exp(FILL_DECAY_SERIES * norm);
-                }
-
-                if (intensity < 0.001) continue;
-                size_t idx = static_cast<size_t>(py) * DISPLAY_WIDTH + static_cast<size_t>(xi);
-
-                // EFFECT 9: Color zones
-                uint8_t fill_r = fr, fill_g = fg, fill_b = fb;
-                if (sparkline_color_zones_ && i < normalized_values.size()) {
-                    double val = normalized_values[i];
-                    if (val < 0.33) {
-                        fill_r = static_cast<uint8_t>(fr * 0.9);
-                        fill_g = static_cast<uint8_t>(fg * 1.0);
-                        fill_b = static_cast<uint8_t>(fb * 1.1);
-                    } else if (val > 0.66) {
-                        fill_r = static_cast<uint8_t>(std::min(255, static_cast<int>(fr * 1.1)));
-                        fill_g = static_cast<uint8_t>(fg * 0.97);
-                        fill_b = static_cast<uint8_t>(fb * 0.9);
-                    }
-                }
-
-                color_t dst = (*target_buffer_)[idx];
-                uint8_t dr, dg, db;
-                rgb565_to_rgb888(dst, dr, dg, db);
-                int nr = std::min(255, static_cast<int>(dr) + static_cast<int>(fill_r * intensity));
-                int ng = std::min(255, static_cast<int>(dg) + static_cast<int>(fill_g * intensity));
-                int nb = std::min(255, static_cast<int>(db) + static_cast<int>(fill_b * intensity));
-                (*target_buffer_)[idx] = rgb888_to_rgb565(static_cast<uint8_t>(nr),
-                                                          static_cast<uint8_t>(ng),
-                                                          static_cast<uint8_t>(nb));
-            }
-        }
-    }
-
-    // ===== EFFECT 3: Gradient Line + EFFECT 6: Dynamic Line Thickness =====
-    int prev_x = points.front().first;
-    int prev_y = points.front().second;
-    for (size_t i = 1; i < points.size(); ++i) {
-        int px = points[i].first;
-        int py = points[i].second;
-
-        double val_prev = normalized_values[i - 1];
-        double val_curr = normalized_values[i];
-        double val_avg = (val_prev + val_curr) * 0.5;
-
-        // EFFECT 3: Gradient coloring
-        color_t line_color = color;
-        if (sparkline_gradient_line_) {
-            if (val_avg < 0.33) {
-                line_color = interpolate_color(scale_color(color, 0.75f), color, val_avg * 3.0);
-            } else if (val_avg > 0.66) {
-                color_t hot = interpolate_color(color, RGB(255, 200, 120), 0.35);
-                line_color = interpolate_color(color, hot, (val_avg - 0.66) * 3.0);
-            }
-        }
-
-        // EFFECT 6: Dynamic thickness
-        int lw = width;
-        if (sparkline_dynamic_width_ && val_avg > 0.5) {
-            lw = width + 1;
-        }
-
-        if (shadow_color != color && !sparkline_shadow_) {
-            drawLine(prev_x, prev_y + 1, px, py + 1, shadow_color);
-        }
-        drawLine(prev_x, prev_y, px, py, line_color);
-        if (lw > 1) {
-            drawLine(prev_x, prev_y + 1, px, py + 1, line_color);
-        }
-        if (lw > 2) {
-            drawLine(prev_x, prev_y - 1, px, py - 1, line_color);
-        }
-
-        prev_x = px;
-        prev_y = py;
-    }
-
-    // ===== EFFECT 2: Peak Highlights with Bloom =====
-    if (sparkline_peak_highlight_) {
-        for (size_t pi : peak_indices) {
-            if (pi >= points.size()) continue;
-            int px = points[pi].first;
-            int py = points[pi].second;
-
-            // Subtle, delicate peak markers - barely visible glow
-            color_t glow = interpolate_color(color, RGB(255, 255, 255), 0.3);
-            drawFilledCircle(px, py, 2, scale_color(glow, 0.12f));  // very faint outer glow
-            drawFilledCircle(px, py, 1, scale_color(glow, 0.35f));  // small center dot
-        }
-    }
-
-    // ===== EFFECT 4: Particle Trails =====
-    if (sparkline_particles_ && data.size() >= 3) {
-        for (size_t i = 2; i < data.size(); ++i) {
-            double change = std::abs(normalized_values[i] - normalized_values[i-1]);
-            if (change > 0.12) {
-                int px = points[i].first;
-                int py = points[i].second;
-                int dir = (normalized_values[i] > normalized_values[i-1]) ? -1 : 1;
-                for (int j = 1; j <= 4; ++j) {
-                    int trail_y = py + dir * j * 4;
-                    float trail_alpha = 0.5f * (1.0f - j * 0.2f);
-                    color_t trail_color = scale_color(color, trail_alpha);
-                    if (trail_y >= y && trail_y < y + h) {
-                        drawLine(px - 1, trail_y, px + 1, trail_y, trail_color);
-                    }
-                }
-            }
-        }
-    }
-
-    // ===== EFFECT 1: Endpoint Pulse Animation with Glow =====
-    if (sparkline_pulse_) {
-        double activity = normalized_values.back();
-        double freq = 1.0 + activity * 1.2;
-        double pulse_scale = 1.0 + 0.35 * std::sin(time_sec * 3.14159 * freq);
-
-        int pulse_r = static_cast<int>(3.0 * pulse_scale);
-        int glow_r = pulse_r + 3;
-
-        drawFilledCircle(prev_x, prev_y, glow_r, scale_color(color, 0.2f));
-        drawFilledCircle(prev_x, prev_y, glow_r - 1, scale_color(color, 0.4f));
-        drawFilledCircle(prev_x, prev_y, pulse_r, color);
-        drawFilledCircle(prev_x, prev_y, std::max(1, pulse_r - 1), interpolate_color(color, RGB(255, 255, 255), 0.5));
-    } else {
-        drawFilledCircle(prev_x, prev_y, 2, color);
-    }
+    dispatchTrace<TraceKind::SERIES>(plot);
+    reclaimTraceBuffers(plot);
 }
 
 void Renderer::drawRingGauge(int cx, int cy, int r, int thickness, double frac,
@@ -1602,25 +2014,19 @@ void Renderer::drawSemiGauge(int cx, int cy, int r, int thickness, double frac,
     }
 }
 
-void Renderer::drawGraphPanel(int x, int y, int w, int h,
-                              const std::string& title,
-                              const std::string& values,
-                              const std::string& subtitle,
-                              const std::string& label_a,
-                              const std::string& label_b,
-                              const std::deque<double>& series_a,
-                              const std::deque<double>& series_b,
-                              double min_val_a, double max_val_a,
-                              double min_val_b, double max_val_b,
-                              color_t color_a, color_t color_b,
-                              MetricType metric_type_a, MetricType metric_type_b,
-                              AnimationEngine& animator, double time_sec) {
+// Graph area of a panel drawn by drawGraphChrome / drawGraphPanel
+static Rect graph_area(int x, int y, int w, int h) {
+    int gy = y + 48;
+    return Rect{x + 10, gy, w - 20, h - (gy - y) - 10};
+}
+
+void Renderer::drawGraphChrome(int x, int y, int w, int h,
+                               const std::string& title,
+                               const std::string& subtitle,
+                               const std::string& label_a,
+                               const std::string& label_b,
+                               color_t color_a, color_t color_b) {
     drawPanelFrame(x, y, w, h, title, subtitle);
-    if (!values.empty()) {
-        float value_fs = (title == "Network Throughput") ? 16.5f : 11.0f;
-        int vw = measureTextWidth(values, value_fs);
-        drawText(values, x + w - vw - 12, y + 6, dimColor(current_theme_.text_status), value_fs);
-    }
     int legend_y = y + 36;
     int lx = x + 12;
     drawRect(lx, legend_y, 6, 6, color_a);
@@ -1630,10 +2036,11 @@ void Renderer::drawGraphPanel(int x, int y, int w, int h,
     drawRect(lx2, legend_y, 6, 6, color_b);
     drawText(label_b, lx2 + 10, legend_y - 2, dimColor(current_theme_.text_status), 11.0f);
 
-    int gx = x + 10;
-    int gy = y + 48;
-    int gw = w - 20;
-    int gh = h - (gy - y) - 10;
+    Rect g = graph_area(x, y, w, h);
+    int gx = g.x;
+    int gy = g.y;
+    int gw = g.w;
+    int gh = g.h;
     color_t grid_minor = scale_color(current_theme_.bar_border, 0.25f);
     color_t grid_major = scale_color(current_theme_.bar_border, 0.45f);
     drawRect(gx, gy, gw, gh, scale_color(current_theme_.spark_bg, 0.9f));
@@ -1649,6 +2056,27 @@ void Renderer::drawGraphPanel(int x, int y, int w, int h,
         color_t col = (r % 2 == 0) ? grid_major : grid_minor;
         drawLine(gx, py, gx + gw - 1, py, col);
     }
+}
+
+void Renderer::drawGraphPanel(int x, int y, int w, int h,
+                              std::string_view values, float value_size,
+                              const SeriesRing& series_a,
+                              const SeriesRing& series_b,
+                              double min_val_a, double max_val_a,
+                              double min_val_b, double max_val_b,
+                              color_t color_a, color_t color_b,
+                              MetricType metric_type_a, MetricType metric_type_b,
+                              AnimationEngine& animator, double time_sec) {
+    // Frame, legend and grid come from the chrome under the layer
+    if (!values.empty()) {
+        int vw = measureTextWidth(values, value_size);
+        drawText(values, x + w - vw - 12, y + 6, dimColor(current_theme_.text_status), value_size);
+    }
+    Rect g = graph_area(x, y, w, h);
+    int gx = g.x;
+    int gy = g.y;
+    int gw = g.w;
+    int gh = g.h;
 
     // Draw scale labels for both series with independent scales
     float label_fs = 10.5f;
@@ -1657,17 +2085,17 @@ void Renderer::drawGraphPanel(int x, int y, int w, int h,
 
     // Left labels for series A (NET1) - inside graph with padding
     int label_x_left = x + 12;
-    std::string label_top_a = formatScaleValue(max_val_a);
-    std::string label_mid_a = formatScaleValue(max_val_a / 2.0);
-    std::string label_bot_a = formatScaleValue(min_val_a);
+    SmallString<16> label_top_a = formatScaleValue(max_val_a);
+    SmallString<16> label_mid_a = formatScaleValue(max_val_a / 2.0);
+    SmallString<16> label_bot_a = formatScaleValue(min_val_a);
     drawText(label_top_a, label_x_left, gy + 1, label_color_a, label_fs);
     drawText(label_mid_a, label_x_left, gy + gh / 2 - 2, label_color_a, label_fs);
     drawText(label_bot_a, label_x_left, gy + gh - 9, label_color_a, label_fs);
 
     // Right labels for series B (NET2) - inside graph, right-aligned
-    std::string label_top_b = formatScaleValue(max_val_b);
-    std::string label_mid_b = formatScaleValue(max_val_b / 2.0);
-    std::string label_bot_b = formatScaleValue(min_val_b);
+    SmallString<16> label_top_b = formatScaleValue(max_val_b);
+    SmallString<16> label_mid_b = formatScaleValue(max_val_b / 2.0);
+    SmallString<16> label_bot_b = formatScaleValue(min_val_b);
     // Measure widths to find the widest label for alignment
     int tw_top = measureTextWidth(label_top_b, label_fs);
     int tw_mid = measureTextWidth(label_mid_b, label_fs);
@@ -1686,10 +2114,10 @@ void Renderer::drawGraphPanel(int x, int y, int w, int h,
 
 void Renderer::drawVitalsPanel(int x, int y, int w, int h,
                                double cpu, double temp, double mem,
-                               double net1, const std::string& wan_status,
+                               double net1, WanState wan_state,
                                color_t cpu_color, color_t temp_color, color_t mem_color, color_t net_color) {
-    (void)wan_status;
-    drawPanelFrame(x, y, w, h, "Vitals", "");
+    (void)wan_state;
+    // Panel frame is part of the chrome
     int inner_y = y + 34;
     int inner_w = w - 16;
     int inner_h = h - (inner_y - y) - 8;
@@ -1702,10 +2130,16 @@ void Renderer::drawVitalsPanel(int x, int y, int w, int h,
     bool use_ram = mem > 0.0;
     double mid_val = use_ram ? mem : net1;
     color_t mid_color = use_ram ? mem_color : net_color;
-    std::string mid_label = use_ram ? "RAM" : "NET1";
-    std::string mid_text = use_ram ? (std::to_string(static_cast<int>(mem)) + "%") : formatNet(net1);
+    const char* mid_label = use_ram ? "RAM" : "NET1";
+    SmallString<16> mid_text;
+    if (use_ram) {
+        mid_text.appendInt(static_cast<int>(mem)).append('%');
+    } else {
+        mid_text = formatNet(net1);
+    }
 
-    auto drawGauge = [&](int idx, double value, double max, color_t color, const std::string& label, const std::string& val) {
+    auto drawGauge = [&](int idx, double value, double max, color_t color, std::string_view label,
+                         std::string_view val) {
         const int lift = 10; // move gauges up
         int block_y = inner_y + idx * block_h;
         int cx = x + w / 2;
@@ -1725,9 +2159,9 @@ void Renderer::drawVitalsPanel(int x, int y, int w, int h,
         drawText(label, cx - lw / 2, label_y, dimColor(current_theme_.text_status), 11.0f);
     };
 
-    drawGauge(0, cpu, 100.0, cpu_color, "CPU", std::to_string(static_cast<int>(cpu)) + "%");
+    drawGauge(0, cpu, 100.0, cpu_color, "CPU", SmallString<16>().appendInt(static_cast<int>(cpu)).append('%'));
     drawGauge(1, mid_val, use_ram ? 100.0 : 2500.0, mid_color, mid_label, mid_text);
-    drawGauge(2, temp, 100.0, temp_color, "TEMP", std::to_string(static_cast<int>(temp)) + "C");
+    drawGauge(2, temp, 100.0, temp_color, "TEMP", SmallString<16>().appendInt(static_cast<int>(temp)).append('C'));
 }
 
 void Renderer::drawPrintScreen(const PrinterMetrics& printer,
@@ -1735,46 +2169,33 @@ void Renderer::drawPrintScreen(const PrinterMetrics& printer,
                                double time_sec) {
     (void)animator;
     (void)time_sec;
-    int left_x = 10, left_y = 10, left_w = 310, left_h = 300;
-    int right_x = 330, right_y = 10, right_w = 140, right_h = 300;
-
-    drawPanelFrame(left_x, left_y, left_w, left_h, "Preview", "");
-    drawPanelFrame(right_x, right_y, right_w, right_h, "Print", "");
-    // Remove divider line under the header for the Print panel
-    color_t panel_bg = scale_color(current_theme_.bar_bg, 0.80f);
-    drawRect(right_x + 10, right_y + 32, right_w - 21, 1, panel_bg);
+    // Panel frames are part of the chrome
+    const Rect& l = print_preview_;
+    const Rect& r = print_status_;
+    int right_x = r.x, right_y = r.y, right_w = r.w;
 
-    int img_pad = 12;
-    int img_x = left_x + img_pad;
-    int img_y = left_y + 36;
-    int img_w = left_w - img_pad * 2;
-    int img_h = left_h - (img_y - left_y) - img_pad;
-    drawImageRGBAFit(img_x, img_y, img_w, img_h, printer);
+    const Rect img = PrintThumbRect(l);
+    drawThumbnail(img.x, img.y, img.w, img.h, printer);
 
     double pct = printer.progress01 * 100.0f;
     pct = std::max(0.0, std::min(100.0, pct));
-    std::ostringstream pct_ss;
-    pct_ss.setf(std::ios::fixed);
-    pct_ss << std::setprecision(3) << pct;
-    std::string pct_text = pct_ss.str();
-    pct_text += "%";
+    if (print_pct_label_.Update(quantize(pct, 3))) {
+        print_pct_label_.text.appendFixed(print_pct_label_.key(), 3).append('%');
+    }
+    std::string_view pct_text = print_pct_label_.text;
     float pct_size = 28.0f;
     int pct_w = measureTextWidth(pct_text, pct_size);
     drawText(pct_text, right_x + (right_w - pct_w) / 2, right_y + 36,
              dimColor(current_theme_.text_value), pct_size);
 
-    std::string state = printer.state;
-    for (char& c : state) {
-        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
-    }
-    if (state.empty()) state = "IDLE";
+    const char* state = printer_state_label(printer.state);
 
     color_t vivid_ok = RGB(0, 255, 80);
     color_t vivid_warn = RGB(255, 230, 0);
     color_t status_color = vivid_ok;
-    if (printer.state == "paused") status_color = vivid_warn;
-    if (printer.state == "error") status_color = current_theme_.state_high;
-    if (printer.state == "complete" || printer.state == "standby") status_color = vivid_ok;
+    if (printer.state == PrinterState::PAUSED) status_color = vivid_warn;
+    if (printer.state == PrinterState::ERROR) status_color = current_theme_.state_high;
+    if (printer.state == PrinterState::COMPLETE || printer.state == PrinterState::STANDBY) status_color = vivid_ok;
     status_color = dimColor(status_color);
     color_t track = scale_color(status_color, 0.20f);
 
@@ -1793,93 +2214,100 @@ void Renderer::drawPrintScreen(const PrinterMetrics& printer,
     drawText(state, right_x + 10, detail_y, status_color, detail_fs);
     detail_y += 14;
 
-    std::string eta = (printer.eta_sec > 0) ? ("ETA " + formatDurationShort(printer.eta_sec)) : "ETA --";
-    std::string el = "E " + formatDurationShort(printer.elapsed_sec);
+    if (print_eta_label_.Update(std::max(0, printer.eta_sec))) {
+        print_eta_label_.text.append("ETA ");
+        print_eta_label_.text.append(printer.eta_sec > 0 ? formatDurationShort(printer.eta_sec).view() : "--");
+    }
+    if (print_elapsed_label_.Update(printer.elapsed_sec)) {
+        print_elapsed_label_.text.append("E ").append(formatDurationShort(printer.elapsed_sec));
+    }
+    std::string_view eta = print_eta_label_.text;
+    std::string_view el = print_elapsed_label_.text;
     drawText(eta, right_x + 10, detail_y, dimColor(current_theme_.text_status), detail_fs);
     int el_w = measureTextWidth(el, detail_fs);
     drawText(el, right_x + right_w - el_w - 10, detail_y, dimColor(current_theme_.text_status), detail_fs);
     detail_y += 14;
 
-    std::string fname = printer.filename.empty() ? "-" : printer.filename;
-    fname = trimTextToWidth(fname, detail_fs, right_w - 20);
-    drawText(fname, right_x + 10, detail_y, dimColor(current_theme_.text_value), detail_fs);
+    std::string_view fname = printer.filename.empty() ? std::string_view("-") : std::string_view(printer.filename);
+    drawText(trimTextToWidth(fname, detail_fs, right_w - 20), right_x + 10, detail_y,
+             dimColor(current_theme_.text_value), detail_fs);
 }
 
-void Renderer::drawImageRGBAFit(int x, int y, int w, int h,
-                                const PrinterMetrics& printer) {
+void Renderer::drawThumbnail(int x, int y, int w, int h,
+                             const PrinterMetrics& printer) {
     if (!target_buffer_) return;
-    auto img = printer.thumb_rgba;
+    const Thumbnail565* img = printer.thumb.get();
     color_t bg = scale_color(current_theme_.spark_bg, 0.85f);
     drawRect(x, y, w, h, bg);
-    if (!img || img->data.empty() || img->w <= 0 || img->h <= 0) {
+    if (!img || img->pixels.empty()) {
         drawText("NO PREVIEW", x + 8, y + h / 2 - 6, dimColor(current_theme_.text_status), 12.0f);
         return;
     }
-    int iw = img->w;
-    int ih = img->h;
-    double scale = std::min(static_cast<double>(w) / iw, static_cast<double>(h) / ih);
-    int dw = std::max(1, static_cast<int>(std::round(iw * scale)));
-    int dh = std::max(1, static_cast<int>(std::round(ih * scale)));
-    int dx = x + (w - dw) / 2;
-    int dy = y + (h - dh) / 2;
-
-    for (int yy = 0; yy < dh; ++yy) {
-        int sy = (yy * ih) / dh;
-        for (int xx = 0; xx < dw; ++xx) {
-            int sx = (xx * iw) / dw;
-            int src_idx = (sy * iw + sx) * 4;
-            uint8_t sr = img->data[src_idx + 0];
-            uint8_t sg = img->data[src_idx + 1];
-            uint8_t sb = img->data[src_idx + 2];
-            uint8_t sa = img->data[src_idx + 3];
-            if (sa == 0) continue;
-            int px = dx + xx;
-            int py = dy + yy;
-            if (px < 0 || py < 0 || px >= DISPLAY_WIDTH || py >= DISPLAY_HEIGHT) continue;
-            size_t di = static_cast<size_t>(py) * DISPLAY_WIDTH + px;
-            if (sa == 255) {
-                (*target_buffer_)[di] = rgb888_to_rgb565(sr, sg, sb);
-            } else {
-                uint8_t dr, dg, db;
-                rgb565_to_rgb888((*target_buffer_)[di], dr, dg, db);
-                uint8_t rr = static_cast<uint8_t>((sr * sa + dr * (255 - sa)) / 255);
-                uint8_t rg = static_cast<uint8_t>((sg * sa + dg * (255 - sa)) / 255);
-                uint8_t rb = static_cast<uint8_t>((sb * sa + db * (255 - sa)) / 255);
-                (*target_buffer_)[di] = rgb888_to_rgb565(rr, rg, rb);
+    // Pre-scaled to the box: centre and clip only
+    int dx = x + (w - img->w) / 2;
+    int dy = y + (h - img->h) / 2;
+    int x0 = std::max({0, dx, x});
+    int x1 = std::min({static_cast<int>(DISPLAY_WIDTH), dx + img->w, x + w});
+    int y0 = std::max({0, dy, y});
+    int y1 = std::min({static_cast<int>(DISPLAY_HEIGHT), dy + img->h, y + h});
+    if (x0 >= x1 || y0 >= y1) return;
+
+    for (int py = y0; py < y1; ++py) {
+        size_t src = static_cast<size_t>(py - dy) * img->w + (x0 - dx);
+        color_t* dst = target_buffer_->data() + static_cast<size_t>(py) * DISPLAY_WIDTH + x0;
+        if (img->alpha.empty()) {
+            std::copy_n(img->pixels.data() + src, x1 - x0, dst);
+            continue;
+        }
+        for (int i = 0; i < x1 - x0; ++i) {
+            int a = img->Alpha(src + i);
+            if (a == 15) {
+                dst[i] = img->pixels[src + i];
+            } else if (a > 0) {
+                dst[i] = blend565(dst[i], img->pixels[src + i], static_cast<uint32_t>(a) * 17);
             }
         }
     }
 }
 
-std::string Renderer::trimTextToWidth(const std::string& s, float size, int max_w) {
-    if (max_w <= 0) return "";
+SmallString<64> Renderer::trimTextToWidth(std::string_view s, float size, int max_w) {
+    if (max_w <= 0) return {};
     if (measureTextWidth(s, size) <= max_w) return s;
-    const std::string ell = "...";
+    const std::string_view ell = "...";
     if (measureTextWidth(ell, size) >= max_w) return ell;
-    std::string out = s;
-    while (!out.empty() && measureTextWidth(out + ell, size) > max_w) {
-        out.pop_back();
-    }
-    return out + ell;
+    if (!glyphs_) return ell;
+    // One pass over the prefixes instead of re-measuring after every pop_back
+    GlyphCache::Face& face = glyphs_->face(size);
+    const int ell_w = measureTextWidth(ell, size);
+    size_t keep = 0;
+    int pen = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        int c = s[i];
+        if (i > 0) pen += glyphs_->kern(face, s[i - 1], c);
+        pen += glyphs_->glyph(face, c).advance;
+        if (pen + glyphs_->kern(face, c, '.') + ell_w <= max_w) keep = i + 1;
+    }
+    return SmallString<64>(s.substr(0, keep)).append(ell);
 }
 
-std::string Renderer::formatDurationShort(int seconds) const {
-    if (seconds < 0) return "--";
+SmallString<16> Renderer::formatDurationShort(int seconds) const {
+    SmallString<16> out;
+    if (seconds < 0) return out.append("--");
     int s = seconds;
     int h = s / 3600;
     int m = (s % 3600) / 60;
     int sec = s % 60;
     if (h > 0) {
-        return std::to_string(h) + "h " + std::to_string(m) + "m";
+        return out.appendInt(h).append("h ").appendInt(m).append('m');
     }
     if (m > 0) {
-        return std::to_string(m) + "m " + std::to_string(sec) + "s";
+        return out.appendInt(m).append("m ").appendInt(sec).append('s');
     }
-    return std::to_string(sec) + "s";
+    return out.appendInt(sec).append('s');
 }
 
 void Renderer::drawServicesPanel(int x, int y, int w, int h,
-                                 const SystemMetrics& metrics) {
+                                 const MetricsSnapshot& metrics) {
     drawPanelFrame(x, y, w, h, "Services", "");
     int rows = 4;
     int row_gap = 6;
@@ -1924,34 +2352,12 @@ void Renderer::drawServicesPanel(int x, int y, int w, int h,
     drawRow(3, "WAN", wan, -1);
 }
 
-void Renderer::drawHeader(int x, int y, int w, int h, const SystemMetrics& metrics) {
-    drawRect(x, y, w, h, scale_color(current_theme_.bar_bg, 0.75f));
-    drawLine(x, y + h - 1, x + w - 1, y + h - 1, current_theme_.bar_border);
-    static std::string title;
-    if (title.empty()) {
-        std::string env_title = getenv_string("LCD_TITLE", "");
-        if (!env_title.empty()) {
-            title = env_title;
-        } else {
-            char host[128] = {0};
-            if (gethostname(host, sizeof(host) - 1) == 0 && host[0]) {
-                title = host;
-            } else {
-                title = "NAS Dashboard";
-            }
-        }
-    }
+void Renderer::drawHeader(int x, int y, int w, int h, const MetricsSnapshot& metrics,
+                          std::string_view uptime) {
+    // Bar background and bottom border are part of the chrome
     // Title intentionally hidden per user request
 
-    std::string wan = metrics.get_wan_status();
-    std::string wg = (metrics.wg_active_peers >= 0) ? std::to_string(metrics.wg_active_peers) : "-";
-    std::string mc = "-";
-    if (metrics.mc_online >= 0 && metrics.mc_max >= 0) {
-        mc = std::to_string(metrics.mc_online) + "/" + std::to_string(metrics.mc_max);
-    } else if (metrics.mc_online >= 0) {
-        mc = std::to_string(metrics.mc_online);
-    }
-    std::string uptime = formatUptime(metrics.uptime_seconds);
+    const char* wan = metrics.get_wan_status();
     float right_fs = 22.0f;
     int ry = y + (h - static_cast<int>(right_fs)) / 2;
 
@@ -1963,9 +2369,9 @@ void Renderer::drawHeader(int x, int y, int w, int h, const SystemMetrics& metri
     color_t bad_col = RGB(255, 60, 60);
 
     auto wan_color = [&]() -> color_t {
-        if (wan == "OK") return ok_col;
-        if (wan == "DEGRADED") return warn_col;
-        if (wan == "DOWN") return bad_col;
+        if (metrics.wan_state == WanState::OK) return ok_col;
+        if (metrics.wan_state == WanState::DEGRADED) return warn_col;
+        if (metrics.wan_state == WanState::DOWN) return bad_col;
         return bad_col;
     }();
     auto wg_color = [&]() -> color_t {
@@ -1979,40 +2385,51 @@ void Renderer::drawHeader(int x, int y, int w, int h, const SystemMetrics& metri
         return neutral_val;
     }();
 
-    struct Seg { std::string t; color_t c; };
-    std::vector<Seg> segs;
-    segs.reserve(16);
-    segs.push_back({"WAN:", label_col});
-    segs.push_back({" " + wan, wan_color});
-    segs.push_back({"  ", label_col});
-    segs.push_back({"WG:", label_col});
-    segs.push_back({" " + wg, wg_color});
-    segs.push_back({"  ", label_col});
-    segs.push_back({"MC:", label_col});
+    struct Seg { SmallString<24> t; color_t c; };
+    Seg segs[12];
+    size_t count = 0;
+    auto seg = [&](color_t c) -> SmallString<24>& {
+        segs[count].t.clear();
+        segs[count].c = c;
+        return segs[count++].t;
+    };
+    seg(label_col).append("WAN:");
+    seg(wan_color).append(' ').append(wan);
+    seg(label_col).append("  ");
+    seg(label_col).append("WG:");
+    if (metrics.wg_active_peers >= 0) {
+        seg(wg_color).append(' ').appendInt(metrics.wg_active_peers);
+    } else {
+        seg(wg_color).append(" -");
+    }
+    seg(label_col).append("  ");
+    seg(label_col).append("MC:");
     if (metrics.mc_online >= 0 && metrics.mc_max >= 0) {
-        segs.push_back({" " + std::to_string(metrics.mc_online), mc_color});
-        segs.push_back({"/" + std::to_string(metrics.mc_max), neutral_val});
+        seg(mc_color).append(' ').appendInt(metrics.mc_online);
+        seg(neutral_val).append('/').appendInt(metrics.mc_max);
+    } else if (metrics.mc_online >= 0) {
+        seg(mc_color).append(' ').appendInt(metrics.mc_online);
     } else {
-        segs.push_back({" " + mc, mc_color});
+        seg(mc_color).append(" -");
     }
-    segs.push_back({"  ", label_col});
-    segs.push_back({"Uptime:", label_col});
-    segs.push_back({" " + uptime, neutral_val});
+    seg(label_col).append("  ");
+    seg(label_col).append("Uptime:");
+    seg(neutral_val).append(' ').append(uptime);
 
     int total_w = 0;
-    for (const auto& s : segs) {
-        total_w += measureTextWidth(s.t, right_fs);
+    for (size_t i = 0; i < count; ++i) {
+        total_w += measureTextWidth(segs[i].t, right_fs);
     }
     int rx = x + (w - total_w) / 2;
     int cx = rx;
-    for (const auto& s : segs) {
-        drawText(s.t, cx, ry, dimColor(s.c), right_fs);
-        cx += measureTextWidth(s.t, right_fs);
+    for (size_t i = 0; i < count; ++i) {
+        drawText(segs[i].t, cx, ry, dimColor(segs[i].c), right_fs);
+        cx += measureTextWidth(segs[i].t, right_fs);
     }
 }
 
 void Renderer::drawFooter(int x, int y, int w, int h,
-                          const SystemMetrics& metrics, const IdleModeController& idle_controller) {
+                          const MetricsSnapshot& metrics, const IdleModeController& idle_controller) {
     drawRect(x, y, w, h, scale_color(current_theme_.bar_bg, 0.75f));
     drawLine(x, y, x + w - 1, y, current_theme_.bar_border);
     float footer_fs = 18.0f;
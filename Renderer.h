@@ -5,12 +5,20 @@
 #include "SystemMetrics.h"
 #include "AnimationEngine.h"
 #include "IdleModeController.h"
+#include "DirtyRect.h"
+#include "GlyphCache.h"
+#include "SeriesRing.h"
+#include "ScreenLayout.h"
+#include "SmallString.h"
 #include <vector>
+#include <memory>
 #include <string>
 #include <cstdint>
-#include <deque>
+#include <string_view>
+#include <utility>
 
 struct PrinterMetrics;
+class HistoryStore;
 
 enum class MetricType {
     CPU,
@@ -24,23 +32,48 @@ public:
     Renderer();
     ~Renderer();
 
-    void Render(const SystemMetrics& metrics,
+    // Retained mode: buffer is treated as the persistent scene and only
+    // layers whose inputs changed are repainted. The repainted regions are
+    // written to invalidated (the whole screen after a full repaint, empty
+    // when nothing changed). Passing a different buffer forces a full repaint.
+    void Render(const MetricsSnapshot& metrics,
                 const PrinterMetrics& printer,
                 AnimationEngine& animator,
                 const IdleModeController& idle_controller,
                 double time_sec,
-                std::vector<uint16_t>& buffer);
+                std::vector<uint16_t>& buffer,
+                std::vector<Rect>* invalidated = nullptr);
 
-    void UpdateHistories(const SystemMetrics& metrics);
-    void UpdateTickerText(const SystemMetrics& metrics);
+    // True if the last frame drew a time-driven effect (e.g. the sparkline
+    // pulse) that changes with time_sec alone
+    bool Animating() const { return scene_animated_; }
+
+    void UpdateHistories(const MetricsSnapshot& metrics);
+    void UpdateTickerText(const MetricsSnapshot& metrics);
+
+    // Persists the graph histories to store and seeds them from it (samples
+    // older than an hour are dropped). The store must outlive the renderer.
+    void AttachHistory(HistoryStore* store);
+    size_t HistorySize() const { return history_size_; }
+    // Print preview image box of the compiled layout (thumbnail pre-scale size)
+    Rect ThumbnailBox() const { return PrintThumbRect(print_preview_); }
+    // The newest restored sample of each graph (CPU, temperature, network)
+    // copied into metrics, for the frame shown before the first metrics
+    // arrive. False if nothing was restored.
+    bool LastKnown(MetricsSnapshot& metrics) const;
+
+    // (Re)compiles the screen layout from LCD_LAYOUT_FILE (the built-in one
+    // when unset). A file that fails to parse or validate is reported and
+    // the current layout stays; the next frame is a full repaint.
+    bool ReloadLayout();
 
 private:
     void loadFont(const std::string& font_path, float size);
     
-    void drawText(const std::string& text, int x, int y, color_t color, float size);
-    void drawTextClipped(const std::string& text, int x, int y, color_t color, float size,
+    void drawText(std::string_view text, int x, int y, color_t color, float size);
+    void drawTextClipped(std::string_view text, int x, int y, color_t color, float size,
                          int clip_x, int clip_y, int clip_w, int clip_h);
-    int measureTextWidth(const std::string& text, float size);
+    int measureTextWidth(std::string_view text, float size);
     void drawRect(int x, int y, int w, int h, color_t color);
     void drawLine(int x0, int y0, int x1, int y1, color_t color);
     void drawCircle(int cx, int cy, int r, color_t color);
@@ -50,7 +83,7 @@ private:
     void drawGrid(int x, int y, int w, int h, int cell, int offset_x, int offset_y, color_t color);
     
     void drawIcon(const std::string& name, int x, int y, int size, color_t color);
-    void drawSparkline(int x, int y, int w, int h, const std::vector<double>& data,
+    void drawSparkline(int x, int y, int w, int h, const SeriesRing& data,
                        double min_val, double max_val, color_t color, color_t bg_color, int line_width,
                        MetricType metric_type, AnimationEngine& animator);
     void drawProgressBar(int x, int y, int w, int h, double value, color_t color, color_t bg);
@@ -58,7 +91,7 @@ private:
                   const std::string& value,
                   double indicator_val,
                   double indicator_max,
-                  const std::vector<double>& history,
+                  const SeriesRing& history,
                   double hist_min,
                   double hist_max,
                   int x, int y, int w, int h,
@@ -68,13 +101,23 @@ private:
                   bool show_progress_bar,
                   MetricType metric_type,
                   AnimationEngine& animator);
-    void drawStatusBar(const SystemMetrics& metrics, const IdleModeController& idle_controller);
+    void drawStatusBar(const MetricsSnapshot& metrics, const IdleModeController& idle_controller);
 
     void drawPanelFrame(int x, int y, int w, int h, const std::string& title, const std::string& subtitle);
-    void drawSeriesLine(const std::deque<double>& data, int x, int y, int w, int h,
+    void drawSeriesLine(const SeriesRing& data, int x, int y, int w, int h,
                         double min_val, double max_val, color_t color,
                         color_t shadow_color, int width, MetricType metric_type,
                         AnimationEngine& animator, double time_sec);
+    // Shared effect stages of drawSparkline / drawSeriesLine (see Renderer.cpp)
+    enum class TraceKind { SPARKLINE, SERIES };
+    struct TracePlot;
+    unsigned traceEffects() const;
+    // A TracePlot borrows trace_points_ / trace_values_ while it is built and
+    // drawn, so their capacity carries over from frame to frame
+    void lendTraceBuffers(TracePlot& plot);
+    void reclaimTraceBuffers(TracePlot& plot);
+    template <TraceKind Kind> void dispatchTrace(const TracePlot& plot);
+    template <TraceKind Kind, unsigned FX> void drawTrace(const TracePlot& plot);
     void drawRingGauge(int cx, int cy, int r, int thickness, double frac,
                        color_t active, color_t inactive, int segments);
     void drawArcPolyline(int cx, int cy, int r, double a0, double a1, color_t color);
@@ -85,14 +128,17 @@ private:
                              color_t active, color_t inactive);
     void drawSemiGauge(int cx, int cy, int r, int thickness, double frac,
                        color_t active, color_t track);
+    // Static part of a graph panel: frame, titles, legend and grid
+    void drawGraphChrome(int x, int y, int w, int h,
+                         const std::string& title,
+                         const std::string& subtitle,
+                         const std::string& label_a,
+                         const std::string& label_b,
+                         color_t color_a, color_t color_b);
     void drawGraphPanel(int x, int y, int w, int h,
-                        const std::string& title,
-                        const std::string& values,
-                        const std::string& subtitle,
-                        const std::string& label_a,
-                        const std::string& label_b,
-                        const std::deque<double>& series_a,
-                        const std::deque<double>& series_b,
+                        std::string_view values, float value_size,
+                        const SeriesRing& series_a,
+                        const SeriesRing& series_b,
                         double min_val_a, double max_val_a,
                         double min_val_b, double max_val_b,
                         color_t color_a, color_t color_b,
@@ -100,26 +146,28 @@ private:
                         AnimationEngine& animator, double time_sec);
     void drawVitalsPanel(int x, int y, int w, int h,
                          double cpu, double temp, double mem,
-                         double net1, const std::string& wan_status,
+                         double net1, WanState wan_state,
                          color_t cpu_color, color_t temp_color, color_t mem_color, color_t net_color);
     void drawPrintScreen(const PrinterMetrics& printer,
                          AnimationEngine& animator,
                          double time_sec);
-    void drawImageRGBAFit(int x, int y, int w, int h,
-                          const PrinterMetrics& printer);
-    std::string trimTextToWidth(const std::string& s, float size, int max_w);
-    std::string formatDurationShort(int seconds) const;
+    void drawThumbnail(int x, int y, int w, int h,
+                       const PrinterMetrics& printer);
+    SmallString<64> trimTextToWidth(std::string_view s, float size, int max_w);
+    SmallString<16> formatDurationShort(int seconds) const;
     void drawServicesPanel(int x, int y, int w, int h,
-                           const SystemMetrics& metrics);
-    void drawHeader(int x, int y, int w, int h, const SystemMetrics& metrics);
-    void drawFooter(int x, int y, int w, int h, const SystemMetrics& metrics, const IdleModeController& idle_controller);
+                           const MetricsSnapshot& metrics);
+    // uptime: the text formatUptime() gave for this frame (uptime_label_)
+    void drawHeader(int x, int y, int w, int h, const MetricsSnapshot& metrics,
+                    std::string_view uptime);
+    void drawFooter(int x, int y, int w, int h, const MetricsSnapshot& metrics, const IdleModeController& idle_controller);
 
     color_t pickStateColor(double value, const std::string& key) const;
-    std::string formatNet(double mbps) const;
-    std::string formatUptime(int seconds) const;
-    double computeNetScale(const std::deque<double>& history, double& smooth_max);
+    SmallString<16> formatNet(double mbps) const;
+    SmallString<16> formatUptime(int seconds) const;
+    double computeNetScale(const SeriesRing& history, double& smooth_max);
     color_t dimColor(color_t c) const;
-    std::string formatScaleValue(double value) const;
+    SmallString<16> formatScaleValue(double value) const;
 
     std::vector<uint16_t>* target_buffer_ = nullptr;
     Theme current_theme_;
@@ -132,13 +180,23 @@ private:
     // Font rendering
     std::vector<uint8_t> font_buffer_;
     void* font_info_ = nullptr; // stbtt_fontinfo
+    std::unique_ptr<GlyphCache> glyphs_;
+    bool text_aa_ = true; // blend glyph coverage instead of drawing any coverage solid
 
     // Histories for sparklines
-    std::deque<double> history_cpu_;
-    std::deque<double> history_temp_;
-    std::deque<double> history_net1_;
-    std::deque<double> history_net2_;
+    SeriesRing history_cpu_;
+    SeriesRing history_temp_;
+    SeriesRing history_net1_;
+    SeriesRing history_net2_;
     size_t history_size_ = 51;
+    HistoryStore* store_ = nullptr;
+
+    // LCD_NET_GRAPH_RANGE=24h: network panel drawn from the store's 1-min tier
+    void refreshDayHistory();
+    bool net_range_day_ = false;
+    SeriesRing day_net1_;
+    SeriesRing day_net2_;
+    uint64_t day_version_ = ~0ull; // store MIN tier version the rings were built from
 
     // Ticker
     std::string ticker_text_;
@@ -153,7 +211,6 @@ private:
     double net_autoscale_ema_ = 0.15;
     double net1_scale_max_ = 0.0;
     double net2_scale_max_ = 0.0;
-    mutable std::vector<double> scratch_values_;
     float idle_t_ = 0.0f;
 
     // Sparkline smoothing (EMA filter for network data)
@@ -175,12 +232,89 @@ private:
     bool sparkline_shadow_ = true;             // Shadow/depth effect
     bool sparkline_color_zones_ = true;        // Color accents for zones
     bool sparkline_smooth_transitions_ = true; // Enhanced color transitions
+    unsigned trace_fx_ = 0;                    // TraceFx bits of the flags above
+    std::vector<std::pair<int, int>> trace_points_;
+    std::vector<double> trace_values_;
+    std::vector<size_t> trace_peaks_; // peak highlights of the trace being drawn
+    double pulse_phase_ = 0.0;                 // sparkline endpoint pulse (EFFECT 1)
+    double shimmer_phase_ = 0.0;               // sparkline baseline shimmer (EFFECT 7)
 
     // Screen mode switching
     enum class ScreenMode { MAIN, PRINT };
     ScreenMode screen_mode_ = ScreenMode::MAIN;
     double last_screen_switch_ts_ = 0.0;
     bool last_print_eligible_ = false;
+
+    // Retained scene: one layer per panel. Panels do not overlap, so the
+    // scene buffer itself is the backing store of every layer.
+    struct Layer {
+        Rect rect{0, 0, 0, 0};
+        uint64_t signature = 0; // hash of everything the panel draws from
+        bool valid = false;
+    };
+    bool beginLayer(Layer& layer, const Rect& rect, uint64_t signature, bool animated,
+                    std::vector<Rect>* invalidated);
+
+    // Main screen draw list compiled from the ScreenLayout: a contiguous
+    // array walked in order by Render and drawChrome, each widget with its
+    // rect, title, font size and colours resolved and its own layer.
+    struct Widget {
+        WidgetKind kind;
+        Rect rect;
+        std::string title;
+        float value_size;
+        color_t color_a, color_b;
+        Layer layer;
+        LabelMemo<48> values; // value label, re-formatted when a shown digit changes
+    };
+    void compileLayout(const ScreenLayout& layout);
+    std::vector<Widget> widgets_;
+    Rect print_preview_{0, 0, 0, 0};
+    Rect print_status_{0, 0, 0, 0};
+    Layer print_layer_;
+    // Labels kept across frames, re-formatted only when what they show changes
+    LabelMemo<16> uptime_label_;
+    LabelMemo<16> print_pct_label_;
+    LabelMemo<24> print_eta_label_;
+    LabelMemo<24> print_elapsed_label_;
+    uint64_t layout_version_ = 0; // part of the chrome key
+
+    // Background and panel chrome (frames, titles, legends, grids) of each
+    // screen, pre-composed once per idle step: idle_t is quantized to
+    // chrome_steps_ steps for them, step 0 / chrome_steps_ being the final
+    // active / idle looks. A frame starts as a copy of its chrome and a
+    // repainted layer restores its rect from it.
+    struct ChromeFrame {
+        ScreenMode mode = ScreenMode::MAIN;
+        int step = 0;
+        std::vector<uint16_t> pixels;
+    };
+    const std::vector<uint16_t>& chromeFrame(ScreenMode mode, int step);
+    void drawChrome(ScreenMode mode);
+    std::vector<ChromeFrame> chrome_;
+    uint64_t chrome_key_ = 0; // theme and layout the cached frames were drawn for
+    int chrome_steps_ = 8;
+    const std::vector<uint16_t>* chrome_cur_ = nullptr; // chrome of the frame being rendered
+
+    // AnimationEngine channels, registered on the first frame drawn with an engine
+    struct AnimChannels {
+        const AnimationEngine* owner = nullptr;
+        AnimationEngine::Handle cpu = AnimationEngine::INVALID;
+        AnimationEngine::Handle temp = AnimationEngine::INVALID;
+        AnimationEngine::Handle net1 = AnimationEngine::INVALID;
+        AnimationEngine::Handle net2 = AnimationEngine::INVALID;
+        AnimationEngine::Handle gamma[4] = {AnimationEngine::INVALID, AnimationEngine::INVALID,
+                                            AnimationEngine::INVALID, AnimationEngine::INVALID}; // by MetricType
+    };
+    void bindAnimator(AnimationEngine& animator);
+    AnimChannels anim_;
+
+    bool retained_ = true;
+    const uint16_t* scene_data_ = nullptr;
+    int scene_step_ = -1; // chrome idle step the scene was repainted on
+    ScreenMode scene_mode_ = ScreenMode::MAIN;
+    uint64_t history_version_ = 0; // bumped by UpdateHistories
+    bool scene_animated_ = false;
 };
 
 #endif // RENDERER_H
@@ -0,0 +1,227 @@
+#include "ScreenLayout.h"
+#include "DisplayConfig.h"
+#include "json.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace {
+constexpr size_t MAX_WIDGETS = 16;
+constexpr int MIN_PRINT_PANEL = 100;
+
+// Fixed palette for series (do not depend on state)
+constexpr color_t SERIES_NET1 = RGB(0, 210, 255);   // vivid cyan/blue
+constexpr color_t SERIES_NET2 = RGB(255, 220, 0);   // vivid yellow
+constexpr color_t SERIES_CPU = RGB(0, 255, 80);     // vivid green
+constexpr color_t SERIES_TEMP = RGB(255, 140, 80);  // warm orange
+
+struct KindInfo {
+    WidgetKind kind;
+    const char* name;
+    const char* title;
+    float value_size;
+    color_t color_a, color_b;
+    int min_w, min_h; // below this the panel's own geometry breaks down
+};
+
+const KindInfo KINDS[] = {
+    {WidgetKind::HEADER, "header", "", 0.0f, 0, 0, 64, 16},
+    {WidgetKind::NET_GRAPH, "net", "Network Throughput", 16.5f, SERIES_NET1, SERIES_NET2, 120, 80},
+    {WidgetKind::CPU_GRAPH, "cpu", "CPU & TEMP", 11.0f, SERIES_CPU, SERIES_TEMP, 120, 80},
+    {WidgetKind::VITALS, "vitals", "Vitals", 0.0f, 0, 0, 60, 100},
+    {WidgetKind::SERVICES, "services", "Services", 0.0f, 0, 0, 80, 60},
+    {WidgetKind::TICKER, "ticker", "", 0.0f, 0, 0, 64, 16},
+};
+
+const KindInfo& kind_info(WidgetKind kind) {
+    for (const auto& k : KINDS) {
+        if (k.kind == kind) return k;
+    }
+    return KINDS[0];
+}
+
+WidgetSpec make_widget(WidgetKind kind, const Rect& rect) {
+    const KindInfo& k = kind_info(kind);
+    WidgetSpec w;
+    w.kind = kind;
+    w.rect = rect;
+    w.title = k.title;
+    w.value_size = k.value_size;
+    w.color_a = k.color_a;
+    w.color_b = k.color_b;
+    return w;
+}
+
+bool parse_rect(const json& j, Rect& out) {
+    if (!j.is_array() || j.size() != 4) return false;
+    int v[4];
+    for (size_t i = 0; i < 4; ++i) {
+        if (!j[i].is_number_integer()) return false;
+        v[i] = j[i].get<int>();
+    }
+    out = Rect{v[0], v[1], v[2], v[3]};
+    return out.w > 0 && out.h > 0 && out.x >= 0 && out.y >= 0 &&
+           out.x + out.w <= DISPLAY_WIDTH && out.y + out.h <= DISPLAY_HEIGHT;
+}
+
+// "#rrggbb"
+bool parse_color(const json& j, color_t& out) {
+    if (!j.is_string()) return false;
+    const std::string s = j.get<std::string>();
+    if (s.size() != 7 || s[0] != '#') return false;
+    char* end = nullptr;
+    unsigned long v = std::strtoul(s.c_str() + 1, &end, 16);
+    if (*end != '\0') return false;
+    out = RGB(static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v));
+    return true;
+}
+
+bool overlaps(const Rect& a, const Rect& b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+}
+
+const char* widget_kind_name(WidgetKind kind) {
+    return kind_info(kind).name;
+}
+
+ScreenLayout DefaultScreenLayout() {
+    constexpr int HEADER_HEIGHT = 42;
+    constexpr int FOOTER_HEIGHT = 0;
+    constexpr int MARGIN = 12;
+    constexpr int GAP = 10;
+    // Narrower right panel (~1.5x) to give sparklines more width
+    constexpr int LEFT_PANEL_WIDTH = 355;
+
+    const int right_w = DISPLAY_WIDTH - 2 * MARGIN - GAP - LEFT_PANEL_WIDTH;
+    const int content_y0 = HEADER_HEIGHT + 10;
+    const int content_y1 = DISPLAY_HEIGHT - FOOTER_HEIGHT - 8;
+    const int graph_h = (content_y1 - content_y0 - GAP) / 2;
+
+    ScreenLayout layout;
+    layout.main.push_back(make_widget(WidgetKind::HEADER, {0, 0, DISPLAY_WIDTH, HEADER_HEIGHT}));
+    layout.main.push_back(make_widget(WidgetKind::NET_GRAPH, {MARGIN, content_y0, LEFT_PANEL_WIDTH, graph_h}));
+    layout.main.push_back(make_widget(WidgetKind::CPU_GRAPH,
+                                      {MARGIN, content_y0 + graph_h + GAP, LEFT_PANEL_WIDTH, graph_h}));
+    layout.main.push_back(make_widget(WidgetKind::VITALS,
+                                      {MARGIN + LEFT_PANEL_WIDTH + GAP, content_y0, right_w, content_y1 - content_y0}));
+    layout.print_preview = {10, 10, 310, 300};
+    layout.print_status = {330, 10, 140, 300};
+    return layout;
+}
+
+Rect PrintThumbRect(const Rect& preview) {
+    constexpr int PAD = 12;
+    constexpr int TITLE_H = 36;
+    return Rect{preview.x + PAD, preview.y + TITLE_H, std::max(0, preview.w - PAD * 2),
+                std::max(0, preview.h - TITLE_H - PAD)};
+}
+
+bool LoadScreenLayout(const std::string& path, ScreenLayout& out, std::string& error) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    json j = json::parse(text.str(), nullptr, false);
+    if (j.is_discarded() || !j.is_object()) {
+        error = "not a JSON object";
+        return false;
+    }
+    const auto main_it = j.find("main");
+    if (main_it == j.end() || !main_it->is_array() || main_it->empty()) {
+        error = "\"main\" must be a non-empty array of widgets";
+        return false;
+    }
+    if (main_it->size() > MAX_WIDGETS) {
+        error = "more than " + std::to_string(MAX_WIDGETS) + " widgets";
+        return false;
+    }
+
+    ScreenLayout layout = DefaultScreenLayout();
+    layout.main.clear();
+    for (size_t i = 0; i < main_it->size(); ++i) {
+        const json& wj = (*main_it)[i];
+        const std::string where = "main[" + std::to_string(i) + "]: ";
+        if (!wj.is_object()) {
+            error = where + "not an object";
+            return false;
+        }
+        const std::string name = wj.contains("widget") && wj["widget"].is_string()
+                                     ? wj["widget"].get<std::string>() : "";
+        const KindInfo* k = nullptr;
+        for (const auto& info : KINDS) {
+            if (name == info.name) k = &info;
+        }
+        if (!k) {
+            error = where + "unknown widget \"" + name + "\"";
+            return false;
+        }
+        Rect rect{};
+        if (!wj.contains("rect") || !parse_rect(wj["rect"], rect)) {
+            error = where + "\"rect\" must be [x, y, w, h] inside the screen";
+            return false;
+        }
+        if (rect.w < k->min_w || rect.h < k->min_h) {
+            error = where + name + " needs at least " + std::to_string(k->min_w) + "x" + std::to_string(k->min_h);
+            return false;
+        }
+        WidgetSpec w = make_widget(k->kind, rect);
+        if (wj.contains("title")) {
+            if (!wj["title"].is_string()) {
+                error = where + "\"title\" must be a string";
+                return false;
+            }
+            w.title = wj["title"].get<std::string>();
+        }
+        if (wj.contains("value_size")) {
+            if (!wj["value_size"].is_number() || wj["value_size"].get<double>() < 6.0 ||
+                wj["value_size"].get<double>() > 48.0) {
+                error = where + "\"value_size\" must be a number in 6..48";
+                return false;
+            }
+            w.value_size = wj["value_size"].get<float>();
+        }
+        if (wj.contains("colors")) {
+            const json& c = wj["colors"];
+            if (!c.is_array() || c.size() != 2 || !parse_color(c[0], w.color_a) || !parse_color(c[1], w.color_b)) {
+                error = where + "\"colors\" must be two \"#rrggbb\" strings";
+                return false;
+            }
+        }
+        for (size_t o = 0; o < layout.main.size(); ++o) {
+            if (overlaps(layout.main[o].rect, rect)) {
+                error = where + "overlaps main[" + std::to_string(o) + "]";
+                return false;
+            }
+        }
+        layout.main.push_back(std::move(w));
+    }
+
+    const auto print_it = j.find("print");
+    if (print_it != j.end()) {
+        if (!print_it->is_object() || !print_it->contains("preview") || !print_it->contains("status") ||
+            !parse_rect((*print_it)["preview"], layout.print_preview) ||
+            !parse_rect((*print_it)["status"], layout.print_status)) {
+            error = "\"print\" needs \"preview\" and \"status\" rects inside the screen";
+            return false;
+        }
+        if (std::min({layout.print_preview.w, layout.print_preview.h,
+                      layout.print_status.w, layout.print_status.h}) < MIN_PRINT_PANEL) {
+            error = "print panels need at least " + std::to_string(MIN_PRINT_PANEL) + "x" +
+                    std::to_string(MIN_PRINT_PANEL);
+            return false;
+        }
+        if (overlaps(layout.print_preview, layout.print_status)) {
+            error = "print preview and status overlap";
+            return false;
+        }
+    }
+    out = std::move(layout);
+    return true;
+}
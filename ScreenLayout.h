@@ -0,0 +1,52 @@
+#ifndef SCREEN_LAYOUT_H
+#define SCREEN_LAYOUT_H
+
+#include "DirtyRect.h"
+#include "Theme.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Screen layout as data (LCD_LAYOUT_FILE, JSON). The main screen is a list
+// of widgets with fixed rects, drawn in order; the print screen has its
+// preview and status panels. Widgets must not overlap: each one is a
+// retained layer backed by the scene buffer itself.
+//
+//   {"main": [{"widget": "net", "rect": [12, 52, 355, 125],
+//              "title": "Network Throughput", "value_size": 16.5,
+//              "colors": ["#00d2ff", "#ffdc00"]}, ...],
+//    "print": {"preview": [10, 10, 310, 300], "status": [330, 10, 140, 300]}}
+//
+// Widgets: header, net, cpu, vitals, services, ticker. Omitted keys take the
+// widget's defaults; a missing "print" keeps the default print screen.
+enum class WidgetKind : uint8_t { HEADER, NET_GRAPH, CPU_GRAPH, VITALS, SERVICES, TICKER };
+
+struct WidgetSpec {
+    WidgetKind kind = WidgetKind::HEADER;
+    Rect rect{0, 0, 0, 0};
+    std::string title;        // panel title (graphs, vitals)
+    float value_size = 11.0f; // font size of a graph's value label
+    color_t color_a = 0;      // graph series colours, before idle dimming
+    color_t color_b = 0;
+};
+
+struct ScreenLayout {
+    std::vector<WidgetSpec> main;
+    Rect print_preview{0, 0, 0, 0};
+    Rect print_status{0, 0, 0, 0};
+};
+
+const char* widget_kind_name(WidgetKind kind);
+
+// The built-in layout: header, network and CPU graphs, vitals
+ScreenLayout DefaultScreenLayout();
+
+// The image box inside a print preview panel (below its title, padded).
+// PrinterClient pre-scales thumbnails to it.
+Rect PrintThumbRect(const Rect& preview);
+
+// Parses and validates a layout file. On failure out is left untouched and
+// error says what was wrong (with the widget index).
+bool LoadScreenLayout(const std::string& path, ScreenLayout& out, std::string& error);
+
+#endif // SCREEN_LAYOUT_H
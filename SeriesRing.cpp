@@ -0,0 +1,77 @@
+#include "SeriesRing.h"
+#include <algorithm>
+#include <cmath>
+
+SeriesRing::SeriesRing(size_t capacity) {
+    Reset(capacity);
+}
+
+void SeriesRing::Reset(size_t capacity) {
+    data_.assign(capacity, 0.0f);
+    peak_.assign(capacity, 0);
+    sorted_.clear();
+    sorted_.reserve(capacity);
+    head_ = 0;
+    size_ = 0;
+}
+
+void SeriesRing::Clear() {
+    std::fill(peak_.begin(), peak_.end(), 0);
+    sorted_.clear();
+    head_ = 0;
+    size_ = 0;
+}
+
+void SeriesRing::Push(float v) {
+    if (data_.empty()) return;
+    if (size_ == data_.size()) {
+        float old = data_[head_];
+        auto it = std::lower_bound(sorted_.begin(), sorted_.end(), old);
+        if (it != sorted_.end()) sorted_.erase(it);
+        head_ = slot(1);
+        --size_;
+    }
+    size_t s = slot(size_);
+    data_[s] = v;
+    peak_[s] = 0;
+    ++size_;
+    sorted_.insert(std::upper_bound(sorted_.begin(), sorted_.end(), v), v);
+
+    // The sample two places back now has both newer neighbours
+    if (size_ >= 5) {
+        size_t i = size_ - 3;
+        float c = (*this)[i];
+        peak_[slot(i)] = (c > (*this)[i - 1] && c > (*this)[i - 2] &&
+                          c > (*this)[i + 1] && c > (*this)[i + 2]) ? 1 : 0;
+    }
+}
+
+SeriesRing::Span SeriesRing::first() const {
+    Span s;
+    if (size_ == 0) return s;
+    s.data = data_.data() + head_;
+    s.size = std::min(size_, data_.size() - head_);
+    return s;
+}
+
+SeriesRing::Span SeriesRing::second() const {
+    Span s;
+    size_t n = first().size;
+    if (n >= size_) return s;
+    s.data = data_.data();
+    s.size = size_ - n;
+    return s;
+}
+
+float SeriesRing::Percentile(double p) const {
+    if (sorted_.empty()) return 0.0f;
+    p = std::min(1.0, std::max(0.0, p));
+    size_t idx = static_cast<size_t>(std::round(p * (sorted_.size() - 1)));
+    if (idx >= sorted_.size()) idx = sorted_.size() - 1;
+    return sorted_[idx];
+}
+
+bool SeriesRing::IsPeak(size_t i) const {
+    if (i < 2 || i + 2 >= size_) return false;
+    return peak_[slot(i)] != 0;
+}
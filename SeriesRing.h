@@ -0,0 +1,69 @@
+#ifndef SERIES_RING_H
+#define SERIES_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-capacity history of float samples for the graphs.
+//
+// Storage is one contiguous ring allocated up front, so pushes never touch
+// the heap. Readers get the samples oldest first as at most two linear
+// spans. Alongside the ring it keeps a sorted copy (one memmove per push)
+// for Min/Max/Percentile, and a per-slot flag for strict local peaks over
+// a +-2 sample window. The flag is settled once the sample has two newer
+// neighbours.
+class SeriesRing {
+public:
+    struct Span {
+        const float* data = nullptr;
+        size_t size = 0;
+    };
+
+    explicit SeriesRing(size_t capacity = 0);
+
+    void Reset(size_t capacity); // clears and resizes
+    void Clear();
+    void Push(float v);
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return data_.size(); }
+    bool empty() const { return size_ == 0; }
+
+    // i = 0 is the oldest sample
+    float operator[](size_t i) const { return data_[slot(i)]; }
+    float back() const { return data_[slot(size_ - 1)]; }
+
+    Span first() const;  // oldest samples up to the end of storage
+    Span second() const; // wrapped remainder, may be empty
+
+    template <typename F>
+    void ForEach(F&& fn) const {
+        Span a = first();
+        Span b = second();
+        size_t i = 0;
+        for (size_t k = 0; k < a.size; ++k) fn(i++, a.data[k]);
+        for (size_t k = 0; k < b.size; ++k) fn(i++, b.data[k]);
+    }
+
+    float Min() const { return sorted_.empty() ? 0.0f : sorted_.front(); }
+    float Max() const { return sorted_.empty() ? 0.0f : sorted_.back(); }
+    // Nearest-rank percentile, p in 0..1
+    float Percentile(double p) const;
+    // data[i] > data[i +- 1] and data[i +- 2]; false within two samples of either end
+    bool IsPeak(size_t i) const;
+
+private:
+    size_t slot(size_t i) const {
+        size_t s = head_ + i;
+        return s >= data_.size() ? s - data_.size() : s;
+    }
+
+    std::vector<float> data_;
+    std::vector<float> sorted_;
+    std::vector<uint8_t> peak_; // per storage slot
+    size_t head_ = 0;           // slot of the oldest sample
+    size_t size_ = 0;
+};
+
+#endif // SERIES_RING_H
@@ -0,0 +1,114 @@
+#ifndef SMALL_STRING_H
+#define SMALL_STRING_H
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Fixed-capacity text for labels built while a frame is rendered: it lives
+// in place (on the stack or in the renderer) and never touches the heap.
+// Appends past the capacity are cut off; labels are short, so a cut label
+// is a layout problem, not a memory one.
+template <size_t N>
+class SmallString {
+public:
+    SmallString() { buf_[0] = '\0'; }
+    SmallString(std::string_view s) { buf_[0] = '\0'; append(s); }
+
+    void clear() {
+        len_ = 0;
+        buf_[0] = '\0';
+    }
+
+    SmallString& append(std::string_view s) {
+        const size_t n = s.size() < N - len_ ? s.size() : N - len_;
+        for (size_t i = 0; i < n; ++i) buf_[len_ + i] = s[i];
+        len_ += n;
+        buf_[len_] = '\0';
+        return *this;
+    }
+    SmallString& append(char c) { return append(std::string_view(&c, 1)); }
+
+    SmallString& appendInt(long long v) {
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        return append(std::string_view(tmp, static_cast<size_t>(res.ptr - tmp)));
+    }
+
+    // Fixed point: scaled / 10^decimals, e.g. appendFixed(12345, 3) -> "12.345"
+    SmallString& appendFixed(long long scaled, int decimals) {
+        if (decimals <= 0) return appendInt(scaled);
+        if (scaled < 0) {
+            append('-');
+            scaled = -scaled;
+        }
+        long long div = 1;
+        for (int i = 0; i < decimals; ++i) div *= 10;
+        appendInt(scaled / div);
+        append('.');
+        char frac[20];
+        long long f = scaled % div;
+        for (int i = decimals - 1; i >= 0; --i) {
+            frac[i] = static_cast<char>('0' + f % 10);
+            f /= 10;
+        }
+        return append(std::string_view(frac, static_cast<size_t>(decimals)));
+    }
+
+    std::string_view view() const { return std::string_view(buf_, len_); }
+    operator std::string_view() const { return view(); }
+    const char* c_str() const { return buf_; }
+    size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+
+private:
+    char buf_[N + 1];
+    size_t len_ = 0;
+};
+
+// v rounded to the given decimals, as the integer appendFixed() prints:
+// the same digits as printf's "%.*f". v * 10^d can round onto an exact .5
+// that v itself is not (0.0055 is 0.00549999...), so such a tie is settled
+// by the exact remainder of the product, and only a true tie goes to even.
+inline long long quantize(double v, int decimals) {
+    double scale = 1.0;
+    for (int i = 0; i < decimals; ++i) scale *= 10.0;
+    const double x = v * scale;
+    const double f = std::floor(x);
+    if (x - f == 0.5) {
+        const double rem = std::fma(v, scale, -x);
+        if (rem > 0.0) return static_cast<long long>(f) + 1;
+        if (rem < 0.0) return static_cast<long long>(f);
+    }
+    return static_cast<long long>(std::nearbyint(x));
+}
+
+// A label re-formatted only when its input changes at the displayed
+// precision. Key it with what the label shows (the quantize()d value, not
+// the raw double):
+//   if (memo.Update(quantize(pct, 1))) memo.text.appendFixed(memo.key(), 1);
+template <size_t N>
+class LabelMemo {
+public:
+    // True when the key changed: text is cleared for the caller to rebuild
+    bool Update(int64_t key) {
+        if (valid_ && key == key_) return false;
+        valid_ = true;
+        key_ = key;
+        text.clear();
+        return true;
+    }
+    // Forgets the key, so the next Update() re-formats
+    void Invalidate() { valid_ = false; }
+    int64_t key() const { return key_; }
+
+    SmallString<N> text;
+
+private:
+    int64_t key_ = 0;
+    bool valid_ = false;
+};
+
+#endif // SMALL_STRING_H
@@ -0,0 +1,88 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer snapshot publication between a worker and the render thread.
+//
+// SeqLock<T> is for small trivially copyable values: the writer never waits,
+// a reader retries only while a Store() is in flight. The payload is kept in
+// relaxed atomic words, so concurrent copies are not a data race.
+//
+// TripleBuffer<T> is for values that own memory (strings, shared_ptr): the
+// writer fills a private slot and swaps it in, the reader swaps the newest
+// slot out. Both sides are wait-free and the reader never copies, so it never
+// allocates; Front() stays valid until the reader's next Update().
+
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable T");
+
+public:
+    SeqLock() { Store(T{}); seq_.store(0, std::memory_order_relaxed); }
+
+    // Writer thread only
+    void Store(const T& value) {
+        uint64_t buf[WORDS] = {};
+        std::memcpy(buf, &value, sizeof(T));
+        const uint64_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) words_[i].store(buf[i], std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // Any thread. Returns the version that was read (even; 0 = never stored).
+    uint64_t Load(T& out) const {
+        uint64_t buf[WORDS];
+        for (;;) {
+            const uint64_t s0 = seq_.load(std::memory_order_acquire);
+            if (s0 & 1) continue;
+            for (size_t i = 0; i < WORDS; ++i) buf[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == s0) {
+                std::memcpy(&out, buf, sizeof(T));
+                return s0;
+            }
+        }
+    }
+
+    uint64_t Version() const { return seq_.load(std::memory_order_acquire) & ~uint64_t(1); }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> words_[WORDS];
+};
+
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer: fill Back() completely (it holds an older value), then Publish()
+    T& Back() { return slots_[back_]; }
+    void Publish() {
+        back_ = state_.exchange(static_cast<uint8_t>(back_ | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader: swaps in the newest published value; false if there was none
+    bool Update() {
+        if (!(state_.load(std::memory_order_relaxed) & FRESH)) return false;
+        front_ = state_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& Front() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;
+    T slots_[3];
+    uint8_t back_ = 0;              // writer's slot
+    std::atomic<uint8_t> state_{1}; // middle slot | FRESH
+    uint8_t front_ = 2;             // reader's slot
+};
+
+#endif // SNAPSHOT_H
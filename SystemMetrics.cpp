@@ -1,5 +1,6 @@
 #include "SystemMetrics.h"
 #include "utils.h"
+#include "Profiler.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -15,6 +16,7 @@
 #include <cstring>
 #include <unordered_set>
 #include <sys/statvfs.h>
+#include <sys/stat.h>
 #include <cstdlib>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -26,16 +28,40 @@
 
 // --- Constructor / Destructor ---
 
-SystemMetrics::SystemMetrics() {
+SystemMetrics::SystemMetrics()
+    : fast_probes_("fast", getenv_bool("LCD_DEBUG", false)),
+      slow_probes_("slow", getenv_bool("LCD_DEBUG", false)),
+      docker_(getenv_string("LCD_DOCKER_SOCKET", "/var/run/docker.sock")) {
     debug_ = getenv_bool("LCD_DEBUG", false);
     wg_active_window_s_ = getenv_int("LCD_WG_ACTIVE_SEC", wg_active_window_s_);
     net_if1_ = getenv_string("LCD_NET_IF1", net_if1_);
     net_if2_ = getenv_string("LCD_NET_IF2", net_if2_);
+    net_native_ = getenv_string("LCD_NET_BACKEND", "native") != "ethtool";
+    docker_native_ = getenv_string("LCD_DOCKER_BACKEND", "native") != "cli";
+    wg_native_ = getenv_string("LCD_WG_BACKEND", "native") != "wg";
+    wg_if_ = getenv_string("LCD_WG_IF", wg_if_);
+    wg_db_path_ = getenv_string("LCD_WG_DB", wg_db_path_);
+    std::string wan_targets = getenv_string("LCD_WAN_TARGETS", "");
+    if (!wan_targets.empty()) {
+        wan_targets_.clear();
+        std::stringstream ts(wan_targets);
+        std::string target;
+        while (std::getline(ts, target, ',')) {
+            if (!target.empty()) wan_targets_.push_back(target);
+        }
+    }
+    wan_interval_ms_ = getenv_int("LCD_WAN_INTERVAL_MS", wan_interval_ms_);
+    wan_timeout_ms_ = getenv_int("LCD_WAN_TIMEOUT_MS", wan_timeout_ms_);
+    wan_window_ = getenv_int("LCD_WAN_WINDOW", wan_window_);
+    wan_rtt_threshold_ms_ = getenv_double("LCD_WAN_RTT_MS", wan_rtt_threshold_ms_);
+    wan_loss_threshold_pct_ = getenv_double("LCD_WAN_LOSS_PCT", wan_loss_threshold_pct_);
+    wan_jitter_threshold_ms_ = getenv_double("LCD_WAN_JITTER_MS", wan_jitter_threshold_ms_);
     mc_rcon_host_ = getenv_string("LCD_MC_RCON_HOST", mc_rcon_host_);
     mc_rcon_port_ = getenv_int("LCD_MC_RCON_PORT", mc_rcon_port_);
     mc_rcon_pass_ = getenv_string("LCD_MC_RCON_PASS", mc_rcon_pass_);
     mc_rcon_timeout_ms_ = getenv_int("LCD_MC_RCON_TIMEOUT_MS", mc_rcon_timeout_ms_);
     mc_rcon_interval_ms_ = getenv_int("LCD_MC_RCON_INTERVAL_MS", mc_rcon_interval_ms_);
+    setupProbes();
 }
 
 SystemMetrics::~SystemMetrics() {
@@ -46,7 +72,8 @@ void SystemMetrics::Start() {
     if (!running_) {
         running_ = true;
         wan_worker_ = std::thread(&SystemMetrics::wan_check_worker, this);
-        metrics_worker_ = std::thread(&SystemMetrics::metrics_worker_func, this);
+        slow_probes_.Start();
+        fast_probes_.Start();
     }
 }
 
@@ -56,30 +83,19 @@ void SystemMetrics::Stop() {
         if (wan_worker_.joinable()) {
             wan_worker_.join();
         }
-        if (metrics_worker_.joinable()) {
-            metrics_worker_.join();
-        }
+        fast_probes_.Stop();
+        slow_probes_.Stop();
     }
 }
 
 // --- Public Methods ---
 
-bool SystemMetrics::Update() {
-    if (!metrics_pending_) return false;
-    std::lock_guard<std::mutex> lock(snapshot_mutex_);
-    cpu_usage = pending_snapshot_.cpu_usage;
-    mem_percent = pending_snapshot_.mem_percent;
-    mem_used_mb = pending_snapshot_.mem_used_mb;
-    temp = pending_snapshot_.temp;
-    net1_mbps = pending_snapshot_.net1_mbps;
-    net2_mbps = pending_snapshot_.net2_mbps;
-    docker_running = pending_snapshot_.docker_running;
-    disk_percent = pending_snapshot_.disk_percent;
-    wg_active_peers = pending_snapshot_.wg_active_peers;
-    uptime_seconds = pending_snapshot_.uptime_seconds;
-    mc_online = pending_snapshot_.mc_online;
-    mc_max = pending_snapshot_.mc_max;
-    metrics_pending_ = false;
+bool SystemMetrics::Poll(MetricsSnapshot& view, uint64_t& seen) const {
+    if (snapshot_.Version() == seen) return false;
+    seen = snapshot_.Load(view);
+    WanSnapshot wan;
+    wan_snapshot_.Load(wan);
+    view.wan_state = wan.state;
     return true;
 }
 
@@ -157,88 +173,38 @@ bool SystemMetrics::exec_with_timeout(const char* cmd, int timeout_sec, std::str
     return finished;
 }
 
-std::string SystemMetrics::get_wan_status() const {
-    std::lock_guard<std::mutex> lock(wan_mutex_);
-    return wan_status;
+WanStats SystemMetrics::get_wan_stats() const {
+    WanSnapshot wan;
+    wan_snapshot_.Load(wan);
+    return wan.stats;
 }
 
 // --- Metric Gathering ---
 
 double SystemMetrics::getCPUUsage() {
-    std::ifstream stat_file("/proc/stat");
-    std::string line;
-    std::getline(stat_file, line);
-    std::stringstream ss(line);
-
-    std::string cpu_label;
-    ss >> cpu_label;
-    if (cpu_label != "cpu") return 0.0;
-
-    uint64_t user, nice, system, idle, iowait, irq, softirq, steal;
-    ss >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
-
-    uint64_t current_idle = idle + iowait;
-    uint64_t current_total = user + nice + system + current_idle + irq + softirq + steal;
-
-    double usage = 0.0;
-    if (prev_cpu_total_ > 0) {
-        double total_delta = static_cast<double>(current_total - prev_cpu_total_);
-        double idle_delta = static_cast<double>(current_idle - prev_cpu_idle_);
-        if (total_delta > 0) {
-            usage = 100.0 * (1.0 - idle_delta / total_delta);
-        }
-    }
-
-    prev_cpu_total_ = current_total;
-    prev_cpu_idle_ = current_idle;
-    return usage;
+    return proc_.CpuUsage();
 }
 
 void SystemMetrics::getMemoryUsage(double& percent, int& used_mb) {
-    std::ifstream meminfo_file("/proc/meminfo");
-    std::string line;
-    uint64_t mem_total = 0, mem_available = 0;
-
-    while (std::getline(meminfo_file, line)) {
-        std::stringstream ss(line);
-        std::string key;
-        ss >> key;
-        if (key == "MemTotal:") {
-            ss >> mem_total;
-        } else if (key == "MemAvailable:") {
-            ss >> mem_available;
-        }
-    }
-
-    if (mem_total > 0) {
-        uint64_t mem_used = mem_total - mem_available;
-        percent = (static_cast<double>(mem_used) / mem_total) * 100.0;
-        used_mb = static_cast<int>(mem_used / 1024);
-    }
+    proc_.Memory(percent, used_mb);
 }
 
 double SystemMetrics::getCPUTemp() {
-    for (int i = 0; i < 5; ++i) {
-        std::string path = "/sys/class/thermal/thermal_zone" + std::to_string(i) + "/temp";
-        std::ifstream temp_file(path);
-        if (temp_file.good()) {
-            int temp_milli_c;
-            temp_file >> temp_milli_c;
-            double temp_c = static_cast<double>(temp_milli_c) / 1000.0;
-            if (temp_c > 20 && temp_c < 120) {
-                return temp_c;
-            }
-        }
-    }
-    return 0.0;
+    return proc_.CpuTemp();
 }
 
 int SystemMetrics::get_interface_link_speed(const std::string& interface_name) {
+    // ethtool(8) asks the same ioctls, so with the native backend a missing
+    // speed (link down, no such interface) is final rather than a reason to
+    // fork it and wait up to 3 s
+    if (net_native_) {
+        return net_counters_.LinkSpeedMbps(interface_name);
+    }
     std::string cmd = "ethtool " + interface_name + " 2>/dev/null | grep 'Speed:'";
     std::string output;
     if (exec_with_timeout(cmd.c_str(), 3, output)) {
         // Parse "Speed: 2500Mb/s" or "Speed: 1000Mb/s" or "Speed: Unknown!"
-        std::regex speed_regex(R"(Speed:\s*(\d+)Mb/s)");
+        static const std::regex speed_regex(R"(Speed:\s*(\d+)Mb/s)");
         std::smatch match;
         if (std::regex_search(output, match, speed_regex) && match.size() > 1) {
             try {
@@ -251,28 +217,7 @@ int SystemMetrics::get_interface_link_speed(const std::string& interface_name) {
     return -1; // Failed to detect link speed
 }
 
-void SystemMetrics::getNetworkSpeed(const std::string& interface_name, double& speed) {
-    uint64_t current_bytes = 0;
-    bool success = false;
-
-    // Initialize NetStats structure if not exists
-    if (!prev_net_stats_.count(interface_name)) {
-        prev_net_stats_[interface_name] = {0, std::chrono::steady_clock::now(), 0.0, -1, std::chrono::steady_clock::now()};
-    }
-    auto& prev = prev_net_stats_[interface_name];
-    auto now = std::chrono::steady_clock::now();
-
-    // Check link speed periodically (every 30 seconds)
-    if (prev.link_speed_mbps < 0 ||
-        std::chrono::duration<double>(now - prev.link_speed_checked).count() > 30.0) {
-        prev.link_speed_mbps = get_interface_link_speed(interface_name);
-        prev.link_speed_checked = now;
-        if (debug_ && prev.link_speed_mbps > 0) {
-            std::cerr << "[" << interface_name << "] Link speed: "
-                      << prev.link_speed_mbps << " Mbps" << std::endl;
-        }
-    }
-
+bool SystemMetrics::readCountersShell(const std::string& interface_name, uint64_t& current_bytes) {
     // Try ethtool -S first (workaround for r8125 driver bug with incorrect sysfs rx_bytes)
     std::string cmd = "ethtool -S " + interface_name + " 2>/dev/null";
     std::string output;
@@ -297,33 +242,53 @@ void SystemMetrics::getNetworkSpeed(const std::string& interface_name, double& s
 
         if (found_rx && found_tx) {
             current_bytes = rx_octets + tx_octets;
-            success = true;
             if (debug_) {
                 std::cerr << "[" << interface_name << "] ethtool: rx=" << rx_octets
                           << " tx=" << tx_octets << std::endl;
             }
+            return true;
         }
     }
 
     // Fallback to sysfs only if ethtool failed
-    if (!success) {
-        try {
-            std::ifstream rx_file("/sys/class/net/" + interface_name + "/statistics/rx_bytes");
-            std::ifstream tx_file("/sys/class/net/" + interface_name + "/statistics/tx_bytes");
-            if (rx_file.is_open() && tx_file.is_open()) {
-                uint64_t rx, tx;
-                rx_file >> rx;
-                tx_file >> tx;
-                current_bytes = rx + tx;
-                success = true;
-                if (debug_) {
-                    std::cerr << "[" << interface_name << "] sysfs fallback: rx=" << rx
-                              << " tx=" << tx << std::endl;
-                }
+    try {
+        std::ifstream rx_file("/sys/class/net/" + interface_name + "/statistics/rx_bytes");
+        std::ifstream tx_file("/sys/class/net/" + interface_name + "/statistics/tx_bytes");
+        if (rx_file.is_open() && tx_file.is_open()) {
+            uint64_t rx, tx;
+            rx_file >> rx;
+            tx_file >> tx;
+            current_bytes = rx + tx;
+            if (debug_) {
+                std::cerr << "[" << interface_name << "] sysfs fallback: rx=" << rx
+                          << " tx=" << tx << std::endl;
             }
-        } catch (...) {
-            success = false;
+            return true;
         }
+    } catch (...) {
+    }
+    return false;
+}
+
+void SystemMetrics::getNetworkSpeed(const std::string& interface_name, int link_speed_mbps, double& speed) {
+    uint64_t current_bytes = 0;
+    bool success = false;
+
+    // Initialize NetStats structure if not exists
+    if (!prev_net_stats_.count(interface_name)) {
+        prev_net_stats_[interface_name] = {0, std::chrono::steady_clock::now(), 0.0};
+    }
+    auto& prev = prev_net_stats_[interface_name];
+    auto now = std::chrono::steady_clock::now();
+
+    if (net_native_) {
+        uint64_t rx = 0, tx = 0;
+        if (net_counters_.ReadBytes(interface_name, rx, tx)) {
+            current_bytes = rx + tx;
+            success = true;
+        }
+    } else {
+        success = readCountersShell(interface_name, current_bytes);
     }
 
     if (!success) {
@@ -352,9 +317,9 @@ void SystemMetrics::getNetworkSpeed(const std::string& interface_name, double& s
 
             // Dynamic sanity check based on link speed
             double max_reasonable_speed;
-            if (prev.link_speed_mbps > 0) {
+            if (link_speed_mbps > 0) {
                 // Use 150% of link speed as limit (allows for burst traffic)
-                max_reasonable_speed = prev.link_speed_mbps * 1.5;
+                max_reasonable_speed = link_speed_mbps * 1.5;
             } else {
                 // Conservative fallback if link speed detection failed
                 max_reasonable_speed = 10000.0; // 10 Gbps
@@ -393,13 +358,18 @@ void SystemMetrics::getNetworkSpeed(const std::string& interface_name, double& s
 }
 
 int SystemMetrics::getUptime() {
-    std::ifstream uptime_file("/proc/uptime");
-    double uptime;
-    uptime_file >> uptime;
-    return static_cast<int>(uptime);
+    return proc_.Uptime();
 }
 
 int SystemMetrics::updateDockerInfo() {
+    if (docker_native_) {
+        int n = docker_.RunningContainers();
+        if (n >= 0) return n;
+    }
+    return updateDockerInfoShell();
+}
+
+int SystemMetrics::updateDockerInfoShell() {
     try {
         std::string output;
         if (!exec_with_timeout("docker ps -q 2>/dev/null", 5, output)) {
@@ -450,46 +420,88 @@ int SystemMetrics::updateDiskUsage() {
     return -1;
 }
 
+void SystemMetrics::refreshWgAllowList() {
+    // Получаем актуальный список разрешённых peer'ов из wg-easy.db
+    // чтобы отображение на дисплее совпадало с UI wg-easy.
+    // sqlite3 запускается только при изменении файла БД (или её WAL).
+    auto stamp_of = [](const std::string& path) {
+        FileStamp st;
+        struct stat sb;
+        if (stat(path.c_str(), &sb) == 0) {
+            st.mtime_ns = static_cast<long long>(sb.st_mtim.tv_sec) * 1000000000LL + sb.st_mtim.tv_nsec;
+            st.size = static_cast<long long>(sb.st_size);
+        }
+        return st;
+    };
+    FileStamp db = stamp_of(wg_db_path_);
+    FileStamp wal = stamp_of(wg_db_path_ + "-wal");
+    if (wg_db_loaded_ && db == wg_db_stamp_ && wal == wg_wal_stamp_) return;
+
+    if (db.mtime_ns < 0) {
+        wg_allowed_keys_.clear();
+    } else {
+        std::string cmd = "sqlite3 '" + wg_db_path_ +
+                          "' \"select public_key from clients_table where enabled=1;\"";
+        std::string db_out;
+        if (!exec_with_timeout(cmd.c_str(), 5, db_out)) {
+            return; // keep the previous list, retry on the next probe
+        }
+        wg_allowed_keys_.clear();
+        std::stringstream dss(db_out);
+        std::string pk;
+        while (std::getline(dss, pk)) {
+            if (!pk.empty()) wg_allowed_keys_.insert(pk);
+        }
+        if (debug_) {
+            std::cerr << "WG: allow-list reloaded, " << wg_allowed_keys_.size() << " enabled peers" << std::endl;
+        }
+    }
+    wg_db_stamp_ = db;
+    wg_wal_stamp_ = wal;
+    wg_db_loaded_ = true;
+}
+
+bool SystemMetrics::readHandshakesShell(std::vector<WireGuardNetlink::Peer>& peers) {
+    peers.clear();
+    std::string cmd = "wg show " + wg_if_ + " latest-handshakes 2>/dev/null";
+    std::string output;
+    if (!exec_with_timeout(cmd.c_str(), 5, output)) {
+        return false;
+    }
+    std::stringstream ss(output);
+    std::string line;
+    while (std::getline(ss, line)) {
+        if (line.empty()) continue;
+        std::stringstream ls(line);
+        WireGuardNetlink::Peer peer;
+        ls >> peer.public_key >> peer.last_handshake_s;
+        if (!peer.public_key.empty()) peers.push_back(std::move(peer));
+    }
+    return true;
+}
+
 int SystemMetrics::updateWireGuardPeers() {
     try {
-        // Получаем актуальный список разрешённых peer'ов из wg-easy.db
-        // чтобы отображение на дисплее совпадало с UI wg-easy.
-        std::unordered_set<std::string> enabled_pubkeys;
-        {
-            std::string db_out;
-            const char* cmd = R"(sqlite3 /etc/wireguard/wg-easy.db "select public_key from clients_table where enabled=1;")";
-            if (exec_with_timeout(cmd, 5, db_out) && !db_out.empty()) {
-                std::stringstream dss(db_out);
-                std::string pk;
-                while (std::getline(dss, pk)) {
-                    if (!pk.empty()) enabled_pubkeys.insert(pk);
-                }
-            }
-        }
+        refreshWgAllowList();
 
-        std::string output;
-        if (!exec_with_timeout("wg show wg0 latest-handshakes 2>/dev/null", 5, output)) {
-            return -1;
+        bool ok = wg_native_ && wg_netlink_.LatestHandshakes(wg_if_, wg_peers_);
+        if (wg_native_ && !ok && debug_ && !wg_native_logged_) {
+            std::cerr << "WG: netlink query failed for " << wg_if_ << ", using wg CLI" << std::endl;
+            wg_native_logged_ = true;
         }
-        if (output.empty()) {
-            return 0;
+        if (!ok && !readHandshakesShell(wg_peers_)) {
+            return -1;
         }
-        std::stringstream ss(output);
-        std::string line;
+
         int count = 0;
         auto now = std::chrono::system_clock::now();
         auto now_s = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
-        while (std::getline(ss, line)) {
-            if (line.empty()) continue;
-            std::stringstream ls(line);
-            std::string pubkey;
-            long long ts = 0;
-            ls >> pubkey >> ts;
-            if (ts <= 0) continue;
-            if (!enabled_pubkeys.empty() && enabled_pubkeys.find(pubkey) == enabled_pubkeys.end()) {
+        for (const auto& peer : wg_peers_) {
+            if (peer.last_handshake_s <= 0) continue;
+            if (!wg_allowed_keys_.empty() && wg_allowed_keys_.find(peer.public_key) == wg_allowed_keys_.end()) {
                 continue; // пропускаем peer'ов, которых нет в базе wg-easy или выключены
             }
-            if ((now_s - ts) <= wg_active_window_s_) {
+            if ((now_s - peer.last_handshake_s) <= wg_active_window_s_) {
                 count++;
             }
         }
@@ -503,11 +515,6 @@ std::pair<int, int> SystemMetrics::updateMinecraftPlayers() {
     if (mc_rcon_pass_.empty()) {
         return {-1, -1};
     }
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - mc_last_poll_).count();
-    if (elapsed < mc_rcon_interval_ms_) return {mc_cached_online_, mc_cached_max_};
-    mc_last_poll_ = now;
-
     auto read_full = [&](int fd, void* buf, size_t len, int timeout_ms) -> bool {
         size_t off = 0;
         while (off < len) {
@@ -632,32 +639,82 @@ std::pair<int, int> SystemMetrics::updateMinecraftPlayers() {
     return {mc_cached_online_, mc_cached_max_};
 }
 
-void SystemMetrics::metrics_worker_func() {
-    using namespace std::chrono_literals;
-    const int interval_ms = 100; // faster sampling for smoother sparklines
-    while (running_) {
-        MetricsSnapshot snap;
-
-        snap.cpu_usage = getCPUUsage();
-        getMemoryUsage(snap.mem_percent, snap.mem_used_mb);
-        snap.temp = getCPUTemp();
-        getNetworkSpeed(net_if1_, snap.net1_mbps);
-        getNetworkSpeed(net_if2_, snap.net2_mbps);
-        snap.uptime_seconds = getUptime();
-        snap.docker_running = updateDockerInfo();
-        snap.disk_percent = updateDiskUsage();
-        snap.wg_active_peers = updateWireGuardPeers();
-        auto mc = updateMinecraftPlayers();
-        snap.mc_online = mc.first;
-        snap.mc_max = mc.second;
-
-        {
-            std::lock_guard<std::mutex> lock(snapshot_mutex_);
-            pending_snapshot_ = snap;
-            metrics_pending_ = true;
+void SystemMetrics::setupProbes() {
+    // Fast tier: cheap reads that feed the sparklines
+    const int cpu_ms = getenv_int("LCD_PROBE_CPU_MS", 100);
+    const int net_ms = getenv_int("LCD_PROBE_NET_MS", 100);
+    const int mem_ms = getenv_int("LCD_PROBE_MEM_MS", 500);
+    const int temp_ms = getenv_int("LCD_PROBE_TEMP_MS", 1000);
+
+    fast_probes_.AddProbe("cpu", cpu_ms, 0, [this] {
+        fast_snapshot_.cpu_usage = getCPUUsage();
+        fast_snapshot_.cpu_core_usage = proc_.core_usage();
+        fast_snapshot_.cpu_core_count = proc_.core_count();
+    });
+    fast_probes_.AddProbe("net", net_ms, 0, [this] {
+        getNetworkSpeed(net_if1_, link_speed_if1_.load(std::memory_order_relaxed), fast_snapshot_.net1_mbps);
+        getNetworkSpeed(net_if2_, link_speed_if2_.load(std::memory_order_relaxed), fast_snapshot_.net2_mbps);
+    });
+    fast_probes_.AddProbe("mem", mem_ms, 0, [this] {
+        getMemoryUsage(fast_snapshot_.mem_percent, fast_snapshot_.mem_used_mb);
+    });
+    fast_probes_.AddProbe("temp", temp_ms, 0, [this] {
+        fast_snapshot_.temp = getCPUTemp();
+    });
+    fast_probes_.AddProbe("uptime", 1000, 0, [this] {
+        fast_snapshot_.uptime_seconds = getUptime();
+    });
+    fast_probes_.SetRoundCallback([this] { publishSnapshot(); });
+
+    // Slow tier: subprocesses and sockets. Deadlines match the exec timeouts.
+    const int docker_ms = getenv_int("LCD_PROBE_DOCKER_MS", 10000);
+    const int wg_ms = getenv_int("LCD_PROBE_WG_MS", 10000);
+    const int disk_ms = getenv_int("LCD_PROBE_DISK_MS", 30000);
+    const int link_ms = getenv_int("LCD_PROBE_LINK_MS", 30000);
+
+    slow_probes_.AddProbe("docker", docker_ms, 5000, [this] {
+        slow_docker_running_.store(updateDockerInfo(), std::memory_order_relaxed);
+    });
+    slow_probes_.AddProbe("wg", wg_ms, 10000, [this] {
+        slow_wg_active_peers_.store(updateWireGuardPeers(), std::memory_order_relaxed);
+    });
+    slow_probes_.AddProbe("disk", disk_ms, 1000, [this] {
+        slow_disk_percent_.store(updateDiskUsage(), std::memory_order_relaxed);
+    });
+    if (!mc_rcon_pass_.empty()) {
+        slow_probes_.AddProbe("minecraft", mc_rcon_interval_ms_, mc_rcon_timeout_ms_ * 3, [this] {
+            auto mc = updateMinecraftPlayers();
+            slow_mc_online_.store(mc.first, std::memory_order_relaxed);
+            slow_mc_max_.store(mc.second, std::memory_order_relaxed);
+        });
+    }
+    // Last, so an ethtool backend waiting on a down link does not hold up
+    // the other values of the first round
+    slow_probes_.AddProbe("link", link_ms, 6000, [this] {
+        int s1 = get_interface_link_speed(net_if1_);
+        int s2 = get_interface_link_speed(net_if2_);
+        link_speed_if1_.store(s1, std::memory_order_relaxed);
+        link_speed_if2_.store(s2, std::memory_order_relaxed);
+        if (debug_) {
+            std::cerr << "[" << net_if1_ << "] Link speed: " << s1 << " Mbps, ["
+                      << net_if2_ << "] Link speed: " << s2 << " Mbps" << std::endl;
         }
+    });
+}
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+void SystemMetrics::publishSnapshot() {
+    MetricsSnapshot snap = fast_snapshot_;
+    snap.docker_running = slow_docker_running_.load(std::memory_order_relaxed);
+    snap.disk_percent = slow_disk_percent_.load(std::memory_order_relaxed);
+    snap.wg_active_peers = slow_wg_active_peers_.load(std::memory_order_relaxed);
+    snap.mc_online = slow_mc_online_.load(std::memory_order_relaxed);
+    snap.mc_max = slow_mc_max_.load(std::memory_order_relaxed);
+
+    snapshot_.Store(snap);
+    for (int fd : wake_fds_) {
+        uint64_t one = 1;
+        ssize_t r = write(fd, &one, sizeof(one));
+        (void)r;
     }
 }
 
@@ -668,7 +725,7 @@ double SystemMetrics::ping(const std::string& host, double timeout_s) {
         std::string cmd = "ping -c 1 -W " + std::to_string((int)timeout_s) + " " + host;
         std::string output = exec(cmd.c_str());
         
-        std::regex time_regex("time=([0-9]+\\.?[0-9]*) ms");
+        static const std::regex time_regex("time=([0-9]+\\.?[0-9]*) ms");
         std::smatch match;
         if (std::regex_search(output, match, time_regex) && match.size() > 1) {
             return std::stod(match[1].str());
@@ -679,64 +736,61 @@ double SystemMetrics::ping(const std::string& host, double timeout_s) {
     }
 }
 
-void SystemMetrics::update_wan_status_from_history(const std::string& new_state) {
-    std::lock_guard<std::mutex> lock(wan_mutex_);
-    
-    wan_status_history_.push_back(new_state);
-    if (wan_status_history_.size() > wan_history_size_) {
-        wan_status_history_.pop_front();
-    }
-
-    // Stabilization: DOWN has priority
-    bool down_found = false;
-    for(const auto& state : wan_status_history_) {
-        if (state == "DOWN") {
-            down_found = true;
-            break;
-        }
-    }
-
-    if (down_found) {
-        wan_status = "DOWN";
-    } else if (wan_status_history_.size() >= 2) {
-        // Count occurrences and find the most common
-        std::map<std::string, int> counts;
-        for(const auto& state : wan_status_history_) {
-            counts[state]++;
-        }
-        
-        auto max_it = std::max_element(counts.begin(), counts.end(), 
-            [](const auto& a, const auto& b){ return a.second < b.second; });
-        
-        if (max_it != counts.end()) {
-            wan_status = max_it->first;
-        }
+void SystemMetrics::update_wan_status_from_history(const WanStats& stats) {
+    // DOWN as soon as a whole round is lost; after recovery the lost rounds
+    // stay in the window and keep the status at DEGRADED until they age out.
+    WanSnapshot wan;
+    wan.stats = stats;
+    if (!stats.route || stats.last_lost) {
+        wan.state = WanState::DOWN;
+    } else if (stats.loss_pct > wan_loss_threshold_pct_ ||
+               stats.rtt_ms > wan_rtt_threshold_ms_ ||
+               stats.jitter_ms > wan_jitter_threshold_ms_) {
+        wan.state = WanState::DEGRADED;
     } else {
-        wan_status = new_state;
+        wan.state = WanState::OK;
     }
+    wan_snapshot_.Store(wan);
 }
 
 
 void SystemMetrics::wan_check_worker() {
-    const double rtt_threshold_ms = 200.0;
-    const std::vector<std::string> targets = {"1.1.1.1", "8.8.8.8"};
+    WanProber prober(wan_targets_);
+    WanWindow window(static_cast<size_t>(std::max(1, wan_window_)));
+    if (debug_ && !prober.Available()) {
+        std::cerr << "WAN: no ICMP socket (ping_group_range/CAP_NET_RAW), using ping" << std::endl;
+    }
 
+    auto next = std::chrono::steady_clock::now();
     while (running_) {
         try {
-            std::string current_status = "DOWN";
-
-            std::string route_output = exec("ip route show default");
-            if (route_output.find("default via") != std::string::npos) {
-                 for (const auto& target : targets) {
-                    double rtt = ping(target, 2.0);
-                    if (rtt >= 0) {
-                        current_status = (rtt > rtt_threshold_ms) ? "DEGRADED" : "OK";
-                        break; // Exit on first successful ping
+            int route = prober.HasDefaultRoute();
+            if (route < 0) {
+                route = exec("ip route show default").find("default") != std::string::npos ? 1 : 0;
+            }
+
+            double rtt = -1.0;
+            if (route > 0) {
+                PROFILE_SCOPE("probe.wan");
+                if (prober.Available()) {
+                    rtt = prober.ProbeRound(wan_timeout_ms_);
+                } else {
+                    double timeout_s = std::max(1, (wan_timeout_ms_ + 999) / 1000);
+                    for (const auto& target : wan_targets_) {
+                        rtt = ping(target, timeout_s);
+                        if (rtt >= 0) break; // Exit on first successful ping
                     }
                 }
             }
-            
-            update_wan_status_from_history(current_status);
+            window.Push(rtt);
+
+            WanStats stats = window.Stats();
+            stats.route = route > 0;
+            update_wan_status_from_history(stats);
+            if (debug_) {
+                std::cerr << "WAN: route=" << stats.route << " rtt=" << stats.rtt_ms
+                          << "ms loss=" << stats.loss_pct << "% jitter=" << stats.jitter_ms << "ms" << std::endl;
+            }
         } catch (const std::exception& e) {
             if (debug_) {
                 std::cerr << "WAN worker error: " << e.what() << std::endl << std::flush;
@@ -747,7 +801,9 @@ void SystemMetrics::wan_check_worker() {
             }
         }
 
-        // Sleep for 5 seconds before the next check
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+        next += std::chrono::milliseconds(wan_interval_ms_);
+        auto now = std::chrono::steady_clock::now();
+        if (next < now) next = now;
+        std::this_thread::sleep_until(next);
     }
 }
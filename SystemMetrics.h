@@ -2,6 +2,7 @@
 #define SYSTEM_METRICS_H
 
 #include <string>
+#include <array>
 #include <vector>
 #include <chrono>
 #include <map>
@@ -10,31 +11,54 @@
 #include <atomic>
 #include <deque>
 #include <utility>
+#include <unordered_set>
+#include "ProbeScheduler.h"
+#include "NetCounters.h"
+#include "ProcReader.h"
+#include "WireGuardNetlink.h"
+#include "DockerClient.h"
+#include "WanProber.h"
+#include "Snapshot.h"
 
-class SystemMetrics {
-public:
-    SystemMetrics();
-    ~SystemMetrics();
-
-    void Start();
-    void Stop();
-
-    bool Update();
-
+// One host's metrics as a frame is drawn from them: this host's probes
+// (SystemMetrics), or a remote host's pushed over UDP (RemoteMetrics.h).
+// Trivially copyable, so it travels through a SeqLock.
+struct MetricsSnapshot {
     double cpu_usage = 0.0;
+    std::array<double, MAX_CPU_CORES> cpu_core_usage{}; // per-core %, first cpu_core_count valid
+    int cpu_core_count = 0;
     double mem_percent = 0.0;
     int mem_used_mb = 0;
     double temp = 0.0;
     double net1_mbps = 0.0;
     double net2_mbps = 0.0;
     int uptime_seconds = 0;
-    std::string wan_status = "CHECKING";
+    WanState wan_state = WanState::CHECKING;
     int docker_running = -1;
     int disk_percent = -1;
     int wg_active_peers = -1;
     int mc_online = -1;
     int mc_max = -1;
-    std::string get_wan_status() const;
+    const char* get_wan_status() const { return wan_state_name(wan_state); }
+};
+
+// Collects this host's metrics on its probe threads. Every reader keeps its
+// own MetricsSnapshot and refreshes it with Poll().
+class SystemMetrics {
+public:
+    SystemMetrics();
+    ~SystemMetrics();
+
+    void Start();
+    void Stop();
+
+    // Any thread: copies a newer snapshot than seen into view; false if none
+    bool Poll(MetricsSnapshot& view, uint64_t& seen) const;
+    // eventfd written after every published snapshot (render loop wake-up).
+    // Add them before Start(); one per render loop.
+    void AddWakeFd(int fd) { wake_fds_.push_back(fd); }
+
+    WanStats get_wan_stats() const;
 
 private:
     std::string exec(const char* cmd);
@@ -43,42 +67,58 @@ private:
     double getCPUUsage();
     void getMemoryUsage(double& percent, int& used_mb);
     double getCPUTemp();
-    void getNetworkSpeed(const std::string& interface_name, double& speed);
+    void getNetworkSpeed(const std::string& interface_name, int link_speed_mbps, double& speed);
     int getUptime();
     int updateDockerInfo();
     int updateDiskUsage();
     int updateWireGuardPeers();
+    int updateDockerInfoShell();
+    bool readHandshakesShell(std::vector<WireGuardNetlink::Peer>& peers);
+    void refreshWgAllowList();
     std::pair<int, int> updateMinecraftPlayers();
-    void metrics_worker_func();
+    void setupProbes();
+    void publishSnapshot();
     
     // WAN Monitoring
     void wan_check_worker();
-    void update_wan_status_from_history(const std::string& new_state);
+    void update_wan_status_from_history(const WanStats& stats);
     double ping(const std::string& host, double timeout_s);
 
-    // For CPU calculation
-    uint64_t prev_cpu_total_ = 0;
-    uint64_t prev_cpu_idle_ = 0;
+    // Persistent /proc and /sys readers (fast scheduler thread only)
+    ProcReader proc_;
 
     // For network speed calculation
     struct NetStats {
         uint64_t bytes;
         std::chrono::steady_clock::time_point time;
         double smoothed_speed = 0.0;
-        int link_speed_mbps = -1;
-        std::chrono::steady_clock::time_point link_speed_checked;
     };
     std::map<std::string, NetStats> prev_net_stats_;
     int get_interface_link_speed(const std::string& interface_name);
+    bool readCountersShell(const std::string& interface_name, uint64_t& current_bytes);
+    NetCounters net_counters_;
+    bool net_native_ = true; // LCD_NET_BACKEND=native|ethtool
     
+    // Link speed is refreshed on the slow scheduler, read on the fast one
+    std::atomic<int> link_speed_if1_{-1};
+    std::atomic<int> link_speed_if2_{-1};
+
     // For async WAN status
     std::thread wan_worker_;
-    std::thread metrics_worker_;
-    mutable std::mutex wan_mutex_;
     std::atomic<bool> running_{false};
-    std::atomic<bool> metrics_pending_{false};
-    std::deque<std::string> wan_status_history_;
-    const size_t wan_history_size_ = 3;
+    std::vector<int> wake_fds_;
+    struct WanSnapshot {
+        WanStats stats;
+        WanState state = WanState::CHECKING;
+    };
+    SeqLock<WanSnapshot> wan_snapshot_;
+    std::vector<std::string> wan_targets_ = {"1.1.1.1", "8.8.8.8"};
+    int wan_interval_ms_ = 2000;
+    int wan_timeout_ms_ = 1500;
+    int wan_window_ = 10;
+    double wan_rtt_threshold_ms_ = 200.0;
+    double wan_loss_threshold_pct_ = 20.0;
+    double wan_jitter_threshold_ms_ = 50.0;
 
     bool debug_ = false;
     int wg_active_window_s_ = 120;
@@ -89,26 +129,43 @@ private:
     int mc_rcon_port_ = 25575;
     int mc_rcon_timeout_ms_ = 1500;
     int mc_rcon_interval_ms_ = 2000;
-    std::chrono::steady_clock::time_point mc_last_poll_ = std::chrono::steady_clock::now();
     int mc_cached_online_ = -1;
     int mc_cached_max_ = -1;
 
-    struct MetricsSnapshot {
-        double cpu_usage = 0;
-        double mem_percent = 0;
-        int mem_used_mb = 0;
-        double temp = 0;
-        double net1_mbps = 0;
-        double net2_mbps = 0;
-        int docker_running = -1;
-        int disk_percent = -1;
-        int wg_active_peers = -1;
-        int uptime_seconds = 0;
-        int mc_online = -1;
-        int mc_max = -1;
+    // Published by the fast scheduler thread (WAN state not filled in: that
+    // comes from wan_snapshot_), read by Poll() on the render threads
+    SeqLock<MetricsSnapshot> snapshot_;
+
+    // Tiered collection: cheap /proc and counter reads on the fast scheduler,
+    // anything that forks or talks to a daemon on the slow one.
+    ProbeScheduler fast_probes_;
+    ProbeScheduler slow_probes_;
+    MetricsSnapshot fast_snapshot_; // owned by the fast scheduler thread
+    std::atomic<int> slow_docker_running_{-1};
+    std::atomic<int> slow_disk_percent_{-1};
+    std::atomic<int> slow_wg_active_peers_{-1};
+    std::atomic<int> slow_mc_online_{-1};
+    std::atomic<int> slow_mc_max_{-1};
+
+    // Slow-thread state for the native Docker/WireGuard probes
+    DockerClient docker_;
+    bool docker_native_ = true; // LCD_DOCKER_BACKEND=native|cli
+    WireGuardNetlink wg_netlink_;
+    bool wg_native_ = true; // LCD_WG_BACKEND=native|wg
+    bool wg_native_logged_ = false;
+    std::string wg_if_ = "wg0";
+    std::string wg_db_path_ = "/etc/wireguard/wg-easy.db";
+    std::vector<WireGuardNetlink::Peer> wg_peers_;
+    // wg-easy allow-list, re-read only when the DB or its WAL changes
+    std::unordered_set<std::string> wg_allowed_keys_;
+    struct FileStamp {
+        long long mtime_ns = -1;
+        long long size = -1;
+        bool operator==(const FileStamp& o) const { return mtime_ns == o.mtime_ns && size == o.size; }
     };
-    MetricsSnapshot pending_snapshot_;
-    std::mutex snapshot_mutex_;
+    FileStamp wg_db_stamp_;
+    FileStamp wg_wal_stamp_;
+    bool wg_db_loaded_ = false;
 };
 
 #endif // SYSTEM_METRICS_H
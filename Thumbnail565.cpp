@@ -0,0 +1,121 @@
+#include "Thumbnail565.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Source taps of one output sample along one axis
+struct Taps {
+    int first = 0;
+    std::vector<float> weights;
+};
+
+std::vector<Taps> make_taps(int n_src, int n_dst) {
+    std::vector<Taps> taps(static_cast<size_t>(n_dst));
+    const double scale = static_cast<double>(n_src) / n_dst;
+    for (int i = 0; i < n_dst; ++i) {
+        Taps& t = taps[static_cast<size_t>(i)];
+        if (n_dst <= n_src) {
+            // Area average over [s0, s1)
+            double s0 = i * scale;
+            double s1 = (i + 1) * scale;
+            int j0 = static_cast<int>(std::floor(s0));
+            int j1 = std::min(n_src, static_cast<int>(std::ceil(s1)));
+            t.first = j0;
+            double sum = 0.0;
+            for (int j = j0; j < j1; ++j) {
+                double wgt = std::min(s1, j + 1.0) - std::max(s0, static_cast<double>(j));
+                t.weights.push_back(static_cast<float>(wgt));
+                sum += wgt;
+            }
+            for (float& wgt : t.weights) wgt = static_cast<float>(wgt / sum);
+        } else {
+            // Bilinear between the two nearest source centres
+            double c = (i + 0.5) * scale - 0.5;
+            int j0 = static_cast<int>(std::floor(c));
+            float f = static_cast<float>(c - j0);
+            if (j0 < 0) {
+                j0 = 0;
+                f = 0.0f;
+            }
+            if (j0 >= n_src - 1) {
+                j0 = n_src - 1;
+                f = 0.0f;
+            }
+            t.first = j0;
+            t.weights.push_back(1.0f - f);
+            if (f > 0.0f) t.weights.push_back(f);
+        }
+    }
+    return taps;
+}
+}
+
+std::shared_ptr<const Thumbnail565> Thumbnail565::FromRGBA(const uint8_t* rgba, int iw, int ih,
+                                                           int box_w, int box_h) {
+    if (!rgba || iw <= 0 || ih <= 0 || box_w <= 0 || box_h <= 0) return nullptr;
+    double scale = std::min(static_cast<double>(box_w) / iw, static_cast<double>(box_h) / ih);
+    const int dw = std::max(1, std::min(box_w, static_cast<int>(std::round(iw * scale))));
+    const int dh = std::max(1, std::min(box_h, static_cast<int>(std::round(ih * scale))));
+
+    // Horizontal pass into premultiplied float rows
+    const std::vector<Taps> tx = make_taps(iw, dw);
+    std::vector<float> tmp(static_cast<size_t>(dw) * ih * 4);
+    for (int y = 0; y < ih; ++y) {
+        const uint8_t* src = rgba + static_cast<size_t>(y) * iw * 4;
+        float* out = &tmp[static_cast<size_t>(y) * dw * 4];
+        for (int x = 0; x < dw; ++x) {
+            const Taps& t = tx[static_cast<size_t>(x)];
+            float r = 0, g = 0, b = 0, a = 0;
+            for (size_t k = 0; k < t.weights.size(); ++k) {
+                const uint8_t* p = src + static_cast<size_t>(t.first + static_cast<int>(k)) * 4;
+                float wa = t.weights[k] * p[3];
+                r += wa * p[0];
+                g += wa * p[1];
+                b += wa * p[2];
+                a += wa;
+            }
+            out[x * 4 + 0] = r;
+            out[x * 4 + 1] = g;
+            out[x * 4 + 2] = b;
+            out[x * 4 + 3] = a;
+        }
+    }
+
+    // Vertical pass, un-premultiply, pack
+    auto thumb = std::make_shared<Thumbnail565>();
+    thumb->w = dw;
+    thumb->h = dh;
+    thumb->pixels.resize(static_cast<size_t>(dw) * dh);
+    std::vector<uint8_t> alpha((static_cast<size_t>(dw) * dh + 1) / 2, 0);
+    bool opaque = true;
+    const std::vector<Taps> ty = make_taps(ih, dh);
+    for (int y = 0; y < dh; ++y) {
+        const Taps& t = ty[static_cast<size_t>(y)];
+        for (int x = 0; x < dw; ++x) {
+            float r = 0, g = 0, b = 0, a = 0;
+            for (size_t k = 0; k < t.weights.size(); ++k) {
+                const float* p = &tmp[(static_cast<size_t>(t.first + static_cast<int>(k)) * dw + x) * 4];
+                r += t.weights[k] * p[0];
+                g += t.weights[k] * p[1];
+                b += t.weights[k] * p[2];
+                a += t.weights[k] * p[3];
+            }
+            uint16_t px = 0;
+            if (a > 0.0f) {
+                int r8 = std::min(255, static_cast<int>(r / a + 0.5f));
+                int g8 = std::min(255, static_cast<int>(g / a + 0.5f));
+                int b8 = std::min(255, static_cast<int>(b / a + 0.5f));
+                px = static_cast<uint16_t>(((r8 * 31 + 127) / 255) << 11 |
+                                           ((g8 * 63 + 127) / 255) << 5 |
+                                           ((b8 * 31 + 127) / 255));
+            }
+            size_t i = static_cast<size_t>(y) * dw + x;
+            thumb->pixels[i] = px;
+            int q = std::min(15, static_cast<int>(a * 15.0f / 255.0f + 0.5f));
+            if (q != 15) opaque = false;
+            alpha[i >> 1] |= static_cast<uint8_t>(q << ((i & 1) * 4));
+        }
+    }
+    if (!opaque) thumb->alpha.swap(alpha);
+    return thumb;
+}
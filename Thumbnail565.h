@@ -0,0 +1,28 @@
+#ifndef THUMBNAIL565_H
+#define THUMBNAIL565_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Print preview already scaled to its box and converted to RGB565, built
+// once per thumbnail so drawing is a row copy (or a masked blend where the
+// source had transparency). Downscaling averages the covered source area,
+// upscaling is bilinear; both in premultiplied alpha so transparent pixels
+// do not bleed dark fringes.
+struct Thumbnail565 {
+    int w = 0;
+    int h = 0;
+    std::vector<uint16_t> pixels; // RGB565, row-major
+    std::vector<uint8_t> alpha;   // 4-bit coverage, two pixels per byte (low nibble first); empty = opaque
+
+    // 0..15
+    int Alpha(size_t i) const { return alpha.empty() ? 15 : (alpha[i >> 1] >> ((i & 1) * 4)) & 0x0F; }
+
+    // Fits rgba (iw x ih, 8-bit RGBA) into box_w x box_h keeping the aspect ratio.
+    // Returns nullptr for an empty image.
+    static std::shared_ptr<const Thumbnail565> FromRGBA(const uint8_t* rgba, int iw, int ih,
+                                                        int box_w, int box_h);
+};
+
+#endif // THUMBNAIL565_H
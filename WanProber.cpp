@@ -0,0 +1,244 @@
+#include "WanProber.h"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+namespace {
+constexpr size_t NL_BUF_SIZE = 32768;
+constexpr int MAX_DUMP_RECVS = 64;
+constexpr size_t ECHO_PAYLOAD = 16;
+
+uint16_t inet_checksum(const uint8_t* data, size_t len) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += static_cast<uint32_t>(data[i] << 8 | data[i + 1]);
+    }
+    if (len & 1) sum += static_cast<uint32_t>(data[len - 1] << 8);
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return htons(static_cast<uint16_t>(~sum));
+}
+}
+
+// --- WanWindow ---
+
+void WanWindow::Push(double rtt_ms) {
+    rounds_.push_back(rtt_ms);
+    if (rounds_.size() > size_) {
+        rounds_.pop_front();
+    }
+}
+
+WanStats WanWindow::Stats() const {
+    WanStats st;
+    st.samples = static_cast<int>(rounds_.size());
+    if (rounds_.empty()) return st;
+
+    st.last_lost = rounds_.back() < 0;
+    int lost = 0, answered = 0, pairs = 0;
+    double rtt_sum = 0.0, jitter_sum = 0.0;
+    double prev = -1.0;
+    for (double r : rounds_) {
+        if (r < 0) {
+            lost++;
+            prev = -1.0;
+            continue;
+        }
+        answered++;
+        rtt_sum += r;
+        if (prev >= 0) {
+            jitter_sum += (r > prev) ? (r - prev) : (prev - r);
+            pairs++;
+        }
+        prev = r;
+    }
+    st.loss_pct = 100.0 * lost / static_cast<double>(rounds_.size());
+    st.rtt_ms = answered ? rtt_sum / answered : -1.0;
+    st.jitter_ms = pairs ? jitter_sum / pairs : 0.0;
+    return st;
+}
+
+// --- WanProber ---
+
+WanProber::WanProber(const std::vector<std::string>& targets) {
+    ident_ = static_cast<uint16_t>(getpid() & 0xFFFF);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ >= 0 && !openSockets(targets)) {
+        for (auto& t : targets_) {
+            if (t.fd >= 0) close(t.fd);
+        }
+        targets_.clear();
+    }
+
+    nl_fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (nl_fd_ >= 0) {
+        sockaddr_nl local{};
+        local.nl_family = AF_NETLINK;
+        if (bind(nl_fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+            close(nl_fd_);
+            nl_fd_ = -1;
+        } else {
+            timeval tv{0, 500000};
+            setsockopt(nl_fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        }
+    }
+    nl_buf_.resize(NL_BUF_SIZE);
+}
+
+WanProber::~WanProber() {
+    for (auto& t : targets_) {
+        if (t.fd >= 0) close(t.fd);
+    }
+    if (epoll_fd_ >= 0) close(epoll_fd_);
+    if (nl_fd_ >= 0) close(nl_fd_);
+}
+
+bool WanProber::openSockets(const std::vector<std::string>& targets) {
+    for (const auto& host : targets) {
+        Target t;
+        t.addr.sin_family = AF_INET;
+        if (inet_pton(AF_INET, host.c_str(), &t.addr.sin_addr) != 1) continue;
+
+        int type = raw_ ? SOCK_RAW : SOCK_DGRAM;
+        t.fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+        if (t.fd < 0 && !raw_ && targets_.empty()) {
+            // ping_group_range excludes us; root can still use a raw socket
+            raw_ = true;
+            t.fd = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+        }
+        if (t.fd < 0) return false;
+        if (connect(t.fd, reinterpret_cast<sockaddr*>(&t.addr), sizeof(t.addr)) != 0) {
+            close(t.fd);
+            continue;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(targets_.size());
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, t.fd, &ev) != 0) {
+            close(t.fd);
+            return false;
+        }
+        targets_.push_back(t);
+    }
+    return !targets_.empty();
+}
+
+bool WanProber::parseReply(const uint8_t* buf, ssize_t len, const Target& t) const {
+    if (raw_) {
+        // Raw sockets see every ICMP packet for the host, IP header included
+        if (len < static_cast<ssize_t>(sizeof(iphdr))) return false;
+        const auto* ip = reinterpret_cast<const iphdr*>(buf);
+        size_t ihl = static_cast<size_t>(ip->ihl) * 4;
+        if (ip->saddr != t.addr.sin_addr.s_addr || len < static_cast<ssize_t>(ihl + sizeof(icmphdr))) {
+            return false;
+        }
+        const auto* icmp = reinterpret_cast<const icmphdr*>(buf + ihl);
+        return icmp->type == ICMP_ECHOREPLY && icmp->un.echo.id == htons(ident_) &&
+               icmp->un.echo.sequence == htons(seq_);
+    }
+    // Datagram ICMP sockets deliver only our own replies, without the IP header
+    if (len < static_cast<ssize_t>(sizeof(icmphdr))) return false;
+    const auto* icmp = reinterpret_cast<const icmphdr*>(buf);
+    return icmp->type == ICMP_ECHOREPLY && icmp->un.echo.sequence == htons(seq_);
+}
+
+double WanProber::ProbeRound(int timeout_ms) {
+    if (targets_.empty()) return -1.0;
+
+    uint8_t buf[512];
+    ++seq_;
+    int outstanding = 0;
+    for (auto& t : targets_) {
+        // Drop late replies from the previous round
+        while (recv(t.fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {}
+
+        uint8_t pkt[sizeof(icmphdr) + ECHO_PAYLOAD];
+        std::memset(pkt, 0, sizeof(pkt));
+        auto* icmp = reinterpret_cast<icmphdr*>(pkt);
+        icmp->type = ICMP_ECHO;
+        icmp->un.echo.id = htons(ident_); // rewritten by the kernel on dgram sockets
+        icmp->un.echo.sequence = htons(seq_);
+        if (raw_) icmp->checksum = inet_checksum(pkt, sizeof(pkt));
+
+        t.sent = std::chrono::steady_clock::now();
+        t.pending = send(t.fd, pkt, sizeof(pkt), 0) == static_cast<ssize_t>(sizeof(pkt));
+        if (t.pending) outstanding++;
+    }
+
+    double best = -1.0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    epoll_event events[8];
+    while (outstanding > 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) break;
+        int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+        int n = epoll_wait(epoll_fd_, events, 8, wait_ms);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        auto recv_time = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) {
+            uint32_t idx = events[i].data.u32;
+            if (idx >= targets_.size()) continue;
+            Target& t = targets_[idx];
+            ssize_t r;
+            while ((r = recv(t.fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+                if (!t.pending || !parseReply(buf, r, t)) continue;
+                t.pending = false;
+                outstanding--;
+                double rtt = std::chrono::duration<double, std::milli>(recv_time - t.sent).count();
+                if (best < 0 || rtt < best) best = rtt;
+            }
+        }
+    }
+    return best;
+}
+
+int WanProber::HasDefaultRoute() {
+    if (nl_fd_ < 0) return -1;
+
+    struct {
+        nlmsghdr nh;
+        rtmsg rt;
+    } req;
+    std::memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(rtmsg));
+    req.nh.nlmsg_type = RTM_GETROUTE;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq = ++nl_seq_;
+    req.rt.rtm_family = AF_INET;
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(nl_fd_, &req, req.nh.nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+        return -1;
+    }
+
+    // Read the whole dump so the next query starts on an empty socket
+    bool found = false;
+    for (int attempt = 0; attempt < MAX_DUMP_RECVS; ++attempt) {
+        ssize_t r = recv(nl_fd_, nl_buf_.data(), nl_buf_.size(), 0);
+        if (r <= 0) return -1;
+        int len = static_cast<int>(r);
+        for (auto* nh = reinterpret_cast<nlmsghdr*>(nl_buf_.data());
+             NLMSG_OK(nh, len);
+             nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_seq != nl_seq_) continue;
+            if (nh->nlmsg_type == NLMSG_DONE) return found ? 1 : 0;
+            if (nh->nlmsg_type == NLMSG_ERROR) return -1;
+            if (nh->nlmsg_type != RTM_NEWROUTE) continue;
+            const auto* rt = static_cast<const rtmsg*>(NLMSG_DATA(nh));
+            if (rt->rtm_dst_len == 0 && rt->rtm_table == RT_TABLE_MAIN && rt->rtm_type == RTN_UNICAST) {
+                found = true;
+            }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,95 @@
+#ifndef WAN_PROBER_H
+#define WAN_PROBER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <chrono>
+#include <sys/types.h>
+#include <netinet/in.h>
+
+// Rolling WAN quality figures over the last N probe rounds.
+struct WanStats {
+    bool route = false;     // default route present
+    bool last_lost = true;  // most recent round got no reply from any target
+    double loss_pct = 100.0;
+    double rtt_ms = -1.0;   // mean RTT of answered rounds, -1 if none
+    double jitter_ms = 0.0; // mean |RTT[i] - RTT[i-1]| over consecutive answered rounds
+    int samples = 0;
+};
+
+enum class WanState : uint8_t { CHECKING, OK, DEGRADED, DOWN };
+
+inline const char* wan_state_name(WanState s) {
+    switch (s) {
+        case WanState::OK: return "OK";
+        case WanState::DEGRADED: return "DEGRADED";
+        case WanState::DOWN: return "DOWN";
+        default: return "CHECKING";
+    }
+}
+
+// A round is lost only when every target stays silent, so one filtered
+// resolver does not read as packet loss.
+class WanWindow {
+public:
+    explicit WanWindow(size_t size) : size_(size ? size : 1) {}
+
+    void Push(double rtt_ms); // rtt_ms < 0 = lost
+    void Clear() { rounds_.clear(); }
+    WanStats Stats() const;
+
+private:
+    size_t size_;
+    std::deque<double> rounds_;
+};
+
+// ICMP echo prober for a fixed set of IPv4 targets.
+//
+// Uses unprivileged SOCK_DGRAM ICMP sockets (net.ipv4.ping_group_range),
+// falling back to SOCK_RAW when running with CAP_NET_RAW. All targets are
+// pinged at once and the replies are collected from one epoll wait, so a
+// dead target costs nothing as long as another one answers. The default
+// route is read from a persistent NETLINK_ROUTE socket.
+class WanProber {
+public:
+    explicit WanProber(const std::vector<std::string>& targets);
+    ~WanProber();
+
+    WanProber(const WanProber&) = delete;
+    WanProber& operator=(const WanProber&) = delete;
+
+    // False if no ICMP socket could be opened (no ping group, no CAP_NET_RAW)
+    // or no target parsed as an IPv4 address.
+    bool Available() const { return !targets_.empty(); }
+
+    // One ping to every target. Returns the best RTT in ms, -1 if none
+    // answered within timeout_ms.
+    double ProbeRound(int timeout_ms);
+
+    // 1 = default route present, 0 = none, -1 = netlink query failed.
+    int HasDefaultRoute();
+
+private:
+    struct Target {
+        sockaddr_in addr{};
+        int fd = -1;
+        bool pending = false;
+        std::chrono::steady_clock::time_point sent;
+    };
+
+    bool openSockets(const std::vector<std::string>& targets);
+    bool parseReply(const uint8_t* buf, ssize_t len, const Target& t) const;
+
+    std::vector<Target> targets_;
+    bool raw_ = false;
+    uint16_t ident_ = 0; // echo id for raw sockets (dgram sockets get one from the kernel)
+    uint16_t seq_ = 0;
+    int epoll_fd_ = -1;
+    int nl_fd_ = -1;
+    uint32_t nl_seq_ = 0;
+    std::vector<uint8_t> nl_buf_;
+};
+
+#endif // WAN_PROBER_H
@@ -0,0 +1,284 @@
+#include "WebSocketClient.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint8_t OP_CONT = 0x0;
+constexpr uint8_t OP_TEXT = 0x1;
+constexpr uint8_t OP_BINARY = 0x2;
+constexpr uint8_t OP_CLOSE = 0x8;
+constexpr uint8_t OP_PING = 0x9;
+constexpr uint8_t OP_PONG = 0xA;
+constexpr size_t MAX_MESSAGE = 4 * 1024 * 1024;
+
+std::string base64(const uint8_t* data, size_t len) {
+    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < len) v |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out += tbl[(v >> 18) & 63];
+        out += tbl[(v >> 12) & 63];
+        out += (i + 1 < len) ? tbl[(v >> 6) & 63] : '=';
+        out += (i + 2 < len) ? tbl[v & 63] : '=';
+    }
+    return out;
+}
+
+int remaining_ms(std::chrono::steady_clock::time_point deadline) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<long long>(0, left.count()));
+}
+}
+
+WebSocketClient::~WebSocketClient() {
+    Close();
+}
+
+void WebSocketClient::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    buf_.clear();
+    partial_.clear();
+}
+
+bool WebSocketClient::Connect(const std::string& host, int port, const std::string& path, int timeout_ms) {
+    Close();
+    timeout_ms_ = timeout_ms;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) return false;
+    for (addrinfo* ai = res; ai && fd_ < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, ai->ai_protocol);
+        if (fd < 0) continue;
+        int r = connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (r != 0 && errno == EINPROGRESS) {
+            pollfd pfd{fd, POLLOUT, 0};
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (poll(&pfd, 1, remaining_ms(deadline)) == 1 &&
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+                r = 0;
+            }
+        }
+        if (r == 0) {
+            fd_ = fd;
+        } else {
+            close(fd);
+        }
+    }
+    freeaddrinfo(res);
+    if (fd_ < 0) return false;
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd_, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+
+    uint8_t nonce[16];
+    for (auto& b : nonce) {
+        mask_seed_ = mask_seed_ * 1664525u + 1013904223u + static_cast<uint32_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+        b = static_cast<uint8_t>(mask_seed_ >> 24);
+    }
+    std::string req = "GET " + path + " HTTP/1.1\r\n"
+                      "Host: " + host + ":" + std::to_string(port) + "\r\n"
+                      "Upgrade: websocket\r\n"
+                      "Connection: Upgrade\r\n"
+                      "Sec-WebSocket-Key: " + base64(nonce, sizeof(nonce)) + "\r\n"
+                      "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (!sendAll(reinterpret_cast<const uint8_t*>(req.data()), req.size())) {
+        Close();
+        return false;
+    }
+
+    // Status line and headers; frames may follow in the same read
+    for (;;) {
+        auto end = std::search(buf_.begin(), buf_.end(), "\r\n\r\n", "\r\n\r\n" + 4);
+        if (end != buf_.end()) {
+            std::string head(buf_.begin(), end);
+            buf_.erase(buf_.begin(), end + 4);
+            if (head.compare(0, 12, "HTTP/1.1 101") != 0) {
+                Close();
+                return false;
+            }
+            return true;
+        }
+        if (buf_.size() > 16384 || !fill(remaining_ms(deadline))) {
+            Close();
+            return false;
+        }
+    }
+}
+
+bool WebSocketClient::sendAll(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd_, data, len, MSG_NOSIGNAL);
+        if (n > 0) {
+            data += n;
+            len -= static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd pfd{fd_, POLLOUT, 0};
+            if (poll(&pfd, 1, timeout_ms_) == 1) continue;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketClient::sendFrame(uint8_t opcode, const uint8_t* data, size_t len) {
+    if (fd_ < 0) return false;
+    std::vector<uint8_t> frame;
+    frame.reserve(len + 14);
+    frame.push_back(static_cast<uint8_t>(0x80 | opcode));
+    if (len < 126) {
+        frame.push_back(static_cast<uint8_t>(0x80 | len));
+    } else if (len <= 0xFFFF) {
+        frame.push_back(0x80 | 126);
+        frame.push_back(static_cast<uint8_t>(len >> 8));
+        frame.push_back(static_cast<uint8_t>(len));
+    } else {
+        frame.push_back(0x80 | 127);
+        for (int i = 7; i >= 0; --i) frame.push_back(static_cast<uint8_t>(static_cast<uint64_t>(len) >> (i * 8)));
+    }
+    // Client frames must be masked; the key only has to be unpredictable to proxies
+    mask_seed_ = mask_seed_ * 1664525u + 1013904223u;
+    uint8_t mask[4] = {static_cast<uint8_t>(mask_seed_ >> 24), static_cast<uint8_t>(mask_seed_ >> 16),
+                       static_cast<uint8_t>(mask_seed_ >> 8), static_cast<uint8_t>(mask_seed_)};
+    frame.insert(frame.end(), mask, mask + 4);
+    for (size_t i = 0; i < len; ++i) frame.push_back(data[i] ^ mask[i & 3]);
+    return sendAll(frame.data(), frame.size());
+}
+
+bool WebSocketClient::SendText(const std::string& text) {
+    return sendFrame(OP_TEXT, reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+bool WebSocketClient::fill(int timeout_ms) {
+    timed_out_ = false;
+    pollfd pfd{fd_, POLLIN, 0};
+    int r = poll(&pfd, 1, timeout_ms);
+    if (r == 0) {
+        timed_out_ = true;
+        return false;
+    }
+    if (r < 0) {
+        if (errno == EINTR) {
+            timed_out_ = true;
+            return false;
+        }
+        return false;
+    }
+    uint8_t tmp[8192];
+    ssize_t n = recv(fd_, tmp, sizeof(tmp), 0);
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            timed_out_ = true;
+        }
+        return false;
+    }
+    buf_.insert(buf_.end(), tmp, tmp + n);
+    return true;
+}
+
+bool WebSocketClient::parseFrame(uint8_t& opcode, bool& fin, std::string& payload) {
+    if (buf_.size() < 2) return false;
+    fin = (buf_[0] & 0x80) != 0;
+    opcode = buf_[0] & 0x0F;
+    bool masked = (buf_[1] & 0x80) != 0;
+    uint64_t len = buf_[1] & 0x7F;
+    size_t pos = 2;
+    if (len == 126) {
+        if (buf_.size() < 4) return false;
+        len = (uint64_t(buf_[2]) << 8) | buf_[3];
+        pos = 4;
+    } else if (len == 127) {
+        if (buf_.size() < 10) return false;
+        len = 0;
+        for (int i = 0; i < 8; ++i) len = (len << 8) | buf_[2 + i];
+        pos = 10;
+    }
+    uint8_t mask[4] = {0, 0, 0, 0};
+    if (masked) {
+        if (buf_.size() < pos + 4) return false;
+        std::memcpy(mask, &buf_[pos], 4);
+        pos += 4;
+    }
+    if (len > MAX_MESSAGE || buf_.size() < pos + len) return false;
+    payload.assign(reinterpret_cast<const char*>(&buf_[pos]), static_cast<size_t>(len));
+    if (masked) {
+        for (size_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<char>(payload[i] ^ mask[i & 3]);
+    }
+    buf_.erase(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(pos + len));
+    return true;
+}
+
+int WebSocketClient::Recv(std::string& msg, int timeout_ms) {
+    if (fd_ < 0) return -1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::string payload;
+    for (;;) {
+        uint8_t opcode = 0;
+        bool fin = false;
+        while (parseFrame(opcode, fin, payload)) {
+            switch (opcode) {
+                case OP_PING:
+                    if (!sendFrame(OP_PONG, reinterpret_cast<const uint8_t*>(payload.data()), payload.size())) {
+                        Close();
+                        return -1;
+                    }
+                    break;
+                case OP_PONG:
+                    break;
+                case OP_CLOSE:
+                    sendFrame(OP_CLOSE, nullptr, 0);
+                    Close();
+                    return -1;
+                case OP_TEXT:
+                case OP_BINARY:
+                case OP_CONT:
+                    partial_ += payload;
+                    if (partial_.size() > MAX_MESSAGE) {
+                        Close();
+                        return -1;
+                    }
+                    if (fin) {
+                        msg.swap(partial_);
+                        partial_.clear();
+                        return 1;
+                    }
+                    break;
+                default:
+                    Close();
+                    return -1;
+            }
+        }
+        if (buf_.size() > MAX_MESSAGE + 14) {
+            Close();
+            return -1;
+        }
+        if (!fill(remaining_ms(deadline))) {
+            if (timed_out_) return 0;
+            Close();
+            return -1;
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef WEBSOCKET_CLIENT_H
+#define WEBSOCKET_CLIENT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal RFC 6455 client for text messages over plain TCP (ws://), enough
+// for Moonraker's JSON-RPC socket. Answers pings, reassembles fragmented
+// messages, masks outgoing frames. No TLS and no extensions.
+// Not thread-safe: one thread owns the connection.
+class WebSocketClient {
+public:
+    WebSocketClient() = default;
+    ~WebSocketClient();
+
+    WebSocketClient(const WebSocketClient&) = delete;
+    WebSocketClient& operator=(const WebSocketClient&) = delete;
+
+    // Connects and performs the HTTP upgrade. False on any failure.
+    bool Connect(const std::string& host, int port, const std::string& path, int timeout_ms);
+    void Close();
+    bool IsOpen() const { return fd_ >= 0; }
+
+    bool SendText(const std::string& text);
+
+    // 1 = a complete text message is in msg, 0 = timeout, -1 = connection closed or broken.
+    int Recv(std::string& msg, int timeout_ms);
+
+private:
+    bool sendFrame(uint8_t opcode, const uint8_t* data, size_t len);
+    bool sendAll(const uint8_t* data, size_t len);
+    bool fill(int timeout_ms); // read more into buf_; false on EOF/error/timeout
+    bool parseFrame(uint8_t& opcode, bool& fin, std::string& payload); // from buf_, false if incomplete
+
+    int fd_ = -1;
+    int timeout_ms_ = 0;
+    bool timed_out_ = false;
+    std::vector<uint8_t> buf_;
+    std::string partial_; // fragments of the message being reassembled
+    uint32_t mask_seed_ = 0x9E3779B9u;
+};
+
+#endif // WEBSOCKET_CLIENT_H
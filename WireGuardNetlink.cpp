@@ -0,0 +1,196 @@
+#include "WireGuardNetlink.h"
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+#include <linux/wireguard.h>
+
+namespace {
+constexpr size_t NL_BUF_SIZE = 65536;
+constexpr int MAX_DUMP_RECVS = 64;
+
+std::string base64_encode(const uint8_t* data, size_t len) {
+    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve(((len + 2) / 3) * 4);
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t v = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+        out += tbl[(v >> 18) & 63];
+        out += tbl[(v >> 12) & 63];
+        out += tbl[(v >> 6) & 63];
+        out += tbl[v & 63];
+    }
+    if (i < len) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < len) v |= uint32_t(data[i + 1]) << 8;
+        out += tbl[(v >> 18) & 63];
+        out += tbl[(v >> 12) & 63];
+        out += (i + 1 < len) ? tbl[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+// Walks a run of netlink attributes; fn(type, payload, payload_len).
+template <typename F>
+void for_each_attr(const uint8_t* data, int len, F&& fn) {
+    while (len >= static_cast<int>(NLA_HDRLEN)) {
+        const auto* nla = reinterpret_cast<const nlattr*>(data);
+        if (nla->nla_len < NLA_HDRLEN || nla->nla_len > len) return;
+        fn(static_cast<uint16_t>(nla->nla_type & NLA_TYPE_MASK),
+           data + NLA_HDRLEN, static_cast<int>(nla->nla_len - NLA_HDRLEN));
+        int step = static_cast<int>(NLA_ALIGN(nla->nla_len));
+        data += step;
+        len -= step;
+    }
+}
+
+const uint8_t* genl_attrs(const nlmsghdr* nh, int& len) {
+    len = static_cast<int>(nh->nlmsg_len) - static_cast<int>(NLMSG_LENGTH(GENL_HDRLEN));
+    return reinterpret_cast<const uint8_t*>(NLMSG_DATA(nh)) + GENL_HDRLEN;
+}
+}
+
+WireGuardNetlink::WireGuardNetlink() {
+    buf_.resize(NL_BUF_SIZE);
+}
+
+WireGuardNetlink::~WireGuardNetlink() {
+    if (fd_ >= 0) close(fd_);
+}
+
+bool WireGuardNetlink::openSocket() {
+    if (fd_ >= 0) return true;
+    fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (fd_ < 0) return false;
+    sockaddr_nl local{};
+    local.nl_family = AF_NETLINK;
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    timeval tv{0, 500000};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return true;
+}
+
+bool WireGuardNetlink::sendRequest(uint16_t type, uint16_t flags, uint8_t cmd, uint8_t version,
+                                   uint16_t attr_type, const std::string& attr_str) {
+    // nlmsghdr | genlmsghdr | nlattr(string, NUL-terminated)
+    uint8_t req[NLMSG_HDRLEN + GENL_HDRLEN + NLA_HDRLEN + 64];
+    const size_t str_len = attr_str.size() + 1;
+    if (NLA_ALIGN(str_len) > 64) return false;
+    std::memset(req, 0, sizeof(req));
+
+    auto* nh = reinterpret_cast<nlmsghdr*>(req);
+    auto* gh = reinterpret_cast<genlmsghdr*>(req + NLMSG_HDRLEN);
+    auto* nla = reinterpret_cast<nlattr*>(req + NLMSG_HDRLEN + GENL_HDRLEN);
+    nla->nla_type = attr_type;
+    nla->nla_len = static_cast<uint16_t>(NLA_HDRLEN + str_len);
+    std::memcpy(reinterpret_cast<uint8_t*>(nla) + NLA_HDRLEN, attr_str.c_str(), str_len);
+
+    gh->cmd = cmd;
+    gh->version = version;
+    nh->nlmsg_len = static_cast<uint32_t>(NLMSG_HDRLEN + GENL_HDRLEN + NLA_ALIGN(nla->nla_len));
+    nh->nlmsg_type = type;
+    nh->nlmsg_flags = flags;
+    nh->nlmsg_seq = ++seq_;
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    return sendto(fd_, req, nh->nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) >= 0;
+}
+
+bool WireGuardNetlink::resolveFamily() {
+    if (!sendRequest(GENL_ID_CTRL, NLM_F_REQUEST, CTRL_CMD_GETFAMILY, 1,
+                     CTRL_ATTR_FAMILY_NAME, WG_GENL_NAME)) {
+        return false;
+    }
+    // Drain until our reply shows up (stale replies from a timed-out request may be queued)
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        ssize_t r = recv(fd_, buf_.data(), buf_.size(), 0);
+        if (r <= 0) return false;
+        int len = static_cast<int>(r);
+        for (auto* nh = reinterpret_cast<nlmsghdr*>(buf_.data());
+             NLMSG_OK(nh, len);
+             nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_seq != seq_) continue;
+            if (nh->nlmsg_type == NLMSG_ERROR) return false; // ENOENT: module not loaded
+            if (nh->nlmsg_type != GENL_ID_CTRL) continue;
+
+            int attr_len = 0;
+            const uint8_t* attrs = genl_attrs(nh, attr_len);
+            for_each_attr(attrs, attr_len, [&](uint16_t t, const uint8_t* p, int n) {
+                if (t == CTRL_ATTR_FAMILY_ID && n >= 2) std::memcpy(&family_id_, p, 2);
+            });
+            return family_id_ != 0;
+        }
+    }
+    return false;
+}
+
+bool WireGuardNetlink::LatestHandshakes(const std::string& ifname, std::vector<Peer>& peers) {
+    peers.clear();
+    if (!openSocket()) return false;
+    if (family_id_ == 0 && !resolveFamily()) return false;
+
+    if (!sendRequest(family_id_, NLM_F_REQUEST | NLM_F_DUMP, WG_CMD_GET_DEVICE, WG_GENL_VERSION,
+                     WGDEVICE_A_IFNAME, ifname)) {
+        family_id_ = 0;
+        return false;
+    }
+
+    // A device with many peers is split over several messages; a peer whose
+    // allowed-ips list is split reappears with only PUBLIC_KEY/ALLOWEDIPS,
+    // so a peer is recorded only from the fragment carrying its handshake.
+    for (int attempt = 0; attempt < MAX_DUMP_RECVS; ++attempt) {
+        ssize_t r = recv(fd_, buf_.data(), buf_.size(), 0);
+        if (r <= 0) {
+            family_id_ = 0;
+            return false;
+        }
+        int len = static_cast<int>(r);
+        for (auto* nh = reinterpret_cast<nlmsghdr*>(buf_.data());
+             NLMSG_OK(nh, len);
+             nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_seq != seq_) continue;
+            if (nh->nlmsg_type == NLMSG_DONE) return true;
+            if (nh->nlmsg_type == NLMSG_ERROR) {
+                const auto* err = static_cast<const nlmsgerr*>(NLMSG_DATA(nh));
+                if (err->error == 0) continue;
+                family_id_ = 0;
+                return false;
+            }
+            if (nh->nlmsg_type != family_id_) continue;
+
+            int attr_len = 0;
+            const uint8_t* attrs = genl_attrs(nh, attr_len);
+            for_each_attr(attrs, attr_len, [&](uint16_t t, const uint8_t* p, int n) {
+                if (t != WGDEVICE_A_PEERS) return;
+                for_each_attr(p, n, [&](uint16_t, const uint8_t* pp, int pn) {
+                    const uint8_t* key = nullptr;
+                    bool have_hs = false;
+                    int64_t hs_sec = 0;
+                    for_each_attr(pp, pn, [&](uint16_t pt, const uint8_t* v, int vn) {
+                        if (pt == WGPEER_A_PUBLIC_KEY && vn == WG_KEY_LEN) {
+                            key = v;
+                        } else if (pt == WGPEER_A_LAST_HANDSHAKE_TIME && vn >= 8) {
+                            std::memcpy(&hs_sec, v, sizeof(hs_sec)); // __kernel_timespec.tv_sec
+                            have_hs = true;
+                        }
+                    });
+                    if (key && have_hs) {
+                        Peer peer;
+                        peer.public_key = base64_encode(key, WG_KEY_LEN);
+                        peer.last_handshake_s = hs_sec;
+                        peers.push_back(std::move(peer));
+                    }
+                });
+            });
+        }
+    }
+    return false;
+}
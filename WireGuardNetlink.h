@@ -0,0 +1,42 @@
+#ifndef WIREGUARD_NETLINK_H
+#define WIREGUARD_NETLINK_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// WireGuard peer handshakes over the "wireguard" generic-netlink family,
+// the same WG_CMD_GET_DEVICE dump that `wg show` issues, without the fork.
+// The family id is resolved lazily and re-resolved after a failure (module
+// loaded late or reloaded). Needs CAP_NET_ADMIN, like `wg` itself.
+class WireGuardNetlink {
+public:
+    struct Peer {
+        std::string public_key; // base64, as stored by wg-easy
+        int64_t last_handshake_s = 0; // unix time, 0 = never
+    };
+
+    WireGuardNetlink();
+    ~WireGuardNetlink();
+
+    WireGuardNetlink(const WireGuardNetlink&) = delete;
+    WireGuardNetlink& operator=(const WireGuardNetlink&) = delete;
+
+    // Fills peers for ifname. Returns false if the kernel family is missing,
+    // the interface does not exist or permission was denied.
+    // Not thread-safe: call from one thread only (the slow probe thread).
+    bool LatestHandshakes(const std::string& ifname, std::vector<Peer>& peers);
+
+private:
+    bool openSocket();
+    bool resolveFamily();
+    bool sendRequest(uint16_t type, uint16_t flags, uint8_t cmd, uint8_t version,
+                     uint16_t attr_type, const std::string& attr_str);
+
+    int fd_ = -1;
+    uint16_t family_id_ = 0;
+    uint32_t seq_ = 0;
+    std::vector<uint8_t> buf_;
+};
+
+#endif // WIREGUARD_NETLINK_H
@@ -0,0 +1,467 @@
+// Headless benchmark of the frame pipeline: Renderer -> DirtyTracker ->
+// SPI budget (LCD_SPI_BUDGET_KB) -> pixel packing (ILI9488_PIXEL_FORMAT), with a null display sink instead
+// of SPI/GPIO.
+//
+// Usage: lcd_bench [--frames N] [--fps N] [--trace FILE] [scenario ...]
+// Scenarios: idle, net, print (default: all three) and trace (replays a
+// file written by lcd_monitor with LCD_BENCH_RECORD=FILE).
+//
+// Time is simulated: frames are rendered back to back with dt = 1/fps, and
+// metrics change once per simulated second like the probe threads deliver
+// them. Reported fps is therefore what the render path could sustain.
+#include "DisplayConfig.h"
+#include "Renderer.h"
+#include "AnimationEngine.h"
+#include "IdleModeController.h"
+#include "SystemMetrics.h"
+#include "PrinterClient.h"
+#include "DirtyRect.h"
+#include "DirtyTracker.h"
+#include "ProgressiveUpdate.h"
+#include "PixelConvert.h"
+#include "Profiler.h"
+#include "ScreenLayout.h"
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Counting allocator: every operator new in the process bumps this, so the
+// report can show heap allocations per measured frame (the render loop is
+// meant to allocate nothing in steady state)
+static std::atomic<uint64_t> g_allocs{0};
+
+// noinline: once inlined, GCC pairs malloc() with delete and warns
+__attribute__((noinline)) void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+__attribute__((noinline)) void* operator new[](size_t n) { return operator new(n); }
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point t0) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - t0).count();
+}
+
+// One metrics tick, also the line format of LCD_BENCH_RECORD
+struct Sample {
+    double cpu = 0.0;
+    double temp = 0.0;
+    double mem = 0.0;
+    double net1 = 0.0;
+    double net2 = 0.0;
+};
+
+bool load_trace(const std::string& path, std::vector<Sample>& out) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream ss(line);
+        double t = 0.0;
+        Sample s;
+        if (ss >> t >> s.cpu >> s.temp >> s.mem >> s.net1 >> s.net2) out.push_back(s);
+    }
+    return !out.empty();
+}
+
+// Packs the rects exactly as ILI9488::UpdateRect would and drops the bytes
+class NullSink {
+public:
+    NullSink() : format_(SelectPixelFormat()), bpp_(PixelFormatBytes(format_)),
+                 stage_(static_cast<size_t>(DISPLAY_WIDTH) * bpp_) {
+        if (format_ == PixelFormat::RGB666) {
+            convert_ = SelectRgb565To666(&kernel_);
+        } else {
+            // 16-bit SPI words: the driver sends the frame buffer as is
+            convert_ = Rgb565Copy;
+            kernel_ = "copy";
+        }
+    }
+
+    void Send(const uint16_t* pixels, const std::vector<Rect>& rects, bool full) {
+        if (full) {
+            sendRect({0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT}, pixels);
+        } else {
+            for (const auto& r : rects) sendRect(r, pixels);
+        }
+    }
+
+    const char* kernel() const { return kernel_; }
+    size_t bpp() const { return bpp_; }
+    size_t bytes = 0;
+    size_t rects = 0;
+
+private:
+    void sendRect(const Rect& r, const uint16_t* pixels) {
+        for (int y = r.y; y < r.y + r.h; ++y) {
+            convert_(pixels + static_cast<size_t>(y) * DISPLAY_WIDTH + r.x, stage_.data(), static_cast<size_t>(r.w));
+        }
+        bytes += static_cast<size_t>(r.w) * r.h * bpp_;
+        rects++;
+    }
+
+    const char* kernel_ = "scalar";
+    PixelFormat format_;
+    size_t bpp_;
+    PixelConvertFn convert_ = Rgb565To666Scalar;
+    std::vector<uint8_t> stage_;
+};
+
+struct Scenario {
+    std::string name;
+    double warmup_s = 0.0; // simulated seconds rendered before measuring (1 s steps)
+    // Fills the metrics tick for simulated second `tick`
+    std::function<void(int tick, double t, MetricsSnapshot&, PrinterMetrics&)> tick;
+};
+
+struct StageWindow {
+    std::vector<std::vector<uint32_t>> last;
+    std::vector<uint64_t> last_count;
+    std::vector<uint64_t> last_sum;
+
+    void Reset() {
+        int n = Profiler::StageCount();
+        last.assign(static_cast<size_t>(n), std::vector<uint32_t>(Profiler::BUCKETS, 0));
+        last_count.assign(static_cast<size_t>(n), 0);
+        last_sum.assign(static_cast<size_t>(n), 0);
+        Profiler::Snapshot snap;
+        for (int id = 0; id < n; ++id) {
+            if (!Profiler::Take(id, snap)) continue;
+            last[id] = snap.buckets;
+            last_count[id] = snap.count;
+            last_sum[id] = snap.sum_ns;
+        }
+    }
+
+    void Print() const {
+        std::printf("  %-26s %8s %10s %10s %10s %10s\n", "stage", "count", "mean_us", "p50_us", "p95_us", "max_us");
+        Profiler::Snapshot snap;
+        std::vector<uint32_t> delta(Profiler::BUCKETS);
+        for (int id = 0; id < Profiler::StageCount(); ++id) {
+            if (!Profiler::Take(id, snap)) continue;
+            size_t i = static_cast<size_t>(id);
+            uint64_t count = snap.count - (i < last_count.size() ? last_count[i] : 0);
+            if (count == 0) continue;
+            uint64_t sum = snap.sum_ns - (i < last_sum.size() ? last_sum[i] : 0);
+            for (int b = 0; b < Profiler::BUCKETS; ++b) {
+                delta[b] = snap.buckets[b] - (i < last.size() ? last[i][b] : 0);
+            }
+            std::printf("  %-26s %8llu %10.1f %10.1f %10.1f %10.1f\n", snap.name.c_str(),
+                        static_cast<unsigned long long>(count),
+                        static_cast<double>(sum) / count / 1000.0,
+                        Profiler::Quantile(delta, count, 0.5) / 1000.0,
+                        Profiler::Quantile(delta, count, 0.95) / 1000.0,
+                        static_cast<double>(snap.max_ns) / 1000.0);
+        }
+    }
+};
+
+void run(const Scenario& sc, int frames, int fps, double full_threshold, int tile, int max_rects,
+         uint32_t spi_hz, int budget_kb) {
+    Renderer renderer;
+    AnimationEngine animator;
+    const AnimationEngine::Handle anim_cpu = animator.add("cpu");
+    const AnimationEngine::Handle anim_temp = animator.add("temp");
+    const AnimationEngine::Handle anim_net1 = animator.add("net1");
+    const AnimationEngine::Handle anim_net2 = animator.add("net2");
+    IdleModeController idle_controller;
+    MetricsSnapshot metrics; // filled by the scenario
+    PrinterMetrics printer;
+    NullSink sink;
+
+    const size_t screen_area = static_cast<size_t>(DISPLAY_WIDTH) * DISPLAY_HEIGHT;
+    std::vector<uint16_t> scene(screen_area);
+    std::vector<uint16_t> prev(screen_area);
+    std::vector<Rect> invalidated;
+    std::vector<Rect> rects;
+    DirtyTracker dirty_tracker(DISPLAY_WIDTH, DISPLAY_HEIGHT, tile, max_rects);
+    ProgressiveUpdate progressive(DISPLAY_WIDTH, DISPLAY_HEIGHT, tile,
+                                  static_cast<size_t>(std::max(0, budget_kb)) * 1024 / sink.bpp(), max_rects);
+    bool first_frame = true;
+
+    double render_s = 0.0, diff_s = 0.0, send_s = 0.0;
+    size_t dirty_total = 0;
+    uint64_t allocs = 0;
+    int alloc_frames = 0; // frames that allocated at all
+    int sent = 0, full_frames = 0, held = 0, measured = 0;
+    StageWindow stages;
+
+    // Mirrors the main loop in main.cpp, minus pacing and the display thread
+    auto frame = [&](double t, double dt, bool new_tick, int tick) {
+        if (new_tick) {
+            sc.tick(tick, t, metrics, printer);
+            renderer.UpdateHistories(metrics);
+        }
+        animator.set_target(anim_cpu, metrics.cpu_usage);
+        animator.set_target(anim_temp, metrics.temp);
+        animator.set_target(anim_net1, metrics.net1_mbps);
+        animator.set_target(anim_net2, metrics.net2_mbps);
+        animator.step(dt);
+        idle_controller.update(metrics, dt);
+
+        const uint64_t allocs0 = g_allocs.load(std::memory_order_relaxed);
+        auto t0 = Clock::now();
+        {
+            PROFILE_SCOPE("render.frame");
+            renderer.Render(metrics, printer, animator, idle_controller, t, scene, &invalidated);
+        }
+        progressive.TakeDeferred(invalidated);
+        auto t1 = Clock::now();
+
+        bool send_frame = false;
+        size_t dirty_area = 0;
+        if (first_frame) {
+            send_frame = true;
+            dirty_area = screen_area;
+        } else if (!invalidated.empty()) {
+            PROFILE_SCOPE("dirty.compute");
+            dirty_area = dirty_tracker.Compute(scene.data(), prev.data(), rects, &invalidated);
+            if (dirty_area > 0) {
+                double ratio = static_cast<double>(dirty_area) / screen_area;
+                if (ratio > full_threshold || rects.empty()) dirty_area = screen_area;
+                send_frame = true;
+            }
+        }
+        auto t2 = Clock::now();
+
+        bool full = false;
+        if (send_frame) {
+            full = first_frame || dirty_area == screen_area;
+            if (!first_frame && progressive.Enabled()) {
+                if (full) rects.assign(1, Rect{0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT});
+                if (progressive.Limit(scene.data(), prev.data(), rects)) {
+                    full = false;
+                    dirty_area = 0;
+                    for (const auto& r : rects) dirty_area += static_cast<size_t>(r.w) * r.h;
+                }
+            }
+            {
+                PROFILE_SCOPE("spi.frame");
+                sink.Send(scene.data(), rects, full);
+            }
+            if (full) {
+                prev = scene;
+            } else {
+                for (const auto& r : rects) {
+                    for (int y = r.y; y < r.y + r.h; ++y) {
+                        size_t off = static_cast<size_t>(y) * DISPLAY_WIDTH + r.x;
+                        std::copy_n(scene.begin() + off, r.w, prev.begin() + off);
+                    }
+                }
+            }
+            first_frame = false;
+        }
+        auto t3 = Clock::now();
+        const uint64_t frame_allocs = g_allocs.load(std::memory_order_relaxed) - allocs0;
+        allocs += frame_allocs;
+        alloc_frames += frame_allocs ? 1 : 0;
+
+        render_s += std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+        diff_s += std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+        send_s += std::chrono::duration_cast<std::chrono::duration<double>>(t3 - t2).count();
+        dirty_total += send_frame ? dirty_area : 0;
+        sent += send_frame ? 1 : 0;
+        full_frames += full ? 1 : 0;
+        held += progressive.Pending() ? 1 : 0;
+        measured++;
+    };
+
+    // Warm-up in 1 s steps: histories fill, idle kicks in, the print carousel turns
+    const double t_base = 1000.0;
+    int tick = 0;
+    for (double t = 0.0; t < sc.warmup_s; t += 1.0) {
+        frame(t_base + t, 1.0, true, tick++);
+    }
+    render_s = diff_s = send_s = 0.0;
+    dirty_total = 0;
+    allocs = 0;
+    alloc_frames = 0;
+    sent = full_frames = held = measured = 0;
+    sink.bytes = sink.rects = 0;
+    stages.Reset();
+
+    const double dt = 1.0 / fps;
+    const double t_start = t_base + sc.warmup_s;
+    auto wall0 = Clock::now();
+    for (int f = 0; f < frames; ++f) {
+        bool new_tick = (f % fps) == 0;
+        frame(t_start + f * dt, dt, new_tick, new_tick ? tick++ : tick);
+    }
+    double wall = seconds_since(wall0);
+
+    double n = std::max(1, measured);
+    double bytes_per_frame = static_cast<double>(sink.bytes) / n;
+    std::printf("[%s] %d frames (%.1f s simulated at %d fps), kernel=%s\n",
+                sc.name.c_str(), measured, measured * dt, fps, sink.kernel());
+    std::printf("  pipeline fps=%.1f render_ms=%.3f diff_ms=%.3f pack_ms=%.3f\n",
+                measured / std::max(1e-9, wall), render_s * 1000.0 / n, diff_s * 1000.0 / n, send_s * 1000.0 / n);
+    std::printf("  sent=%d full=%d held=%d dirty=%.1f%% bytes/frame=%.0f rects=%zu spi_ms/frame=%.2f (at %u Hz)\n",
+                sent, full_frames, held, 100.0 * dirty_total / (n * screen_area), bytes_per_frame, sink.rects,
+                bytes_per_frame * 8.0 * 1000.0 / spi_hz, spi_hz);
+    std::printf("  heap allocs/frame=%.2f (%d of %d frames allocated)\n",
+                static_cast<double>(allocs) / n, alloc_frames, measured);
+    stages.Print();
+}
+
+std::shared_ptr<const Thumbnail565> make_thumb(int w, int h) {
+    std::vector<unsigned char> rgba(static_cast<size_t>(w) * h * 4);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            unsigned char* p = &rgba[(static_cast<size_t>(y) * w + x) * 4];
+            p[0] = static_cast<unsigned char>(x * 255 / w);
+            p[1] = static_cast<unsigned char>(y * 255 / h);
+            p[2] = static_cast<unsigned char>(((x / 16 + y / 16) & 1) ? 200 : 60);
+            p[3] = 255;
+        }
+    }
+    // Fitted to the preview of the layout the runs use, as PrinterClient does
+    ScreenLayout layout = DefaultScreenLayout();
+    std::string error;
+    const std::string layout_path = getenv_string("LCD_LAYOUT_FILE", "");
+    if (!layout_path.empty()) LoadScreenLayout(layout_path, layout, error);
+    const Rect box = PrintThumbRect(layout.print_preview);
+    return Thumbnail565::FromRGBA(rgba.data(), w, h, box.w, box.h);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int frames = 120;
+    bool frames_set = false;
+    int fps = std::max(1, getenv_int("LCD_FPS", 5));
+    std::string trace_path;
+    std::vector<std::string> wanted;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--frames" && i + 1 < argc) {
+            frames = std::max(1, std::atoi(argv[++i]));
+            frames_set = true;
+        } else if (a == "--fps" && i + 1 < argc) {
+            fps = std::max(1, std::atoi(argv[++i]));
+        } else if (a == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (a == "-h" || a == "--help") {
+            std::cout << "usage: lcd_bench [--frames N] [--fps N] [--trace FILE] [idle|net|print|trace ...]" << std::endl;
+            return 0;
+        } else {
+            wanted.push_back(a);
+        }
+    }
+    if (wanted.empty()) {
+        wanted = {"idle", "net", "print"};
+        if (!trace_path.empty()) wanted.push_back("trace");
+    }
+
+    Profiler::SetEnabled(true);
+    const double full_threshold = getenv_double("LCD_FULL_FRAME_THRESHOLD", 0.6);
+    const int tile = getenv_int("LCD_DIRTY_TILE", 16);
+    const int max_rects = getenv_int("LCD_DIRTY_MAX_RECTS", 8);
+    const uint32_t spi_hz = static_cast<uint32_t>(std::max(1, getenv_int("ILI9488_SPI_SPEED_HZ", 16000000)));
+    const int budget_kb = getenv_int("LCD_SPI_BUDGET_KB", 0);
+
+    std::mt19937 rng(12345);
+    auto noise = [&rng](double lo, double hi) {
+        return std::uniform_real_distribution<double>(lo, hi)(rng);
+    };
+    auto base = [](MetricsSnapshot& m) {
+        m.wan_state = WanState::OK;
+        m.wg_active_peers = 2;
+        m.mc_online = 0;
+        m.mc_max = 20;
+        m.docker_running = 7;
+        m.disk_percent = 41;
+    };
+
+    std::vector<Sample> trace;
+    if (!trace_path.empty() && !load_trace(trace_path, trace)) {
+        std::cerr << "Failed to read trace " << trace_path << std::endl;
+        return 1;
+    }
+
+    std::vector<Scenario> scenarios;
+    scenarios.push_back({"idle", 35.0, [&](int tick, double, MetricsSnapshot& m, PrinterMetrics&) {
+        base(m);
+        m.cpu_usage = noise(2.0, 4.0);
+        m.temp = 42.0 + noise(-0.3, 0.3);
+        m.mem_percent = 31.0;
+        m.net1_mbps = noise(0.05, 0.8);
+        m.net2_mbps = noise(0.01, 0.3);
+        m.uptime_seconds = 86400 + tick;
+    }});
+    scenarios.push_back({"net", 5.0, [&](int tick, double, MetricsSnapshot& m, PrinterMetrics&) {
+        base(m);
+        m.cpu_usage = noise(60.0, 95.0);
+        m.temp = noise(62.0, 70.0);
+        m.mem_percent = noise(55.0, 60.0);
+        m.net1_mbps = noise(800.0, 950.0);
+        m.net2_mbps = noise(300.0, 900.0);
+        m.uptime_seconds = 86400 + tick;
+    }});
+    auto thumb = make_thumb(300, 300);
+    // The carousel shows the print screen after 180 s of main screen, for 30 s
+    scenarios.push_back({"print", 181.0, [&, thumb](int tick, double t, MetricsSnapshot& m, PrinterMetrics& p) {
+        base(m);
+        m.cpu_usage = noise(20.0, 30.0);
+        m.temp = noise(50.0, 55.0);
+        m.mem_percent = 40.0;
+        m.net1_mbps = noise(1.0, 5.0);
+        m.net2_mbps = noise(0.5, 2.0);
+        m.uptime_seconds = 86400 + tick;
+        p.state = PrinterState::PRINTING;
+        p.filename = "benchy_0.2mm_PLA_MK4_1h12m.gcode";
+        p.progress01 = std::min(1.0f, 0.1f + tick * 0.001f);
+        p.elapsed_sec = 600 + tick;
+        p.eta_sec = 3600 - tick;
+        p.active = true;
+        p.had_job = true;
+        p.last_active_ts = t;
+        p.thumb = thumb;
+    }});
+    scenarios.push_back({"trace", 0.0, [&](int tick, double, MetricsSnapshot& m, PrinterMetrics&) {
+        base(m);
+        const Sample& s = trace[static_cast<size_t>(tick) % trace.size()];
+        m.cpu_usage = s.cpu;
+        m.temp = s.temp;
+        m.mem_percent = s.mem;
+        m.net1_mbps = s.net1;
+        m.net2_mbps = s.net2;
+        m.uptime_seconds = 86400 + tick;
+    }});
+
+    for (const auto& name : wanted) {
+        auto it = std::find_if(scenarios.begin(), scenarios.end(),
+                               [&](const Scenario& s) { return s.name == name; });
+        if (it == scenarios.end() || (name == "trace" && trace.empty())) {
+            std::cerr << "Unknown scenario (or no --trace): " << name << std::endl;
+            return 1;
+        }
+        int n = frames;
+        if (name == "trace" && !frames_set) n = static_cast<int>(trace.size()) * fps;
+        run(*it, n, fps, full_threshold, tile, max_rects, spi_hz, budget_kb);
+    }
+    return 0;
+}
@@ -1,343 +1,141 @@
-#include "ILI9488.h"
 #include "SystemMetrics.h"
-#include "Renderer.h"
 #include "PrinterClient.h"
-#include "AnimationEngine.h"
-#include "IdleModeController.h"
+#include "Profiler.h"
+#include "HistoryStore.h"
+#include "Panel.h"
+#include "RemoteMetrics.h"
 #include "utils.h"
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <unistd.h>
-#include <chrono>
-#include <cstdlib>
-#include <algorithm>
 #include <csignal>
-#include <cstring>
-#include <vector>
+#include <poll.h>
+#include <sys/eventfd.h>
 
 static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t reload_layout = 0;
 static void signal_handler(int) { running = 0; }
-
-struct Rect {
-    int x;
-    int y;
-    int w;
-    int h;
-};
-
-static void compute_dirty_tiles(const uint16_t* cur,
-                                const uint16_t* prev,
-                                int width,
-                                int height,
-                                int tile,
-                                std::vector<uint8_t>& dirty,
-                                int& dirty_tiles) {
-    int tiles_x = (width + tile - 1) / tile;
-    int tiles_y = (height + tile - 1) / tile;
-    dirty.assign(static_cast<size_t>(tiles_x * tiles_y), 0);
-    dirty_tiles = 0;
-    for (int ty = 0; ty < tiles_y; ++ty) {
-        int y0 = ty * tile;
-        int y1 = std::min(y0 + tile, height);
-        for (int tx = 0; tx < tiles_x; ++tx) {
-            int x0 = tx * tile;
-            int x1 = std::min(x0 + tile, width);
-            bool diff = false;
-
-            // Optimized tile comparison: check row-by-row with early exit
-            for (int y = y0; y < y1 && !diff; ++y) {
-                const uint16_t* a = cur + y * width + x0;
-                const uint16_t* b = prev + y * width + x0;
-                int pixels = x1 - x0;
-
-                // Fast path: compare as uint64_t chunks for better performance
-                if (pixels >= 4 && (reinterpret_cast<uintptr_t>(a) % 8 == 0) &&
-                    (reinterpret_cast<uintptr_t>(b) % 8 == 0)) {
-                    const uint64_t* a64 = reinterpret_cast<const uint64_t*>(a);
-                    const uint64_t* b64 = reinterpret_cast<const uint64_t*>(b);
-                    int chunks = pixels / 4;
-                    int remainder = pixels % 4;
-
-                    for (int i = 0; i < chunks; ++i) {
-                        if (a64[i] != b64[i]) {
-                            diff = true;
-                            break;
-                        }
-                    }
-
-                    // Check remaining pixels
-                    if (!diff && remainder > 0) {
-                        for (int i = chunks * 4; i < pixels; ++i) {
-                            if (a[i] != b[i]) {
-                                diff = true;
-                                break;
-                            }
-                        }
-                    }
-                } else {
-                    // Fallback to pixel-by-pixel comparison (still faster than memcmp for small tiles)
-                    for (int i = 0; i < pixels; ++i) {
-                        if (a[i] != b[i]) {
-                            diff = true;
-                            break;
-                        }
-                    }
-                }
-            }
-
-            if (diff) {
-                dirty[ty * tiles_x + tx] = 1;
-                ++dirty_tiles;
-            }
-        }
-    }
-}
-
-static void build_rects_from_tiles(int width,
-                                   int height,
-                                   int tile,
-                                   const std::vector<uint8_t>& dirty,
-                                   std::vector<Rect>& rects) {
-    int tiles_x = (width + tile - 1) / tile;
-    int tiles_y = (height + tile - 1) / tile;
-    std::vector<uint8_t> visited(dirty.size(), 0);
-    rects.clear();
-
-    std::vector<int> stack;
-    stack.reserve(dirty.size());
-
-    auto push = [&](int idx) {
-        visited[idx] = 1;
-        stack.push_back(idx);
-    };
-
-    for (int ty = 0; ty < tiles_y; ++ty) {
-        for (int tx = 0; tx < tiles_x; ++tx) {
-            int idx = ty * tiles_x + tx;
-            if (!dirty[idx] || visited[idx]) continue;
-
-            int min_tx = tx, max_tx = tx;
-            int min_ty = ty, max_ty = ty;
-            push(idx);
-
-            while (!stack.empty()) {
-                int cur_idx = stack.back();
-                stack.pop_back();
-                int cx = cur_idx % tiles_x;
-                int cy = cur_idx / tiles_x;
-                min_tx = std::min(min_tx, cx);
-                max_tx = std::max(max_tx, cx);
-                min_ty = std::min(min_ty, cy);
-                max_ty = std::max(max_ty, cy);
-
-                const int nx[4] = {1, -1, 0, 0};
-                const int ny[4] = {0, 0, 1, -1};
-                for (int k = 0; k < 4; ++k) {
-                    int xx = cx + nx[k];
-                    int yy = cy + ny[k];
-                    if (xx < 0 || yy < 0 || xx >= tiles_x || yy >= tiles_y) continue;
-                    int nidx = yy * tiles_x + xx;
-                    if (dirty[nidx] && !visited[nidx]) {
-                        push(nidx);
-                    }
-                }
-            }
-
-            Rect r;
-            r.x = min_tx * tile;
-            r.y = min_ty * tile;
-            r.w = (max_tx - min_tx + 1) * tile;
-            r.h = (max_ty - min_ty + 1) * tile;
-            if (r.x + r.w > width) r.w = width - r.x;
-            if (r.y + r.h > height) r.h = height - r.y;
-            rects.push_back(r);
-        }
-    }
-}
-
-const int TARGET_FPS = getenv_int("LCD_FPS", 5);
-const int IDLE_FPS = getenv_int("LCD_IDLE_FPS", 3);
-const int BURST_FRAMES = getenv_int("LCD_ANIM_BURST_FRAMES", 5);
-const int TILE_SIZE = getenv_int("LCD_DIRTY_TILE", 16);
-const int DIRTY_MAX_RECTS = getenv_int("LCD_DIRTY_MAX_RECTS", 8);
-const double FULL_FRAME_THRESHOLD = getenv_double("LCD_FULL_FRAME_THRESHOLD", 0.6);
+static void reload_handler(int) { reload_layout = 1; }
 
 int main() {
     std::cout << "Starting Full LCD Monitor Test..." << std::endl << std::flush;
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
-
-    // GPIO mapping from Python script
-    const std::string dc_chip = "/dev/gpiochip3";
-    const int dc_pin = 13;
-    const std::string rst_chip = "/dev/gpiochip3";
-    const int rst_pin = 14;
-    const std::string bl_chip = "/dev/gpiochip1";
-    const int bl_pin = 2;
-    const std::string spi_dev = "/dev/spidev0.0";
-
-    ILI9488 display(spi_dev, dc_chip, dc_pin, rst_chip, rst_pin, bl_chip, bl_pin);
-    if (!display.Init()) {
-        std::cerr << "Failed to initialize display" << std::endl << std::flush;
-        return 1;
+    signal(SIGHUP, reload_handler); // re-read LCD_LAYOUT_FILE
+
+    // Stage histograms, scraped over a Unix socket in Prometheus text format
+    Profiler::SetEnabled(getenv_bool("LCD_PROFILE", false));
+    StatsServer stats_server(getenv_string("LCD_STATS_SOCKET", "/run/lcd_monitor.sock"),
+                             getenv_bool("LCD_DEBUG", false));
+    if (Profiler::Enabled()) {
+        stats_server.Start();
     }
 
+    // Local probes run once, whatever number of panels shows them
     SystemMetrics metrics;
-    metrics.Start(); // Start the async worker threads
     std::string printer_url = getenv_string("LCD_PRINTER_URL", "http://192.168.1.103:7125");
     PrinterClient printer(printer_url);
-    printer.Start();
-
-    Renderer renderer;
-    AnimationEngine animator;
-    IdleModeController idle_controller;
-    std::vector<uint16_t> frame_a(DISPLAY_WIDTH * DISPLAY_HEIGHT);
-    std::vector<uint16_t> frame_b(DISPLAY_WIDTH * DISPLAY_HEIGHT);
-    std::vector<uint16_t>* cur = &frame_a;
-    std::vector<uint16_t>* prev = &frame_b;
-    bool first_frame = true;
-
-    std::vector<uint8_t> dirty_tiles;
-    std::vector<Rect> rects;
-    int anim_burst = 0;
-
-    auto last_log = std::chrono::steady_clock::now();
-    double render_time_acc = 0.0;
-    double spi_time_acc = 0.0;
-    size_t bytes_sent_acc = 0;
-    int render_frames = 0;
-    int spi_frames = 0;
-    size_t last_dirty_area = 0;
-    size_t last_dirty_rects = 0;
-
-    auto last_frame_time = std::chrono::steady_clock::now();
-
-    while (running) {
-        auto frame_start = std::chrono::steady_clock::now();
-        auto dt_duration = frame_start - last_frame_time;
-        double dt = std::chrono::duration_cast<std::chrono::duration<double>>(dt_duration).count();
-        last_frame_time = frame_start;
-
-        bool metrics_updated = metrics.Update();
-        if (metrics_updated) {
-            renderer.UpdateHistories(metrics);
-            renderer.UpdateTickerText(metrics);
-            anim_burst = BURST_FRAMES;
-        }
-
-        // Set animation targets
-        animator.set_target("cpu", metrics.cpu_usage);
-        animator.set_target("temp", metrics.temp);
-        animator.set_target("net1", metrics.net1_mbps);
-        animator.set_target("net2", metrics.net2_mbps);
-        animator.step(dt);
-        idle_controller.update(metrics, dt);
-
-        auto render_start = std::chrono::steady_clock::now();
-        double time_sec = std::chrono::duration_cast<std::chrono::duration<double>>(frame_start.time_since_epoch()).count();
-        PrinterMetrics printer_snapshot = printer.GetSnapshot();
-        renderer.Render(metrics, printer_snapshot, animator, idle_controller, time_sec, *cur);
-        auto render_end = std::chrono::steady_clock::now();
-        render_time_acc += std::chrono::duration_cast<std::chrono::duration<double>>(render_end - render_start).count();
-        render_frames++;
-
-        bool send_frame = false;
-        size_t dirty_area = 0;
-        size_t bytes_sent = 0;
-
-        if (first_frame) {
-            send_frame = true;
-            dirty_area = static_cast<size_t>(DISPLAY_WIDTH) * DISPLAY_HEIGHT;
-            bytes_sent = dirty_area * 3;
+    // Other hosts push their metrics here (RemoteMetrics.h); 0 = off
+    MetricsListener listener(getenv_int("LCD_METRICS_PORT", 0), getenv_bool("LCD_DEBUG", false));
+
+    // The first panel showing local metrics also gets the print screen and
+    // the graph history, which survives restarts (an empty path keeps it in
+    // RAM only)
+    HistoryStore history;
+    const std::string history_path = getenv_string("LCD_HISTORY_FILE", "/var/lib/lcd_monitor/history.bin");
+
+    // Every panel is wired to its producers before they start, so the first
+    // probe round and the printer's first fetch overlap the panel resets
+    std::vector<std::unique_ptr<PanelPipeline>> panels;
+    PanelPipeline* primary = nullptr;
+    for (const PanelConfig& config : LoadPanelConfigs()) {
+        MetricsSource source;
+        if (config.source == "local") {
+            source.local = &metrics;
         } else {
-            int dirty_tiles_count = 0;
-            compute_dirty_tiles(cur->data(), prev->data(), DISPLAY_WIDTH, DISPLAY_HEIGHT,
-                                TILE_SIZE, dirty_tiles, dirty_tiles_count);
-            if (dirty_tiles_count > 0) {
-                build_rects_from_tiles(DISPLAY_WIDTH, DISPLAY_HEIGHT, TILE_SIZE, dirty_tiles, rects);
-                size_t screen_area = static_cast<size_t>(DISPLAY_WIDTH) * DISPLAY_HEIGHT;
-                for (const auto& r : rects) {
-                    dirty_area += static_cast<size_t>(r.w) * r.h;
-                }
-                double dirty_ratio = (screen_area > 0) ? (static_cast<double>(dirty_area) / screen_area) : 1.0;
-                if (dirty_ratio > FULL_FRAME_THRESHOLD || static_cast<int>(rects.size()) > DIRTY_MAX_RECTS) {
-                    send_frame = true;
-                    dirty_area = screen_area;
-                    bytes_sent = dirty_area * 3;
-                } else {
-                    send_frame = true;
-                    bytes_sent = dirty_area * 3;
-                }
-            }
+            source.remote = &listener;
+            source.host = config.source;
         }
-
-        if (send_frame) {
-            auto spi_start = std::chrono::steady_clock::now();
-            if (first_frame || dirty_area == static_cast<size_t>(DISPLAY_WIDTH) * DISPLAY_HEIGHT) {
-                display.Display(*cur);
-                last_dirty_rects = 1;
-            } else {
-                for (const auto& r : rects) {
-                    display.UpdateRect(r.x, r.y, r.w, r.h, cur->data(), DISPLAY_WIDTH);
-                }
-                last_dirty_rects = rects.size();
-            }
-            auto spi_end = std::chrono::steady_clock::now();
-            spi_time_acc += std::chrono::duration_cast<std::chrono::duration<double>>(spi_end - spi_start).count();
-            bytes_sent_acc += bytes_sent;
-            spi_frames++;
-            last_dirty_area = dirty_area;
-
-            std::swap(cur, prev);
-            first_frame = false;
+        const bool first_local = source.local && !primary;
+        auto panel = std::make_unique<PanelPipeline>(config, source, first_local ? &printer : nullptr);
+        if (first_local) {
+            primary = panel.get();
+            panel->AttachHistory(history, history_path);
+            printer.SetWakeFd(panel->WakeFd());
         }
+        if (source.local) metrics.AddWakeFd(panel->WakeFd());
+        if (source.remote) listener.AddWakeFd(panel->WakeFd());
+        panels.push_back(std::move(panel));
+    }
+
+    // Push this host's metrics to other panels (LCD_METRICS_PUSH=host:port,...)
+    char hostname[64] = {0};
+    if (gethostname(hostname, sizeof(hostname) - 1) != 0) hostname[0] = 0;
+    MetricsSender sender(getenv_string("LCD_METRICS_PUSH", ""), getenv_string("LCD_METRICS_HOST", hostname));
+    int push_fd = -1;
+    if (sender.Enabled()) {
+        push_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (push_fd >= 0) metrics.AddWakeFd(push_fd);
+    }
 
-        if (anim_burst > 0) {
-            anim_burst--;
+    metrics.Start(); // Start the async worker threads
+    if (primary) printer.Start();
+    if (getenv_int("LCD_METRICS_PORT", 0) > 0) listener.Start();
+
+    // Panel resets are mostly waiting, so all panels come up at once. A
+    // failed panel stays allocated: the producers still hold its eventfd.
+    std::vector<char> awake(panels.size(), 0);
+    {
+        std::vector<std::thread> bring_up;
+        for (size_t i = 0; i < panels.size(); ++i) {
+            bring_up.emplace_back([&panels, &awake, i] { awake[i] = panels[i]->Init(); });
         }
+        for (auto& t : bring_up) t.join();
+    }
+    size_t panels_up = 0;
+    bool primary_up = false;
+    for (size_t i = 0; i < panels.size(); ++i) {
+        if (!awake[i]) continue;
+        panels[i]->Start();
+        ++panels_up;
+        if (panels[i].get() == primary) primary_up = true;
+    }
+    if (primary && !primary_up) printer.Stop(); // no panel shows the print screen
 
-        auto frame_end = std::chrono::steady_clock::now();
-        auto frame_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(frame_end - frame_start).count();
+    if (panels_up == 0 && !sender.Enabled()) {
+        std::cerr << "Failed to initialize display" << std::endl << std::flush;
+        metrics.Stop();
+        listener.Stop();
+        stats_server.Stop();
+        return 1;
+    }
 
-        int target_fps = TARGET_FPS;
-        if (idle_controller.is_idle() && anim_burst == 0) {
-            target_fps = std::max(1, IDLE_FPS);
-        }
-        int frame_time_ms = 1000 / std::max(1, target_fps);
-        if (frame_duration_ms < frame_time_ms) {
-            usleep((frame_time_ms - frame_duration_ms) * 1000);
+    // The panels render on their own threads; this one forwards signals and
+    // pushes the local snapshots
+    MetricsSnapshot pushed;
+    uint64_t pushed_seen = 0;
+    while (running) {
+        pollfd pfd{push_fd, POLLIN, 0};
+        int n = poll(&pfd, push_fd >= 0 ? 1 : 0, 500);
+        if (reload_layout) {
+            reload_layout = 0;
+            for (auto& panel : panels) panel->ReloadLayout();
         }
-
-        auto now = std::chrono::steady_clock::now();
-        auto log_elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_log).count();
-        if (log_elapsed >= 5) {
-            double sec = static_cast<double>(log_elapsed);
-            double fps_render = render_frames / sec;
-            double fps_spi = spi_frames / sec;
-            double dirty_pct = 0.0;
-            size_t screen_area = static_cast<size_t>(DISPLAY_WIDTH) * DISPLAY_HEIGHT;
-            if (screen_area > 0) {
-                dirty_pct = 100.0 * static_cast<double>(last_dirty_area) / screen_area;
-            }
-            std::cerr << "LCD PERF: render_fps=" << fps_render
-                      << " spi_fps=" << fps_spi
-                      << " bytes_5s=" << bytes_sent_acc
-                      << " dirty_rects=" << last_dirty_rects
-                      << " dirty_pct=" << dirty_pct
-                      << " render_ms=" << (render_time_acc * 1000.0)
-                      << " spi_ms=" << (spi_time_acc * 1000.0)
-                      << std::endl;
-            render_time_acc = 0.0;
-            spi_time_acc = 0.0;
-            bytes_sent_acc = 0;
-            render_frames = 0;
-            spi_frames = 0;
-            last_log = now;
+        if (n > 0 && (pfd.revents & POLLIN)) {
+            uint64_t count;
+            ssize_t r = read(push_fd, &count, sizeof(count));
+            (void)r;
+            if (metrics.Poll(pushed, pushed_seen)) sender.Send(pushed);
         }
     }
 
-    display.SetBacklight(false);
+    for (auto& panel : panels) panel->Stop();
+    stats_server.Stop();
+    listener.Stop();
     metrics.Stop();
     printer.Stop();
+    if (push_fd >= 0) close(push_fd);
     return 0;
 }